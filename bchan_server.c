@@ -24,6 +24,13 @@
  */
 
 #include "bchan.h"
+#include "fchan_trace.h"
+#include "fchan_reply.h"
+
+/* CALLBACK1 always answers the same */
+static bchan_res callback1_res = { 0, "bungee" };
+static struct fchan_reply_tmpl callback1_tmpl =
+    FCHAN_REPLY_TMPL_INIT(xdr_bchan_res, &callback1_res);
 
 bool_t
 callback1_1_svc(bchan_msg *argp, bchan_res *result, struct svc_req *rqstp)
@@ -31,11 +38,14 @@ callback1_1_svc(bchan_msg *argp, bchan_res *result, struct svc_req *rqstp)
 
     bool_t retval = TRUE;
 
-    printf("svc rcpt bchan_msg msg1: %s msg2: %s seqnum: %d\n",
-	   argp->msg1, argp->msg2, argp->seqnum);
+    FCHAN_TRACE(FCHAN_TR_CALLBACK1_SVC, 0, rqstp->rq_msg->rm_xid,
+                argp->seqnum, 0, 0, 0);
+
+    if (fchan_reply_use(&callback1_tmpl))
+        return (retval);
 
-    result->result = 0;
-    result->msg1 = strdup("bungee");
+    result->result = callback1_res.result;
+    result->msg1 = strdup(callback1_res.msg1);
 
     return (retval);
 }
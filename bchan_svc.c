@@ -4,6 +4,7 @@
  */
 
 #include "bchan.h"
+#include "fchan_reply.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <rpc/pmap_clnt.h>
@@ -25,6 +26,7 @@ bchan_prog_1(struct svc_req *req, SVCXPRT *xprt)
     union {
         bchan_res callback1_1_res;
     } result;
+    const struct fchan_reply_buf *tmpl;
     bool_t retval;
     xdrproc_t _xdr_argument, _xdr_result;
     bool_t (*local)(char *, void *, struct svc_req *);
@@ -50,7 +52,13 @@ bchan_prog_1(struct svc_req *req, SVCXPRT *xprt)
         return;
     }
     retval = (bool_t) (*local)((char *)&argument, (void *)&result, req);
-    if (retval > 0 && !svc_sendreply(xprt, req, (xdrproc_t) _xdr_result,
+    /* a constant reply, already encoded; result was never filled in */
+    if ((tmpl = fchan_reply_take())) {
+        if (retval > 0 && !svc_sendreply(xprt, req,
+                                         (xdrproc_t) xdr_fchan_reply_buf,
+                                         (caddr_t) tmpl))
+            svcerr_systemerr(xprt, req);
+    } else if (retval > 0 && !svc_sendreply(xprt, req, (xdrproc_t) _xdr_result,
                                      &result)) {
         svcerr_systemerr(xprt, req);
     }
@@ -58,7 +66,7 @@ bchan_prog_1(struct svc_req *req, SVCXPRT *xprt)
         fprintf (stderr, "%s", "unable to free arguments");
         exit (1);
     }
-    if (!bchan_prog_1_freeresult(xprt, _xdr_result, (caddr_t) &result))
+    if (!tmpl && !bchan_prog_1_freeresult(xprt, _xdr_result, (caddr_t) &result))
         fprintf (stderr, "%s", "unable to free results");
 
     return;
@@ -1,15 +1,25 @@
 /*
  * Please do not edit this file.
- * It was generated using rpcgen.
+ * It was generated using rpcgen; the encoders were then specialized
+ * by hand (fchan_xdr_fixed.h).
  */
 
 #include "bchan.h"
+#include "fchan_xdr_fixed.h"
 #include <rpc/xdr_inline.h>
 
 bool_t
 xdr_bchan_msg (XDR *xdrs, bchan_msg *objp)
 {
-	register int32_t *buf;
+	static const u_int maxsize[2] = { 1024, 1024 };
+	char *strs[2];
+
+	if (xdrs->x_op == XDR_ENCODE) {
+		strs[0] = objp->msg1;
+		strs[1] = objp->msg2;
+		if (fchan_xdr_put_strings (xdrs, objp->seqnum, strs, maxsize, 2))
+			return TRUE;
+	}
 
 	 if (!inline_xdr_u_int (xdrs, &objp->seqnum))
 		 return FALSE;
@@ -23,7 +33,11 @@ xdr_bchan_msg (XDR *xdrs, bchan_msg *objp)
 bool_t
 xdr_bchan_res (XDR *xdrs, bchan_res *objp)
 {
-	register int32_t *buf;
+	static const u_int maxsize[1] = { 512 };
+
+	if (xdrs->x_op == XDR_ENCODE
+	    && fchan_xdr_put_strings (xdrs, objp->result, &objp->msg1, maxsize, 1))
+		return TRUE;
 
 	 if (!inline_xdr_u_int (xdrs, &objp->result))
 		 return FALSE;
@@ -27,6 +27,16 @@
 #define DUPLEX_UNIT_H
 
 #define DUPLEX_UNIT_IMMED_CB 0x0001
+/* seqnum of the callbacks the server queues for it */
+#define DUPLEX_UNIT_READ_CB_SEQNUM 969
+/* read_args/write_args: payload CRC32C wanted in the reply (READ), or
+ * given in flags2 (WRITE) */
+#define FCHAN_FLAG_CRC32C 0x0002
+
+/* read_res/write_res flags */
+#define FCHAN_RES_FLAG_BACKED 0x0001 /* served by the file backend */
+#define FCHAN_RES_FLAG_CRC32C 0x0002 /* data's CRC32C is in flags2 */
+#define FCHAN_RES_FLAG_BADCRC 0x0004 /* payload failed its CRC32C, not written */
 
 void thread_delay_ms(int ms);
 
@@ -78,6 +78,247 @@ struct write_res {
 };
 typedef struct write_res write_res;
 
+struct read64_args {
+	u_int seqnum;
+	u_int fileno;
+	u_quad_t off;
+	u_quad_t len;
+	u_int flags;
+	u_int flags2;
+	u_int flags3;
+	u_int flags4;
+};
+typedef struct read64_args read64_args;
+
+struct write64_args {
+	u_int seqnum;
+	u_int fileno;
+	u_quad_t off;
+	u_quad_t len;
+	u_int flags;
+	u_int flags2;
+	u_int flags3;
+	u_int flags4;
+	struct {
+		u_int data_len;
+		char *data_val;
+	} data;
+};
+typedef struct write64_args write64_args;
+
+#define FCHAN_STATS_NBUCKETS 160
+
+struct fchan_proc_stats {
+	u_int prog;
+	u_int proc;
+	u_quad_t calls;
+	u_quad_t errors;
+	struct {
+		u_int hist_len;
+		u_quad_t *hist_val;
+	} hist;
+};
+typedef struct fchan_proc_stats fchan_proc_stats;
+
+struct fchan_counter {
+	char *name;
+	u_quad_t value;
+};
+typedef struct fchan_counter fchan_counter;
+
+struct stats_res {
+	u_int flags;
+	struct {
+		u_int procs_len;
+		fchan_proc_stats *procs_val;
+	} procs;
+	struct {
+		u_int counters_len;
+		fchan_counter *counters_val;
+	} counters;
+};
+typedef struct stats_res stats_res;
+#define FCHAN_SESS_OK 0
+#define FCHAN_SESS_BADSESSION 1
+#define FCHAN_SESS_BADSLOT 2
+#define FCHAN_SESS_MISORDERED 3
+#define FCHAN_SESS_DELAY 4
+#define FCHAN_SESS_RETRY_UNCACHED 5
+#define FCHAN_SESS_BADPROC 6
+#define FCHAN_SESS_GARBAGE_ARGS 7
+#define FCHAN_SESS_SERVERFAULT 8
+#define FCHAN_SESS_TOOMANY 9
+#define FCHAN_SESS_NOTOWNER 10
+#define FCHAN_SESS_MAXSLOTS 128
+#define FCHAN_SESS_MAXCACHE 65536
+#define FCHAN_SESS_LEASE 90
+
+struct create_session_args {
+	u_int nslots;
+	u_int maxcache;
+	u_int flags;
+};
+typedef struct create_session_args create_session_args;
+
+struct create_session_res {
+	u_int status;
+	u_quad_t sessionid;
+	u_int nslots;
+	u_int maxcache;
+};
+typedef struct create_session_res create_session_res;
+
+struct bind_conn_args {
+	u_quad_t sessionid;
+	u_int flags;
+};
+typedef struct bind_conn_args bind_conn_args;
+
+struct sequence_args {
+	u_quad_t sessionid;
+	u_int slotid;
+	u_int seqid;
+	u_int cachethis;
+	u_int proc;
+	struct {
+		u_int args_len;
+		char *args_val;
+	} args;
+};
+typedef struct sequence_args sequence_args;
+
+struct sequence_res {
+	u_int status;
+	u_int slotid;
+	u_int seqid;
+	u_int highest_slotid;
+	struct {
+		u_int res_len;
+		char *res_val;
+	} res;
+};
+typedef struct sequence_res sequence_res;
+#define FCHAN_COMPOUND_MAXOPS 64
+#define FCHAN_COMPOUND_OK 0
+#define FCHAN_COMPOUND_OPFAILED 1
+
+enum fchan_opnum {
+	OP_SENDMSG = 1,
+	OP_READ = 3,
+	OP_WRITE = 4,
+	OP_READ64 = 13,
+	OP_WRITE64 = 14,
+};
+typedef enum fchan_opnum fchan_opnum;
+
+struct fchan_op_args {
+	fchan_opnum op;
+	union {
+		fchan_msg sendmsg;
+		read_args read;
+		write_args write;
+		read64_args read64;
+		write64_args write64;
+	} fchan_op_args_u;
+};
+typedef struct fchan_op_args fchan_op_args;
+
+struct fchan_op_res {
+	fchan_opnum op;
+	union {
+		fchan_res sendmsg;
+		read_res read;
+		write_res write;
+		read_res read64;
+		write_res write64;
+	} fchan_op_res_u;
+};
+typedef struct fchan_op_res fchan_op_res;
+
+struct compound_args {
+	u_int tag;
+	struct {
+		u_int ops_len;
+		fchan_op_args *ops_val;
+	} ops;
+};
+typedef struct compound_args compound_args;
+
+struct compound_res {
+	u_int status;
+	u_int tag;
+	struct {
+		u_int results_len;
+		fchan_op_res *results_val;
+	} results;
+};
+typedef struct compound_res compound_res;
+#define FCHAN_IOV_MAX 64
+
+struct fchan_extent {
+	u_int off;
+	u_int len;
+};
+typedef struct fchan_extent fchan_extent;
+
+struct readv_args {
+	u_int seqnum;
+	u_int fileno;
+	u_int flags;
+	struct {
+		u_int extents_len;
+		fchan_extent *extents_val;
+	} extents;
+};
+typedef struct readv_args readv_args;
+
+struct readv_res {
+	u_int eof;
+	u_int flags;
+	struct {
+		u_int lens_len;
+		u_int *lens_val;
+	} lens;
+	struct {
+		u_int data_len;
+		char *data_val;
+	} data;
+};
+typedef struct readv_res readv_res;
+
+struct writev_args {
+	u_int seqnum;
+	u_int fileno;
+	u_int flags;
+	struct {
+		u_int extents_len;
+		fchan_extent *extents_val;
+	} extents;
+	struct {
+		u_int data_len;
+		char *data_val;
+	} data;
+};
+typedef struct writev_args writev_args;
+
+struct writev_res {
+	u_int flags;
+	u_int count;
+};
+typedef struct writev_res writev_res;
+
+struct negotiate_args {
+	u_quad_t maxio;
+	u_int flags;
+};
+typedef struct negotiate_args negotiate_args;
+
+struct negotiate_res {
+	u_quad_t maxio;
+	u_int flags;
+};
+typedef struct negotiate_res negotiate_res;
+
 #define FCHAN_PROG 0x20005001
 #define FCHANV 1
 
@@ -94,6 +335,27 @@ extern  bool_t read_1_svc(read_args *, read_res *, struct svc_req *);
 #define WRITE 4
 extern  enum clnt_stat write_1(write_args *, write_res *, CLIENT *);
 extern  bool_t write_1_svc(write_args *, write_res *, struct svc_req *);
+#define STATS 5
+extern  enum clnt_stat stats_1(void *, stats_res *, CLIENT *);
+extern  bool_t stats_1_svc(void *, stats_res *, struct svc_req *);
+#define CREATE_SESSION 6
+extern  enum clnt_stat create_session_1(create_session_args *, create_session_res *, CLIENT *);
+extern  bool_t create_session_1_svc(create_session_args *, create_session_res *, struct svc_req *);
+#define DESTROY_SESSION 7
+extern  enum clnt_stat destroy_session_1(u_quad_t *, u_int *, CLIENT *);
+extern  bool_t destroy_session_1_svc(u_quad_t *, u_int *, struct svc_req *);
+#define SEQUENCE 8
+extern  enum clnt_stat sequence_1(sequence_args *, sequence_res *, CLIENT *);
+extern  bool_t sequence_1_svc(sequence_args *, sequence_res *, struct svc_req *);
+#define COMPOUND 9
+extern  enum clnt_stat compound_1(compound_args *, compound_res *, CLIENT *);
+extern  bool_t compound_1_svc(compound_args *, compound_res *, struct svc_req *);
+#define READV 10
+extern  enum clnt_stat readv_1(readv_args *, readv_res *, CLIENT *);
+extern  bool_t readv_1_svc(readv_args *, readv_res *, struct svc_req *);
+#define WRITEV 11
+extern  enum clnt_stat writev_1(writev_args *, writev_res *, CLIENT *);
+extern  bool_t writev_1_svc(writev_args *, writev_res *, struct svc_req *);
 extern int fchan_prog_1_freeresult (SVCXPRT *, xdrproc_t, caddr_t);
 
 #else /* K&R C */
@@ -109,8 +371,127 @@ extern  bool_t read_1_svc();
 #define WRITE 4
 extern  enum clnt_stat write_1();
 extern  bool_t write_1_svc();
+#define STATS 5
+extern  enum clnt_stat stats_1();
+extern  bool_t stats_1_svc();
+#define CREATE_SESSION 6
+extern  enum clnt_stat create_session_1();
+extern  bool_t create_session_1_svc();
+#define DESTROY_SESSION 7
+extern  enum clnt_stat destroy_session_1();
+extern  bool_t destroy_session_1_svc();
+#define SEQUENCE 8
+extern  enum clnt_stat sequence_1();
+extern  bool_t sequence_1_svc();
+#define COMPOUND 9
+extern  enum clnt_stat compound_1();
+extern  bool_t compound_1_svc();
+#define READV 10
+extern  enum clnt_stat readv_1();
+extern  bool_t readv_1_svc();
+#define WRITEV 11
+extern  enum clnt_stat writev_1();
+extern  bool_t writev_1_svc();
 extern int fchan_prog_1_freeresult ();
 #endif /* K&R C */
+#define FCHANV2 2
+
+#if defined(__STDC__) || defined(__cplusplus)
+#define SENDMSG1 1
+extern  enum clnt_stat sendmsg1_2(fchan_msg *, fchan_res *, CLIENT *);
+extern  bool_t sendmsg1_2_svc(fchan_msg *, fchan_res *, struct svc_req *);
+#define BIND_CONN_TO_SESSION1 2
+extern  enum clnt_stat bind_conn_to_session1_2(void *, int *, CLIENT *);
+extern  bool_t bind_conn_to_session1_2_svc(void *, int *, struct svc_req *);
+#define READ 3
+extern  enum clnt_stat read_2(read64_args *, read_res *, CLIENT *);
+extern  bool_t read_2_svc(read64_args *, read_res *, struct svc_req *);
+#define WRITE 4
+extern  enum clnt_stat write_2(write64_args *, write_res *, CLIENT *);
+extern  bool_t write_2_svc(write64_args *, write_res *, struct svc_req *);
+#define STATS 5
+extern  enum clnt_stat stats_2(void *, stats_res *, CLIENT *);
+extern  bool_t stats_2_svc(void *, stats_res *, struct svc_req *);
+#define CREATE_SESSION 6
+extern  enum clnt_stat create_session_2(create_session_args *, create_session_res *, CLIENT *);
+extern  bool_t create_session_2_svc(create_session_args *, create_session_res *, struct svc_req *);
+#define DESTROY_SESSION 7
+extern  enum clnt_stat destroy_session_2(u_quad_t *, u_int *, CLIENT *);
+extern  bool_t destroy_session_2_svc(u_quad_t *, u_int *, struct svc_req *);
+#define SEQUENCE 8
+extern  enum clnt_stat sequence_2(sequence_args *, sequence_res *, CLIENT *);
+extern  bool_t sequence_2_svc(sequence_args *, sequence_res *, struct svc_req *);
+#define COMPOUND 9
+extern  enum clnt_stat compound_2(compound_args *, compound_res *, CLIENT *);
+extern  bool_t compound_2_svc(compound_args *, compound_res *, struct svc_req *);
+#define READV 10
+extern  enum clnt_stat readv_2(readv_args *, readv_res *, CLIENT *);
+extern  bool_t readv_2_svc(readv_args *, readv_res *, struct svc_req *);
+#define WRITEV 11
+extern  enum clnt_stat writev_2(writev_args *, writev_res *, CLIENT *);
+extern  bool_t writev_2_svc(writev_args *, writev_res *, struct svc_req *);
+#define NEGOTIATE 12
+extern  enum clnt_stat negotiate_2(negotiate_args *, negotiate_res *, CLIENT *);
+extern  bool_t negotiate_2_svc(negotiate_args *, negotiate_res *, struct svc_req *);
+#define READ64 13
+extern  enum clnt_stat read64_2(read64_args *, read_res *, CLIENT *);
+extern  bool_t read64_2_svc(read64_args *, read_res *, struct svc_req *);
+#define WRITE64 14
+extern  enum clnt_stat write64_2(write64_args *, write_res *, CLIENT *);
+extern  bool_t write64_2_svc(write64_args *, write_res *, struct svc_req *);
+#define BIND_CONN_TO_SESSION 15
+extern  enum clnt_stat bind_conn_to_session_2(bind_conn_args *, u_int *, CLIENT *);
+extern  bool_t bind_conn_to_session_2_svc(bind_conn_args *, u_int *, struct svc_req *);
+extern int fchan_prog_2_freeresult (SVCXPRT *, xdrproc_t, caddr_t);
+
+#else /* K&R C */
+#define SENDMSG1 1
+extern  enum clnt_stat sendmsg1_2();
+extern  bool_t sendmsg1_2_svc();
+#define BIND_CONN_TO_SESSION1 2
+extern  enum clnt_stat bind_conn_to_session1_2();
+extern  bool_t bind_conn_to_session1_2_svc();
+#define READ 3
+extern  enum clnt_stat read_2();
+extern  bool_t read_2_svc();
+#define WRITE 4
+extern  enum clnt_stat write_2();
+extern  bool_t write_2_svc();
+#define STATS 5
+extern  enum clnt_stat stats_2();
+extern  bool_t stats_2_svc();
+#define CREATE_SESSION 6
+extern  enum clnt_stat create_session_2();
+extern  bool_t create_session_2_svc();
+#define DESTROY_SESSION 7
+extern  enum clnt_stat destroy_session_2();
+extern  bool_t destroy_session_2_svc();
+#define SEQUENCE 8
+extern  enum clnt_stat sequence_2();
+extern  bool_t sequence_2_svc();
+#define COMPOUND 9
+extern  enum clnt_stat compound_2();
+extern  bool_t compound_2_svc();
+#define READV 10
+extern  enum clnt_stat readv_2();
+extern  bool_t readv_2_svc();
+#define WRITEV 11
+extern  enum clnt_stat writev_2();
+extern  bool_t writev_2_svc();
+#define NEGOTIATE 12
+extern  enum clnt_stat negotiate_2();
+extern  bool_t negotiate_2_svc();
+#define READ64 13
+extern  enum clnt_stat read64_2();
+extern  bool_t read64_2_svc();
+#define WRITE64 14
+extern  enum clnt_stat write64_2();
+extern  bool_t write64_2_svc();
+#define BIND_CONN_TO_SESSION 15
+extern  enum clnt_stat bind_conn_to_session_2();
+extern  bool_t bind_conn_to_session_2_svc();
+extern int fchan_prog_2_freeresult ();
+#endif /* K&R C */
 
 /* the xdr functions */
 
@@ -121,6 +502,28 @@ extern  bool_t xdr_read_args (XDR *, read_args*);
 extern  bool_t xdr_read_res (XDR *, read_res*);
 extern  bool_t xdr_write_args (XDR *, write_args*);
 extern  bool_t xdr_write_res (XDR *, write_res*);
+extern  bool_t xdr_read64_args (XDR *, read64_args*);
+extern  bool_t xdr_write64_args (XDR *, write64_args*);
+extern  bool_t xdr_fchan_proc_stats (XDR *, fchan_proc_stats*);
+extern  bool_t xdr_fchan_counter (XDR *, fchan_counter*);
+extern  bool_t xdr_stats_res (XDR *, stats_res*);
+extern  bool_t xdr_create_session_args (XDR *, create_session_args*);
+extern  bool_t xdr_create_session_res (XDR *, create_session_res*);
+extern  bool_t xdr_bind_conn_args (XDR *, bind_conn_args*);
+extern  bool_t xdr_sequence_args (XDR *, sequence_args*);
+extern  bool_t xdr_sequence_res (XDR *, sequence_res*);
+extern  bool_t xdr_fchan_opnum (XDR *, fchan_opnum*);
+extern  bool_t xdr_fchan_op_args (XDR *, fchan_op_args*);
+extern  bool_t xdr_fchan_op_res (XDR *, fchan_op_res*);
+extern  bool_t xdr_compound_args (XDR *, compound_args*);
+extern  bool_t xdr_compound_res (XDR *, compound_res*);
+extern  bool_t xdr_fchan_extent (XDR *, fchan_extent*);
+extern  bool_t xdr_readv_args (XDR *, readv_args*);
+extern  bool_t xdr_readv_res (XDR *, readv_res*);
+extern  bool_t xdr_writev_args (XDR *, writev_args*);
+extern  bool_t xdr_writev_res (XDR *, writev_res*);
+extern  bool_t xdr_negotiate_args (XDR *, negotiate_args*);
+extern  bool_t xdr_negotiate_res (XDR *, negotiate_res*);
 
 #else /* K&R C */
 extern bool_t xdr_fchan_msg ();
@@ -129,6 +532,28 @@ extern bool_t xdr_read_args ();
 extern bool_t xdr_read_res ();
 extern bool_t xdr_write_args ();
 extern bool_t xdr_write_res ();
+extern bool_t xdr_read64_args ();
+extern bool_t xdr_write64_args ();
+extern bool_t xdr_fchan_proc_stats ();
+extern bool_t xdr_fchan_counter ();
+extern bool_t xdr_stats_res ();
+extern bool_t xdr_create_session_args ();
+extern bool_t xdr_create_session_res ();
+extern bool_t xdr_bind_conn_args ();
+extern bool_t xdr_sequence_args ();
+extern bool_t xdr_sequence_res ();
+extern bool_t xdr_fchan_opnum ();
+extern bool_t xdr_fchan_op_args ();
+extern bool_t xdr_fchan_op_res ();
+extern bool_t xdr_compound_args ();
+extern bool_t xdr_compound_res ();
+extern bool_t xdr_fchan_extent ();
+extern bool_t xdr_readv_args ();
+extern bool_t xdr_readv_res ();
+extern bool_t xdr_writev_args ();
+extern bool_t xdr_writev_res ();
+extern bool_t xdr_negotiate_args ();
+extern bool_t xdr_negotiate_res ();
 
 #endif /* K&R C */
 
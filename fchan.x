@@ -50,6 +50,220 @@ struct write_res {
        unsigned int flags4;
 };
 
+/* READ and WRITE in version 2, with 64-bit offsets and lengths */
+struct read64_args {
+       unsigned int seqnum;
+       unsigned int fileno; /* degenerate fh */
+       unsigned hyper off;
+       unsigned hyper len;
+       unsigned int flags;
+       unsigned int flags2;
+       unsigned int flags3;
+       unsigned int flags4;
+};
+
+struct write64_args {
+       unsigned int seqnum;
+       unsigned int fileno; /* degenerate fh */
+       unsigned hyper off;
+       unsigned hyper len;
+       unsigned int flags;
+       unsigned int flags2;
+       unsigned int flags3;
+       unsigned int flags4;
+       opaque data<>;
+};
+
+/* server statistics */
+
+const FCHAN_STATS_NBUCKETS = 160; /* latency buckets, see fchan_stats.h */
+
+struct fchan_proc_stats {
+       unsigned int prog;
+       unsigned int proc;
+       unsigned hyper calls;
+       unsigned hyper errors;
+       unsigned hyper hist<FCHAN_STATS_NBUCKETS>; /* trailing zeros trimmed */
+};
+
+struct fchan_counter {
+       string name<64>;
+       unsigned hyper value;
+};
+
+struct stats_res {
+       unsigned int flags;
+       fchan_proc_stats procs<>;
+       fchan_counter counters<>;
+};
+
+/* sessions: a client creates a session with some number of slots and
+ * sends its calls through SEQUENCE on them, one outstanding call per
+ * slot.  The server remembers the last reply on each slot, so a
+ * retransmission on the same slot and seqid is answered from there.
+ * A session outlives its connections by FCHAN_SESS_LEASE seconds; the
+ * client that made it may reconnect and BIND_CONN_TO_SESSION (version
+ * 2) to carry on in it, replays included. */
+const FCHAN_SESS_OK = 0;
+const FCHAN_SESS_BADSESSION = 1;
+const FCHAN_SESS_BADSLOT = 2;
+const FCHAN_SESS_MISORDERED = 3;
+const FCHAN_SESS_DELAY = 4;          /* replay of a call still running */
+const FCHAN_SESS_RETRY_UNCACHED = 5; /* replay, but cachethis was 0 */
+const FCHAN_SESS_BADPROC = 6;
+const FCHAN_SESS_GARBAGE_ARGS = 7;
+const FCHAN_SESS_SERVERFAULT = 8;
+const FCHAN_SESS_TOOMANY = 9;
+const FCHAN_SESS_NOTOWNER = 10;      /* made by another client */
+
+const FCHAN_SESS_MAXSLOTS = 128;
+const FCHAN_SESS_MAXCACHE = 65536; /* encoded reply bytes per slot */
+const FCHAN_SESS_LEASE = 90; /* seconds kept with no connection bound */
+
+struct create_session_args {
+       unsigned int nslots;
+       unsigned int maxcache;
+       unsigned int flags;
+};
+
+struct create_session_res {
+       unsigned int status;
+       unsigned hyper sessionid;
+       unsigned int nslots;   /* granted */
+       unsigned int maxcache; /* granted */
+};
+
+struct bind_conn_args {
+       unsigned hyper sessionid;
+       unsigned int flags;
+};
+
+/* args is the XDR encoded argument of proc (SENDMSG1, READ, WRITE,
+ * COMPOUND, READV or WRITEV), res its encoded result */
+struct sequence_args {
+       unsigned hyper sessionid;
+       unsigned int slotid;
+       unsigned int seqid;
+       unsigned int cachethis;
+       unsigned int proc;
+       opaque args<>;
+};
+
+struct sequence_res {
+       unsigned int status;
+       unsigned int slotid;
+       unsigned int seqid;
+       unsigned int highest_slotid;
+       opaque res<>;
+};
+
+/* COMPOUND runs its ops in order and stops at the first that fails;
+ * results has one entry per op run, the failed one last */
+const FCHAN_COMPOUND_MAXOPS = 64;
+const FCHAN_COMPOUND_OK = 0;
+const FCHAN_COMPOUND_OPFAILED = 1;
+
+/* same numbers as the procedures */
+enum fchan_opnum {
+       OP_SENDMSG = 1,
+       OP_READ = 3,
+       OP_WRITE = 4,
+       OP_READ64 = 13,
+       OP_WRITE64 = 14
+};
+
+union fchan_op_args switch (fchan_opnum op) {
+case OP_SENDMSG:
+       fchan_msg sendmsg;
+case OP_READ:
+       read_args read;
+case OP_WRITE:
+       write_args write;
+case OP_READ64:
+       read64_args read64;
+case OP_WRITE64:
+       write64_args write64;
+};
+
+union fchan_op_res switch (fchan_opnum op) {
+case OP_SENDMSG:
+       fchan_res sendmsg;
+case OP_READ:
+       read_res read;
+case OP_WRITE:
+       write_res write;
+case OP_READ64:
+       read_res read64;
+case OP_WRITE64:
+       write_res write64;
+};
+
+struct compound_args {
+       unsigned int tag;
+       fchan_op_args ops<FCHAN_COMPOUND_MAXOPS>;
+};
+
+struct compound_res {
+       unsigned int status;
+       unsigned int tag;
+       fchan_op_res results<FCHAN_COMPOUND_MAXOPS>;
+};
+
+/* vectored I/O: one call covers several extents of a file.  READV
+ * returns the extents' data back to back in data, with the length of
+ * each (short past end of file) in lens; WRITEV takes its data the
+ * same way, and the extents' lengths must add up to data's. */
+const FCHAN_IOV_MAX = 64;
+
+struct fchan_extent {
+       unsigned int off;
+       unsigned int len;
+};
+
+struct readv_args {
+       unsigned int seqnum;
+       unsigned int fileno; /* degenerate fh */
+       unsigned int flags;
+       fchan_extent extents<FCHAN_IOV_MAX>;
+};
+
+struct readv_res {
+       unsigned int eof; /* some extent ran past end of file */
+       unsigned int flags;
+       unsigned int lens<FCHAN_IOV_MAX>;
+       opaque data<>;
+};
+
+struct writev_args {
+       unsigned int seqnum;
+       unsigned int fileno; /* degenerate fh */
+       unsigned int flags;
+       fchan_extent extents<FCHAN_IOV_MAX>;
+       opaque data<>;
+};
+
+struct writev_res {
+       unsigned int flags;
+       unsigned int count; /* bytes written */
+};
+
+/* version 2: everything in version 1, with 64-bit offsets and lengths
+ * for READ and WRITE.  A client sends NEGOTIATE first with the largest
+ * transfer it means to make, and the server grants at most its own
+ * limit (-x); reads and writes on that connection are then held to the
+ * grant, or to the server's limit if there was none.  READ64 and
+ * WRITE64 are the same as READ and WRITE in version 2.  Procedures keep
+ * version 1's numbers, so one dispatcher serves both. */
+struct negotiate_args {
+       unsigned hyper maxio; /* 0 takes the server's limit */
+       unsigned int flags;
+};
+
+struct negotiate_res {
+       unsigned hyper maxio; /* granted */
+       unsigned int flags;
+};
+
 program FCHAN_PROG {
 	version FCHANV {
             fchan_res SENDMSG1(fchan_msg) = 1;
@@ -57,5 +271,29 @@ program FCHAN_PROG {
 	    /* read and write simulation */
 	    read_res READ(read_args) = 3;
 	    write_res WRITE(write_args) = 4;	    
+	    stats_res STATS(void) = 5;
+	    create_session_res CREATE_SESSION(create_session_args) = 6;
+	    unsigned int DESTROY_SESSION(unsigned hyper) = 7;
+	    sequence_res SEQUENCE(sequence_args) = 8;
+	    compound_res COMPOUND(compound_args) = 9;
+	    readv_res READV(readv_args) = 10;
+	    writev_res WRITEV(writev_args) = 11;
 	} = 1;
+	version FCHANV2 {
+            fchan_res SENDMSG1(fchan_msg) = 1;
+	    int BIND_CONN_TO_SESSION1(void) = 2;
+	    read_res READ(read64_args) = 3;
+	    write_res WRITE(write64_args) = 4;
+	    stats_res STATS(void) = 5;
+	    create_session_res CREATE_SESSION(create_session_args) = 6;
+	    unsigned int DESTROY_SESSION(unsigned hyper) = 7;
+	    sequence_res SEQUENCE(sequence_args) = 8;
+	    compound_res COMPOUND(compound_args) = 9;
+	    readv_res READV(readv_args) = 10;
+	    writev_res WRITEV(writev_args) = 11;
+	    negotiate_res NEGOTIATE(negotiate_args) = 12;
+	    read_res READ64(read64_args) = 13;
+	    write_res WRITE64(write64_args) = 14;
+	    unsigned int BIND_CONN_TO_SESSION(bind_conn_args) = 15;
+	} = 2;
 } = 0x20005001;
@@ -0,0 +1,378 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fchan_arena.h"
+
+/* a malloc'd allocation that didn't fit, freed on reset; the header
+ * keeps the data 16-byte aligned */
+struct arena_big {
+    struct arena_big *next;
+    uint64_t pad;
+};
+
+/* a payload borrowed from the decode buffer; lives in the arena */
+struct arena_ref {
+    struct arena_ref *next;
+    void *p;
+};
+
+struct fchan_arena {
+    struct fchan_objcache_obj obj; /* the thread cache it came from */
+    size_t off;
+    struct arena_big *big;
+    struct arena_ref *refs;
+    bool_t borrow;
+    uint64_t base[FCHAN_ARENA_SIZE / sizeof(uint64_t)];
+};
+
+/* per-thread arena cache, as the request pool's; see fchan_objcache.h */
+static struct fchan_objcache_pool arena_pool =
+    FCHAN_OBJCACHE_POOL_INIT(struct fchan_arena, obj, FCHAN_ARENA_MAX);
+
+/* our counters, kept with each thread's cache */
+enum {
+    ARENA_ALLOCS,
+    ARENA_OVERFLOWS,
+    ARENA_BORROWED,
+    ARENA_BORROWED_BYTES,
+};
+
+static __thread struct fchan_arena *arena_cur = NULL;
+
+static inline void
+arena_count(int which, uint64_t n)
+{
+    uint64_t *extra = fchan_objcache_extra(&arena_pool);
+
+    if (extra)
+        extra[which] += n;
+}
+
+struct fchan_arena *
+fchan_arena_get(void)
+{
+    struct fchan_arena *arena;
+
+    arena = fchan_objcache_get(&arena_pool);
+    if (! arena)
+        return (NULL);
+    arena->off = 0;
+    arena->big = NULL;
+    arena->refs = NULL;
+    arena->borrow = FALSE;
+
+    return (arena);
+}
+
+void
+fchan_arena_put(struct fchan_arena *arena)
+{
+    struct arena_big *big;
+
+    /* the reset; refs are in the bump space, and what they point to
+     * was never ours */
+    while ((big = arena->big)) {
+        arena->big = big->next;
+        free(big);
+    }
+    fchan_objcache_put(&arena_pool, arena);
+}
+
+struct fchan_arena *
+fchan_arena_set(struct fchan_arena *arena)
+{
+    struct fchan_arena *prev = arena_cur;
+
+    arena_cur = arena;
+    return (prev);
+}
+
+void
+fchan_arena_borrow(struct fchan_arena *arena, bool_t borrow)
+{
+    arena->borrow = borrow;
+}
+
+static void *
+arena_alloc(struct fchan_arena *arena, size_t len)
+{
+    struct arena_big *big;
+    void *p;
+
+    len = (len + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+    if (len <= FCHAN_ARENA_SIZE - arena->off) {
+        p = (char *) arena->base + arena->off;
+        arena->off += len;
+        arena_count(ARENA_ALLOCS, 1);
+        return (p);
+    }
+
+    big = malloc(sizeof(struct arena_big) + len);
+    if (! big)
+        return (NULL);
+    big->next = arena->big;
+    arena->big = big;
+    arena_count(ARENA_OVERFLOWS, 1);
+
+    return (big + 1);
+}
+
+static bool_t
+arena_owns(struct fchan_arena *arena, void *p)
+{
+    struct arena_big *big;
+    struct arena_ref *ref;
+
+    if (((char *) p >= (char *) arena->base)
+        && ((char *) p < (char *) arena->base + FCHAN_ARENA_SIZE))
+        return (TRUE);
+    for (big = arena->big; big; big = big->next)
+        if (p == (void *) (big + 1))
+            return (TRUE);
+    for (ref = arena->refs; ref; ref = ref->next)
+        if (p == ref->p)
+            return (TRUE);
+    return (FALSE);
+}
+
+void *
+fchan_arena_alloc(size_t len)
+{
+    if (! arena_cur)
+        return (malloc(len));
+    return (arena_alloc(arena_cur, len));
+}
+
+void *
+fchan_arena_calloc(size_t n, size_t size)
+{
+    void *p;
+
+    if (! arena_cur)
+        return (calloc(n, size));
+    if (size && (n > SIZE_MAX / size))
+        return (NULL);
+    if ((p = arena_alloc(arena_cur, n * size)))
+        memset(p, 0, n * size);
+    return (p);
+}
+
+char *
+fchan_arena_strdup(const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *p;
+
+    if (! arena_cur)
+        return (strdup(s));
+    if ((p = arena_alloc(arena_cur, len)))
+        memcpy(p, s, len);
+    return (p);
+}
+
+void
+fchan_arena_free(void *p)
+{
+    if (p && arena_cur && arena_owns(arena_cur, p))
+        return;
+    free(p);
+}
+
+bool_t
+fchan_xdr_string(XDR *xdrs, char **cpp, u_int maxsize)
+{
+    struct fchan_arena *arena = arena_cur;
+    u_int size;
+
+    if (! arena)
+        return (xdr_string(xdrs, cpp, maxsize));
+
+    switch (xdrs->x_op) {
+    case XDR_DECODE:
+        if (*cpp)
+            break; /* caller's buffer */
+        if (! xdr_u_int(xdrs, &size))
+            return (FALSE);
+        if ((size > maxsize) || (size + 1 == 0))
+            return (FALSE);
+        if (! (*cpp = arena_alloc(arena, size + 1)))
+            return (FALSE);
+        (*cpp)[size] = '\0';
+        return (xdr_opaque(xdrs, *cpp, size));
+    case XDR_FREE:
+        if (*cpp && arena_owns(arena, *cpp)) {
+            *cpp = NULL;
+            return (TRUE);
+        }
+        break;
+    default:
+        break;
+    }
+
+    return (xdr_string(xdrs, cpp, maxsize));
+}
+
+bool_t
+fchan_xdr_bytes(XDR *xdrs, char **cpp, u_int *sizep, u_int maxsize)
+{
+    struct fchan_arena *arena = arena_cur;
+
+    if (! arena)
+        return (xdr_bytes(xdrs, cpp, sizep, maxsize));
+
+    switch (xdrs->x_op) {
+    case XDR_DECODE:
+        if (*cpp)
+            break;
+        if (! xdr_u_int(xdrs, sizep))
+            return (FALSE);
+        if (*sizep > maxsize)
+            return (FALSE);
+        if (*sizep == 0)
+            return (TRUE);
+        if (! (*cpp = arena_alloc(arena, *sizep)))
+            return (FALSE);
+        return (xdr_opaque(xdrs, *cpp, *sizep));
+    case XDR_FREE:
+        if (*cpp && arena_owns(arena, *cpp)) {
+            *cpp = NULL;
+            return (TRUE);
+        }
+        break;
+    default:
+        break;
+    }
+
+    return (xdr_bytes(xdrs, cpp, sizep, maxsize));
+}
+
+/* Leave the payload in the decode buffer if it's all there, holding a
+ * reference in the arena so free walks step over it.  Otherwise it's
+ * copied, as fchan_xdr_bytes would. */
+bool_t
+fchan_xdr_payload(XDR *xdrs, char **cpp, u_int *sizep, u_int maxsize)
+{
+    struct fchan_arena *arena = arena_cur;
+    struct arena_ref *ref;
+    int32_t *buf = NULL;
+    u_int rndup;
+
+    if (! arena || ! arena->borrow || (xdrs->x_op != XDR_DECODE) || *cpp)
+        return (fchan_xdr_bytes(xdrs, cpp, sizep, maxsize));
+
+    if (! xdr_u_int(xdrs, sizep))
+        return (FALSE);
+    if (*sizep > maxsize)
+        return (FALSE);
+    if (*sizep == 0)
+        return (TRUE);
+
+    rndup = *sizep + ((BYTES_PER_XDR_UNIT - (*sizep % BYTES_PER_XDR_UNIT))
+                      % BYTES_PER_XDR_UNIT);
+    if ((*sizep >= FCHAN_ARENA_BORROW_MIN) && (rndup >= *sizep))
+        buf = XDR_INLINE(xdrs, rndup);
+    if (! buf) {
+        /* short, or not all in the buffer */
+        if (! (*cpp = arena_alloc(arena, *sizep)))
+            return (FALSE);
+        return (xdr_opaque(xdrs, *cpp, *sizep));
+    }
+
+    if (! (ref = arena_alloc(arena, sizeof(struct arena_ref))))
+        return (FALSE);
+    ref->p = *cpp = (char *) buf;
+    ref->next = arena->refs;
+    arena->refs = ref;
+
+    arena_count(ARENA_BORROWED, 1);
+    arena_count(ARENA_BORROWED_BYTES, *sizep);
+
+    return (TRUE);
+}
+
+bool_t
+fchan_xdr_array(XDR *xdrs, char **addrp, u_int *sizep, u_int maxsize,
+                u_int elsize, xdrproc_t elproc)
+{
+    struct fchan_arena *arena = arena_cur;
+    char *target;
+    u_int ix;
+
+    if (! arena)
+        return (xdr_array(xdrs, addrp, sizep, maxsize, elsize, elproc));
+
+    switch (xdrs->x_op) {
+    case XDR_DECODE:
+        if (*addrp)
+            break;
+        if (! xdr_u_int(xdrs, sizep))
+            return (FALSE);
+        if ((*sizep > maxsize) || (*sizep > UINT32_MAX / elsize))
+            return (FALSE);
+        if (*sizep == 0)
+            return (TRUE);
+        if (! (*addrp = arena_alloc(arena, *sizep * elsize)))
+            return (FALSE);
+        memset(*addrp, 0, *sizep * elsize);
+        for (target = *addrp, ix = 0; ix < *sizep; ++ix, target += elsize)
+            if (! (*elproc)(xdrs, target, ~0))
+                return (FALSE);
+        return (TRUE);
+    case XDR_FREE:
+        if (*addrp && arena_owns(arena, *addrp)) {
+            /* elements may still hold malloc'd memory */
+            for (target = *addrp, ix = 0; ix < *sizep; ++ix, target += elsize)
+                (void) (*elproc)(xdrs, target, ~0);
+            *addrp = NULL;
+            return (TRUE);
+        }
+        break;
+    default:
+        break;
+    }
+
+    return (xdr_array(xdrs, addrp, sizep, maxsize, elsize, elproc));
+}
+
+void
+fchan_arena_stats(struct fchan_arena_stats *st)
+{
+    struct fchan_objcache_stats ost;
+    uint64_t extra[FCHAN_OBJCACHE_NEXTRA];
+
+    fchan_objcache_stats(&arena_pool, &ost, extra);
+    st->hits = ost.hits;
+    st->misses = ost.misses;
+    st->frees = ost.frees;
+    st->remote = ost.remote;
+    st->allocs = extra[ARENA_ALLOCS];
+    st->overflows = extra[ARENA_OVERFLOWS];
+    st->borrowed = extra[ARENA_BORROWED];
+    st->borrowed_bytes = extra[ARENA_BORROWED_BYTES];
+}
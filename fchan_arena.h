@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_ARENA_H
+#define FCHAN_ARENA_H
+
+#include <stdint.h>
+#include <rpc/rpc.h>
+
+#include "fchan_objcache.h"
+
+/*
+ * Per-call bump allocator.  A call takes an arena from its thread's
+ * cache before decoding, its arguments and results are carved out of
+ * it, and the whole thing is reset at once after the reply is sent,
+ * instead of being freed piecewise by an XDR_FREE walk.  Anything that
+ * doesn't fit in what's left is malloc'd and chained to the arena, and
+ * goes away with the same reset.
+ *
+ * Allocation finds the arena through the calling thread's current one
+ * (fchan_arena_set).  With none set, everything below is plain malloc
+ * and free, which is what clients and the UDP threads get.
+ *
+ * An arena may also be allowed to borrow: large payloads are then left
+ * where they are in the buffer they were decoded from, and the arena
+ * only holds a reference until the reset.  That's for a caller who
+ * knows the buffer stays put until then.
+ */
+
+/* bytes of bump space per arena */
+#define FCHAN_ARENA_SIZE (128 * 1024)
+
+/* max arenas cached per thread before we give them back to malloc */
+#define FCHAN_ARENA_MAX 8
+
+/* smaller payloads are copied even when borrowing is allowed */
+#define FCHAN_ARENA_BORROW_MIN 4096
+
+struct fchan_arena;
+
+struct fchan_arena_stats {
+    uint64_t hits;      /* arena served from the thread cache */
+    uint64_t misses;    /* had to malloc an arena */
+    uint64_t frees;     /* cache full, returned to malloc */
+    uint64_t allocs;    /* bumped from an arena */
+    uint64_t overflows; /* too big for what was left, malloc'd */
+    uint64_t borrowed;  /* payloads left in the decode buffer */
+    uint64_t borrowed_bytes;
+    uint64_t remote;    /* put back by another thread */
+};
+
+/* NULL if out of memory */
+struct fchan_arena *fchan_arena_get(void);
+/* resets the arena; may be called on another thread than the get, and
+ * it goes back to the getting thread's cache */
+void fchan_arena_put(struct fchan_arena *arena);
+
+/* make arena the calling thread's current one, returning the previous */
+struct fchan_arena *fchan_arena_set(struct fchan_arena *arena);
+
+/* let fchan_xdr_payload point into the decode buffer, until the reset */
+void fchan_arena_borrow(struct fchan_arena *arena, bool_t borrow);
+
+void *fchan_arena_alloc(size_t len);
+void *fchan_arena_calloc(size_t n, size_t size);
+char *fchan_arena_strdup(const char *s);
+/* a no-op for memory from the current arena */
+void fchan_arena_free(void *p);
+
+/* drop-in for the xdr_ primitives that allocate on decode; decode into
+ * the current arena, and skip its memory on XDR_FREE */
+bool_t fchan_xdr_string(XDR *xdrs, char **cpp, u_int maxsize);
+bool_t fchan_xdr_bytes(XDR *xdrs, char **cpp, u_int *sizep, u_int maxsize);
+bool_t fchan_xdr_array(XDR *xdrs, char **addrp, u_int *sizep, u_int maxsize,
+                       u_int elsize, xdrproc_t elproc);
+/* fchan_xdr_bytes for bulk data, which may be borrowed */
+bool_t fchan_xdr_payload(XDR *xdrs, char **cpp, u_int *sizep, u_int maxsize);
+
+void fchan_arena_stats(struct fchan_arena_stats *st);
+
+#endif /* FCHAN_ARENA_H */
@@ -0,0 +1,384 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/param.h>
+
+#include "fchan_backend.h"
+#include "fchan_lru.h"
+
+#define FDCACHE_NBUCKETS 256
+
+struct fchan_backend_file {
+    uint32_t fileno;
+    int fd;
+    uint32_t refcnt;
+    struct fchan_backend_file *hnext;
+    struct fchan_lru_link lru;
+};
+
+static struct {
+    char *export_dir;
+    uint32_t max_fds;
+    uint32_t nfds;
+    pthread_mutex_t mtx;
+    struct fchan_backend_file *buckets[FDCACHE_NBUCKETS];
+    struct fchan_lru lru;
+    struct fchan_backend_stats st;
+} fdc = {
+    NULL, FCHAN_BACKEND_MAX_FDS, 0,
+    PTHREAD_MUTEX_INITIALIZER
+};
+
+static void
+hash_remove(struct fchan_backend_file *fe)
+{
+    struct fchan_backend_file **fep = &fdc.buckets[fe->fileno % FDCACHE_NBUCKETS];
+
+    for (; *fep; fep = &(*fep)->hnext) {
+        if (*fep == fe) {
+            *fep = fe->hnext;
+            break;
+        }
+    }
+}
+
+/* with fdc.mtx held; in-use entries are skipped, so we can briefly run
+ * over max_fds under load */
+static void
+fdcache_evict(void)
+{
+    struct fchan_backend_file *fe, *prev;
+
+    for (fe = fchan_lru_entry(fdc.lru.tail, struct fchan_backend_file, lru);
+         fe && fdc.nfds >= fdc.max_fds; fe = prev) {
+        prev = fchan_lru_entry(fe->lru.prev, struct fchan_backend_file, lru);
+        if (fe->refcnt)
+            continue;
+        fchan_lru_unlink(&fdc.lru, &fe->lru);
+        hash_remove(fe);
+        --(fdc.nfds);
+        ++(fdc.st.fd_evictions);
+        close(fe->fd);
+        free(fe);
+    }
+}
+
+static struct fchan_backend_file *
+fdcache_get(uint32_t fileno)
+{
+    struct fchan_backend_file *fe, *nfe;
+    char path[PATH_MAX];
+    int fd;
+
+    if (fileno >= FCHAN_BACKEND_MAX_FILES) {
+        errno = EINVAL;
+        return (NULL);
+    }
+
+    pthread_mutex_lock(&fdc.mtx);
+    for (fe = fdc.buckets[fileno % FDCACHE_NBUCKETS]; fe; fe = fe->hnext) {
+        if (fe->fileno == fileno) {
+            ++(fe->refcnt);
+            fchan_lru_touch(&fdc.lru, &fe->lru);
+            ++(fdc.st.fd_hits);
+            pthread_mutex_unlock(&fdc.mtx);
+            return (fe);
+        }
+    }
+    ++(fdc.st.fd_misses);
+    pthread_mutex_unlock(&fdc.mtx);
+
+    /* open outside the lock */
+    snprintf(path, PATH_MAX, "%s/%u", fdc.export_dir, fileno);
+    fd = open(path, O_RDWR|O_CREAT, 0644);
+    if (fd < 0)
+        return (NULL);
+
+    nfe = calloc(1, sizeof(struct fchan_backend_file));
+    if (! nfe) {
+        close(fd);
+        errno = ENOMEM;
+        return (NULL);
+    }
+
+    pthread_mutex_lock(&fdc.mtx);
+    /* lost a race to open the same file? */
+    for (fe = fdc.buckets[fileno % FDCACHE_NBUCKETS]; fe; fe = fe->hnext) {
+        if (fe->fileno == fileno) {
+            ++(fe->refcnt);
+            pthread_mutex_unlock(&fdc.mtx);
+            close(fd);
+            free(nfe);
+            return (fe);
+        }
+    }
+
+    if (fdc.nfds >= fdc.max_fds)
+        fdcache_evict();
+
+    fe = nfe;
+    fe->fileno = fileno;
+    fe->fd = fd;
+    fe->refcnt = 1;
+    fe->hnext = fdc.buckets[fileno % FDCACHE_NBUCKETS];
+    fdc.buckets[fileno % FDCACHE_NBUCKETS] = fe;
+    fchan_lru_push(&fdc.lru, &fe->lru);
+    ++(fdc.nfds);
+    pthread_mutex_unlock(&fdc.mtx);
+
+    return (fe);
+}
+
+static void
+fdcache_put(struct fchan_backend_file *fe)
+{
+    pthread_mutex_lock(&fdc.mtx);
+    --(fe->refcnt);
+    if (fdc.nfds > fdc.max_fds)
+        fdcache_evict();
+    pthread_mutex_unlock(&fdc.mtx);
+}
+
+struct fchan_backend_file *
+fchan_backend_get(uint32_t fileno)
+{
+    return (fdcache_get(fileno));
+}
+
+int
+fchan_backend_fd(struct fchan_backend_file *fe)
+{
+    return (fe->fd);
+}
+
+void
+fchan_backend_put(struct fchan_backend_file *fe)
+{
+    fdcache_put(fe);
+}
+
+int
+fchan_backend_init(const char *export_dir, uint32_t max_fds)
+{
+    if (access(export_dir, R_OK|W_OK|X_OK) != 0)
+        return (errno);
+
+    fdc.export_dir = strdup(export_dir);
+    if (max_fds)
+        fdc.max_fds = max_fds;
+
+    return (0);
+}
+
+void
+fchan_backend_shutdown(void)
+{
+    struct fchan_backend_file *fe;
+
+    pthread_mutex_lock(&fdc.mtx);
+    while ((fe = fchan_lru_entry(fdc.lru.head, struct fchan_backend_file,
+                                 lru))) {
+        fchan_lru_unlink(&fdc.lru, &fe->lru);
+        hash_remove(fe);
+        close(fe->fd);
+        free(fe);
+    }
+    fdc.nfds = 0;
+    free(fdc.export_dir);
+    fdc.export_dir = NULL;
+    pthread_mutex_unlock(&fdc.mtx);
+}
+
+bool
+fchan_backend_enabled(void)
+{
+    return (fdc.export_dir != NULL);
+}
+
+/* whole-range transfers on fd; a read stops short only at end of file */
+static ssize_t
+pread_full(int fd, char *buf, uint32_t len, uint64_t off, bool *eof)
+{
+    ssize_t n, nread = 0;
+
+    while (nread < len) {
+        n = pread(fd, buf + nread, len - nread, off + nread);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return (-1);
+        }
+        if (n == 0) {
+            *eof = true;
+            break;
+        }
+        nread += n;
+    }
+    return (nread);
+}
+
+static ssize_t
+pwrite_full(int fd, const char *buf, uint32_t len, uint64_t off)
+{
+    ssize_t n, nwritten = 0;
+
+    while (nwritten < len) {
+        n = pwrite(fd, buf + nwritten, len - nwritten, off + nwritten);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return (-1);
+        }
+        nwritten += n;
+    }
+    return (nwritten);
+}
+
+/* extents [ix, return) continue one another in the file */
+static uint32_t
+extent_run(const struct fchan_backend_extent *ext, uint32_t ix, uint32_t n,
+           uint64_t *len)
+{
+    uint64_t end = ext[ix].off + ext[ix].len;
+
+    *len = ext[ix].len;
+    for (++ix; (ix < n) && (ext[ix].off == end)
+             && (*len + ext[ix].len <= FCHAN_BACKEND_MAXIO); ++ix) {
+        end += ext[ix].len;
+        *len += ext[ix].len;
+    }
+    return (ix);
+}
+
+ssize_t
+fchan_backend_read(uint32_t fileno, uint64_t off, uint32_t len, char *buf,
+                   bool *eof)
+{
+    struct fchan_backend_file *fe;
+    ssize_t nread;
+
+    fe = fdcache_get(fileno);
+    if (! fe)
+        return (-1);
+
+    *eof = false;
+    nread = pread_full(fe->fd, buf, len, off, eof);
+
+    fdcache_put(fe);
+    return (nread);
+}
+
+ssize_t
+fchan_backend_write(uint32_t fileno, uint64_t off, uint32_t len,
+                    const char *buf)
+{
+    struct fchan_backend_file *fe;
+    ssize_t nwritten;
+
+    fe = fdcache_get(fileno);
+    if (! fe)
+        return (-1);
+
+    nwritten = pwrite_full(fe->fd, buf, len, off);
+
+    fdcache_put(fe);
+    return (nwritten);
+}
+
+ssize_t
+fchan_backend_readv(uint32_t fileno, const struct fchan_backend_extent *ext,
+                    uint32_t n, char *buf, uint32_t *lens, bool *eof)
+{
+    struct fchan_backend_file *fe;
+    uint32_t ix, jx, next;
+    uint64_t len, left;
+    ssize_t nread, total = 0;
+
+    fe = fdcache_get(fileno);
+    if (! fe)
+        return (-1);
+
+    *eof = false;
+    for (ix = 0; ix < n; ix = next) {
+        next = extent_run(ext, ix, n, &len);
+        nread = pread_full(fe->fd, buf + total, len, ext[ix].off, eof);
+        if (nread < 0) {
+            total = -1;
+            break;
+        }
+        /* a short run is cut at end of file, so only its tail is short */
+        for (left = nread, jx = ix; jx < next; ++jx) {
+            lens[jx] = MIN(left, ext[jx].len);
+            left -= lens[jx];
+        }
+        total += nread;
+    }
+
+    fdcache_put(fe);
+    return (total);
+}
+
+ssize_t
+fchan_backend_writev(uint32_t fileno, const struct fchan_backend_extent *ext,
+                     uint32_t n, const char *buf)
+{
+    struct fchan_backend_file *fe;
+    uint32_t ix, next;
+    uint64_t len;
+    ssize_t nwritten, total = 0;
+
+    fe = fdcache_get(fileno);
+    if (! fe)
+        return (-1);
+
+    for (ix = 0; ix < n; ix = next) {
+        next = extent_run(ext, ix, n, &len);
+        nwritten = pwrite_full(fe->fd, buf + total, len, ext[ix].off);
+        if (nwritten < 0) {
+            total = -1;
+            break;
+        }
+        total += nwritten;
+    }
+
+    fdcache_put(fe);
+    return (total);
+}
+
+void
+fchan_backend_stats(struct fchan_backend_stats *st)
+{
+    pthread_mutex_lock(&fdc.mtx);
+    *st = fdc.st;
+    pthread_mutex_unlock(&fdc.mtx);
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FCHAN_BACKEND_H
+#define FCHAN_BACKEND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*
+ * File-backed READ/WRITE engine.  fileno N is the file <export>/N,
+ * created on first use.  Open descriptors are kept in a small cache
+ * with LRU eviction.
+ */
+
+#define FCHAN_BACKEND_MAX_FDS 128
+
+/* filenos past this are refused (EINVAL), so clients can't create
+ * files in the export without bound */
+#define FCHAN_BACKEND_MAX_FILES 1024
+
+/* largest single transfer we'll allocate for */
+#define FCHAN_BACKEND_MAXIO (1024 * 1024)
+
+struct fchan_backend_stats {
+    uint64_t fd_hits;
+    uint64_t fd_misses;
+    uint64_t fd_evictions;
+};
+
+int fchan_backend_init(const char *export_dir, uint32_t max_fds);
+void fchan_backend_shutdown(void);
+bool fchan_backend_enabled(void);
+
+/* return bytes transferred, or -1 with errno set */
+ssize_t fchan_backend_read(uint32_t fileno, uint64_t off, uint32_t len,
+                           char *buf, bool *eof);
+ssize_t fchan_backend_write(uint32_t fileno, uint64_t off, uint32_t len,
+                            const char *buf);
+
+/* Vectored forms for READV/WRITEV: all extents go to one file under a
+ * single descriptor reference, and extents that continue one another
+ * are merged into one transfer (capped at FCHAN_BACKEND_MAXIO).  buf
+ * holds the extents' data back to back; readv packs it by the lengths
+ * actually read, stored in lens.  Return total bytes, or -1. */
+struct fchan_backend_extent {
+    uint64_t off;
+    uint32_t len;
+};
+
+ssize_t fchan_backend_readv(uint32_t fileno,
+                            const struct fchan_backend_extent *ext,
+                            uint32_t n, char *buf, uint32_t *lens, bool *eof);
+ssize_t fchan_backend_writev(uint32_t fileno,
+                             const struct fchan_backend_extent *ext,
+                             uint32_t n, const char *buf);
+
+void fchan_backend_stats(struct fchan_backend_stats *st);
+
+/* direct access to a cached descriptor, e.g. for sendfile; the fd
+ * stays open until the matching put */
+struct fchan_backend_file;
+struct fchan_backend_file *fchan_backend_get(uint32_t fileno);
+int fchan_backend_fd(struct fchan_backend_file *fe);
+void fchan_backend_put(struct fchan_backend_file *fe);
+
+#endif /* FCHAN_BACKEND_H */
@@ -0,0 +1,377 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "fchan_backend.h"
+#include "fchan_bcache.h"
+#include "fchan_lru.h"
+#include "fchan_shard.h"
+
+#define BCACHE_NBUCKETS 1024 /* per shard */
+
+#define BCACHE_BLK_FLAG_NONE     0x0000
+#define BCACHE_BLK_FLAG_PREFETCH 0x0001 /* read ahead, not yet used */
+
+struct bcache_blk {
+    uint32_t fileno;
+    uint64_t blkno;
+    uint32_t len; /* valid bytes, always a full block once cached */
+    uint32_t flags;
+    struct bcache_blk *hnext;
+    struct fchan_lru_link lru;
+    char data[];
+};
+
+struct bcache_shard {
+    pthread_mutex_t mtx; /* first, see fchan_shard.h */
+    /* bumped by every invalidation, so a fill that raced with a WRITE
+     * knows not to insert stale data */
+    uint64_t gen;
+    struct bcache_blk *buckets[BCACHE_NBUCKETS];
+    struct fchan_lru lru;
+    struct fchan_bcache_stats st; /* counts nblocks, not max_blocks */
+} FCHAN_SHARD_ALIGNED;
+
+/* the counters ahead of max_blocks */
+#define BCACHE_NSTATS \
+    (offsetof(struct fchan_bcache_stats, max_blocks) / sizeof(uint64_t))
+
+static struct bcache_shard *shards = NULL;
+static uint32_t shard_max_blocks = 0;
+
+static inline uint64_t
+bcache_hash(uint32_t fileno, uint64_t blkno)
+{
+    uint64_t h = (((uint64_t) fileno) << 32) ^ blkno;
+
+    /* 64-bit mix (murmur3 finalizer) */
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (h);
+}
+
+static inline struct bcache_shard *
+bcache_shard(uint64_t h)
+{
+    return (&shards[h % FCHAN_BCACHE_NSHARDS]);
+}
+
+static inline struct bcache_blk **
+bcache_bucket(struct bcache_shard *sh, uint64_t h)
+{
+    return (&sh->buckets[(h / FCHAN_BCACHE_NSHARDS) % BCACHE_NBUCKETS]);
+}
+
+/* with sh->mtx held */
+static struct bcache_blk *
+bcache_lookup(struct bcache_shard *sh, uint64_t h, uint32_t fileno,
+              uint64_t blkno)
+{
+    struct bcache_blk *b;
+
+    for (b = *bcache_bucket(sh, h); b; b = b->hnext) {
+        if ((b->fileno == fileno) && (b->blkno == blkno))
+            return (b);
+    }
+    return (NULL);
+}
+
+/* with sh->mtx held */
+static void
+bcache_remove(struct bcache_shard *sh, uint64_t h, struct bcache_blk *b)
+{
+    struct bcache_blk **bp;
+
+    for (bp = bcache_bucket(sh, h); *bp; bp = &(*bp)->hnext) {
+        if (*bp == b) {
+            *bp = b->hnext;
+            break;
+        }
+    }
+    fchan_lru_unlink(&sh->lru, &b->lru);
+    --(sh->st.nblocks);
+}
+
+/* with sh->mtx held; takes ownership of b */
+static void
+bcache_insert(struct bcache_shard *sh, uint64_t h, struct bcache_blk *b)
+{
+    struct bcache_blk *victim, **bp;
+
+    while (sh->st.nblocks >= shard_max_blocks) {
+        victim = fchan_lru_entry(sh->lru.tail, struct bcache_blk, lru);
+        bcache_remove(sh, bcache_hash(victim->fileno, victim->blkno),
+                      victim);
+        ++(sh->st.evictions);
+        free(victim);
+    }
+
+    bp = bcache_bucket(sh, h);
+    b->hnext = *bp;
+    *bp = b;
+    fchan_lru_push(&sh->lru, &b->lru);
+    ++(sh->st.nblocks);
+}
+
+/* read a block from the backend, not yet visible */
+static struct bcache_blk *
+bcache_fill(uint32_t fileno, uint64_t blkno, uint32_t flags)
+{
+    struct bcache_blk *b;
+    ssize_t nread;
+    bool eof;
+
+    b = malloc(sizeof(struct bcache_blk) + FCHAN_BCACHE_BLKSIZE);
+    if (! b)
+        return (NULL);
+
+    nread = fchan_backend_read(fileno, blkno * FCHAN_BCACHE_BLKSIZE,
+                               FCHAN_BCACHE_BLKSIZE, b->data, &eof);
+    if (nread < 0) {
+        free(b);
+        return (NULL);
+    }
+
+    b->fileno = fileno;
+    b->blkno = blkno;
+    b->len = nread;
+    b->flags = flags;
+
+    return (b);
+}
+
+/* Insert a filled block unless a WRITE invalidated the range since gen
+ * was sampled, or another fill got there first.  Frees b if not.
+ *
+ * A short block (the one holding EOF) is never kept: a later WRITE past
+ * it extends the file without touching its range, so nothing would
+ * invalidate it and READs would keep stopping at the old EOF. */
+static void
+bcache_install(struct bcache_shard *sh, uint64_t h, struct bcache_blk *b,
+               uint64_t gen)
+{
+    if (b->len < FCHAN_BCACHE_BLKSIZE) {
+        free(b);
+        return;
+    }
+
+    pthread_mutex_lock(&sh->mtx);
+    if ((sh->gen == gen) && ! bcache_lookup(sh, h, b->fileno, b->blkno)) {
+        bcache_insert(sh, h, b);
+        if (b->flags & BCACHE_BLK_FLAG_PREFETCH)
+            ++(sh->st.prefetched);
+        b = NULL;
+    }
+    pthread_mutex_unlock(&sh->mtx);
+
+    if (b)
+        free(b);
+}
+
+/* Copy out of block (fileno, blkno) starting at boff, filling it from
+ * the backend on a miss.  Returns bytes copied and the valid length of
+ * the block in *blen, or -1. */
+static ssize_t
+bcache_copy_block(uint32_t fileno, uint64_t blkno, uint32_t boff,
+                  char *buf, uint32_t len, uint32_t *blen)
+{
+    uint64_t h = bcache_hash(fileno, blkno), gen;
+    struct bcache_shard *sh = bcache_shard(h);
+    struct bcache_blk *b;
+    uint32_t n = 0;
+
+    pthread_mutex_lock(&sh->mtx);
+    b = bcache_lookup(sh, h, fileno, blkno);
+    if (b) {
+        fchan_lru_touch(&sh->lru, &b->lru);
+        ++(sh->st.hits);
+        if (b->flags & BCACHE_BLK_FLAG_PREFETCH) {
+            b->flags &= ~BCACHE_BLK_FLAG_PREFETCH;
+            ++(sh->st.prefetch_hits);
+        }
+        *blen = b->len;
+        if (boff < b->len) {
+            n = MIN(len, b->len - boff);
+            memcpy(buf, b->data + boff, n);
+        }
+        pthread_mutex_unlock(&sh->mtx);
+        return (n);
+    }
+    ++(sh->st.misses);
+    gen = sh->gen;
+    pthread_mutex_unlock(&sh->mtx);
+
+    /* fill outside the lock */
+    b = bcache_fill(fileno, blkno, BCACHE_BLK_FLAG_NONE);
+    if (! b)
+        return (-1);
+
+    *blen = b->len;
+    if (boff < b->len) {
+        n = MIN(len, b->len - boff);
+        memcpy(buf, b->data + boff, n);
+    }
+
+    bcache_install(sh, h, b, gen);
+
+    return (n);
+}
+
+void
+fchan_bcache_prefetch(uint32_t fileno, uint64_t blkno)
+{
+    uint64_t h = bcache_hash(fileno, blkno), gen;
+    struct bcache_shard *sh = bcache_shard(h);
+    struct bcache_blk *b;
+
+    pthread_mutex_lock(&sh->mtx);
+    b = bcache_lookup(sh, h, fileno, blkno);
+    gen = sh->gen;
+    pthread_mutex_unlock(&sh->mtx);
+
+    if (b)
+        return;
+
+    b = bcache_fill(fileno, blkno, BCACHE_BLK_FLAG_PREFETCH);
+    if (! b)
+        return;
+
+    bcache_install(sh, h, b, gen);
+}
+
+ssize_t
+fchan_bcache_read(uint32_t fileno, uint64_t off, uint32_t len, char *buf,
+                  bool *eof)
+{
+    uint64_t pos;
+    uint32_t boff, blen;
+    ssize_t n, nread = 0;
+
+    *eof = false;
+    while (nread < len) {
+        pos = off + nread;
+        boff = pos % FCHAN_BCACHE_BLKSIZE;
+        n = bcache_copy_block(fileno, pos / FCHAN_BCACHE_BLKSIZE, boff,
+                              buf + nread, len - nread, &blen);
+        if (n < 0)
+            return (-1);
+        nread += n;
+        if (blen < FCHAN_BCACHE_BLKSIZE && boff + n >= blen) {
+            *eof = true;
+            break;
+        }
+    }
+
+    return (nread);
+}
+
+void
+fchan_bcache_invalidate(uint32_t fileno, uint64_t off, uint32_t len)
+{
+    struct bcache_shard *sh;
+    struct bcache_blk *b;
+    uint64_t blkno, last, h;
+
+    if (! len)
+        return;
+
+    last = (off + len - 1) / FCHAN_BCACHE_BLKSIZE;
+    for (blkno = off / FCHAN_BCACHE_BLKSIZE; blkno <= last; ++blkno) {
+        h = bcache_hash(fileno, blkno);
+        sh = bcache_shard(h);
+        pthread_mutex_lock(&sh->mtx);
+        ++(sh->gen);
+        b = bcache_lookup(sh, h, fileno, blkno);
+        if (b) {
+            bcache_remove(sh, h, b);
+            ++(sh->st.invalidations);
+            free(b);
+        }
+        pthread_mutex_unlock(&sh->mtx);
+    }
+}
+
+int
+fchan_bcache_init(uint64_t budget)
+{
+    uint64_t max_blocks = budget / FCHAN_BCACHE_BLKSIZE;
+
+    shard_max_blocks = MAX(max_blocks / FCHAN_BCACHE_NSHARDS, 1);
+
+    shards = fchan_shard_alloc(FCHAN_BCACHE_NSHARDS,
+                               sizeof(struct bcache_shard));
+    if (! shards)
+        return (ENOMEM);
+
+    return (0);
+}
+
+void
+fchan_bcache_shutdown(void)
+{
+    struct bcache_shard *sh;
+    struct bcache_blk *b;
+    int ix;
+
+    if (! shards)
+        return;
+
+    for (ix = 0; ix < FCHAN_BCACHE_NSHARDS; ++ix) {
+        sh = &shards[ix];
+        while ((b = fchan_lru_entry(sh->lru.head, struct bcache_blk, lru))) {
+            fchan_lru_unlink(&sh->lru, &b->lru);
+            free(b);
+        }
+    }
+    fchan_shard_free(shards, FCHAN_BCACHE_NSHARDS,
+                     sizeof(struct bcache_shard));
+    shards = NULL;
+}
+
+bool
+fchan_bcache_enabled(void)
+{
+    return (shards != NULL);
+}
+
+void
+fchan_bcache_stats(struct fchan_bcache_stats *st)
+{
+    memset(st, 0, sizeof(struct fchan_bcache_stats));
+    if (! shards)
+        return;
+
+    fchan_shard_sum(shards, FCHAN_BCACHE_NSHARDS, sizeof(struct bcache_shard),
+                    offsetof(struct bcache_shard, st), (uint64_t *) st,
+                    BCACHE_NSTATS);
+    st->max_blocks = (uint64_t) shard_max_blocks * FCHAN_BCACHE_NSHARDS;
+}
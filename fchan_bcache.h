@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_BCACHE_H
+#define FCHAN_BCACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*
+ * Block cache in front of the file backend.  Blocks are fixed size and
+ * keyed by (fileno, block number); the table is split into shards, each
+ * with its own lock, hash and LRU, so concurrent READs of unrelated
+ * blocks don't contend.  WRITEs invalidate the blocks they touch.
+ */
+
+#define FCHAN_BCACHE_BLKSIZE (64 * 1024)
+#define FCHAN_BCACHE_NSHARDS 16
+
+struct fchan_bcache_stats {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t invalidations;
+    uint64_t prefetched;    /* blocks inserted by read-ahead */
+    uint64_t prefetch_hits; /* ... and later read */
+    uint64_t nblocks;   /* currently cached */
+    uint64_t max_blocks;
+};
+
+/* budget is in bytes, rounded down to whole blocks (at least one per
+ * shard); returns errno */
+int fchan_bcache_init(uint64_t budget);
+void fchan_bcache_shutdown(void);
+bool fchan_bcache_enabled(void);
+
+/* same contract as fchan_backend_read */
+ssize_t fchan_bcache_read(uint32_t fileno, uint64_t off, uint32_t len,
+                          char *buf, bool *eof);
+
+/* pull a block in ahead of demand, if it isn't already cached */
+void fchan_bcache_prefetch(uint32_t fileno, uint64_t blkno);
+
+/* drop any cached blocks overlapping [off, off+len) */
+void fchan_bcache_invalidate(uint32_t fileno, uint64_t off, uint32_t len);
+
+void fchan_bcache_stats(struct fchan_bcache_stats *st);
+
+#endif /* FCHAN_BCACHE_H */
@@ -30,6 +30,7 @@
 
 #include <unistd.h>
 #include <pthread.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -79,6 +80,7 @@ static pthread_t* fchan_tid;
 pthread_mutex_t clnt_mtx = PTHREAD_MUTEX_INITIALIZER;
 static int forechan_shutdown = FALSE;
 static int always_destroy_client = FALSE;
+static char *nettype = "tcp";
 
 void fchan_sighand(int sig)
 {
@@ -105,7 +107,7 @@ fchan_create_client(void)
 {
     CLIENT *cl;
     pthread_mutex_lock(&clnt_mtx);
-    cl = clnt_create(server_host, FCHAN_PROG, FCHANV, "tcp");
+    cl = clnt_create(server_host, FCHAN_PROG, FCHANV, nettype);
     pthread_mutex_unlock(&clnt_mtx);
     return (cl);
 }
@@ -182,7 +184,7 @@ main (int argc, char *argv[])
 {
     int opt, r, ix;
 
-    while ((opt = getopt(argc, argv, "h:t:n:dv:")) != -1) {
+    while ((opt = getopt(argc, argv, "h:t:n:duv:")) != -1) {
         switch (opt) {
         case 'h':
             server_host = optarg;
@@ -196,6 +198,10 @@ main (int argc, char *argv[])
         case 'd':
             always_destroy_client = TRUE;
             break;
+        case 'u':
+            /* server started with -u */
+            nettype = "udp";
+            break;
         case 'v':
             verbose = atoi(optarg);
             break;
@@ -206,7 +212,7 @@ main (int argc, char *argv[])
 
     if (! server_host) {
         printf ("usage: %s -h server_host [-n client_threads (default 1)] "
-                "[-d (destroy clients continuously)]\n",
+                "[-d (destroy clients continuously)] [-u (udp)]\n",
                 argv[0]);
         return (EXIT_FAILURE);
     }
@@ -228,7 +234,7 @@ main (int argc, char *argv[])
     }
 
     if (verbose & VERB_2)
-        printf("%s total requests processed: %ld\n",
+        printf("%s total requests processed: %" PRIu64 "\n",
                argv[0], n_processed);
 
     exit (0);
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <rpc/rpc.h>
+#include <rpc/svc_rqst.h>
+#include <rpc/rpc_dplx.h>
+
+#include "bchan.h"
+#include "fchan_cbclnt.h"
+#include "fchan_shard.h"
+
+#define CBC_NBUCKETS 64
+
+struct fchan_cbclnt {
+    struct fchan_cbclnt *hnext;
+    SVCXPRT *xprt;
+    CLIENT *cl;
+    uint32_t refcnt; /* under the shard lock */
+    uint32_t shard;
+};
+
+struct cbc_shard {
+    pthread_mutex_t mtx; /* first, see fchan_shard.h */
+    struct fchan_cbclnt *buckets[CBC_NBUCKETS];
+    struct fchan_cbclnt_stats st;
+} FCHAN_SHARD_ALIGNED;
+
+static struct cbc_shard *shards = NULL;
+
+static inline uint64_t
+cbc_hash(SVCXPRT *xprt)
+{
+    /* Fibonacci hashing of the pointer, allocations are aligned */
+    return (((uint64_t) (uintptr_t) xprt) * 0x9e3779b97f4a7c15ULL >> 32);
+}
+
+static inline struct fchan_cbclnt **
+cbc_bucket(struct cbc_shard *sh, uint64_t h)
+{
+    return (&sh->buckets[(h / FCHAN_CBCLNT_NSHARDS) % CBC_NBUCKETS]);
+}
+
+/* with sh->mtx held */
+static void
+cbc_unlink(struct cbc_shard *sh, struct fchan_cbclnt *ce)
+{
+    struct fchan_cbclnt **cep;
+
+    for (cep = cbc_bucket(sh, cbc_hash(ce->xprt)); *cep;
+         cep = &(*cep)->hnext) {
+        if (*cep == ce) {
+            *cep = ce->hnext;
+            break;
+        }
+    }
+    ce->hnext = NULL;
+    --(sh->st.nclients);
+}
+
+static void
+cbc_destroy(struct cbc_shard *sh, struct fchan_cbclnt *ce)
+{
+    clnt_destroy(ce->cl);
+    free(ce);
+
+    pthread_mutex_lock(&sh->mtx);
+    ++(sh->st.destroyed);
+    pthread_mutex_unlock(&sh->mtx);
+}
+
+CLIENT *
+fchan_cbclnt_get(SVCXPRT *xprt, struct fchan_cbclnt **cep)
+{
+    uint64_t h = cbc_hash(xprt);
+    struct cbc_shard *sh = &shards[h % FCHAN_CBCLNT_NSHARDS];
+    struct fchan_cbclnt *ce;
+
+    pthread_mutex_lock(&sh->mtx);
+    for (ce = *cbc_bucket(sh, h); ce; ce = ce->hnext) {
+        if (ce->xprt == xprt)
+            break;
+    }
+
+    if (! ce) {
+        ce = calloc(1, sizeof(struct fchan_cbclnt));
+        if (! ce)
+            goto unlock;
+
+        /* convert xprt to a shared client channel; under the shard
+         * lock, so two first callbacks don't both make one */
+        ce->cl = clnt_vc_create_svc(xprt, BCHAN_PROG, BCHANV,
+                                    SVC_VC_CREATE_NONE);
+        if (! ce->cl) {
+            free(ce);
+            ce = NULL;
+            goto unlock;
+        }
+        ce->xprt = xprt;
+        ce->shard = h % FCHAN_CBCLNT_NSHARDS;
+        ce->refcnt = 1; /* the table's */
+        ce->hnext = *cbc_bucket(sh, h);
+        *cbc_bucket(sh, h) = ce;
+        ++(sh->st.created);
+        ++(sh->st.nclients);
+    }
+
+    ++(ce->refcnt);
+
+unlock:
+    pthread_mutex_unlock(&sh->mtx);
+
+    *cep = ce;
+    return (ce ? ce->cl : NULL);
+}
+
+void
+fchan_cbclnt_put(struct fchan_cbclnt *ce)
+{
+    struct cbc_shard *sh = &shards[ce->shard];
+    uint32_t refcnt;
+
+    pthread_mutex_lock(&sh->mtx);
+    refcnt = --(ce->refcnt);
+    pthread_mutex_unlock(&sh->mtx);
+
+    if (refcnt == 0)
+        cbc_destroy(sh, ce);
+}
+
+void
+fchan_cbclnt_forget(SVCXPRT *xprt)
+{
+    uint64_t h;
+    struct cbc_shard *sh;
+    struct fchan_cbclnt *ce;
+
+    if (! shards)
+        return;
+
+    h = cbc_hash(xprt);
+    sh = &shards[h % FCHAN_CBCLNT_NSHARDS];
+
+    pthread_mutex_lock(&sh->mtx);
+    for (ce = *cbc_bucket(sh, h); ce; ce = ce->hnext) {
+        if (ce->xprt == xprt)
+            break;
+    }
+    if (ce)
+        cbc_unlink(sh, ce);
+    pthread_mutex_unlock(&sh->mtx);
+
+    if (ce)
+        fchan_cbclnt_put(ce);
+}
+
+int
+fchan_cbclnt_init(void)
+{
+    shards = fchan_shard_alloc(FCHAN_CBCLNT_NSHARDS,
+                               sizeof(struct cbc_shard));
+    if (! shards)
+        return (ENOMEM);
+
+    return (0);
+}
+
+/* callers are gone by now, so only the table's references are left */
+void
+fchan_cbclnt_shutdown(void)
+{
+    struct fchan_cbclnt *ce;
+    struct cbc_shard *sh;
+    int ix, bx;
+
+    if (! shards)
+        return;
+
+    for (ix = 0; ix < FCHAN_CBCLNT_NSHARDS; ++ix) {
+        sh = &shards[ix];
+        for (bx = 0; bx < CBC_NBUCKETS; ++bx) {
+            while ((ce = sh->buckets[bx])) {
+                sh->buckets[bx] = ce->hnext;
+                clnt_destroy(ce->cl);
+                free(ce);
+            }
+        }
+    }
+    fchan_shard_free(shards, FCHAN_CBCLNT_NSHARDS, sizeof(struct cbc_shard));
+    shards = NULL;
+}
+
+void
+fchan_cbclnt_stats(struct fchan_cbclnt_stats *st)
+{
+    memset(st, 0, sizeof(struct fchan_cbclnt_stats));
+    if (! shards)
+        return;
+
+    fchan_shard_sum(shards, FCHAN_CBCLNT_NSHARDS, sizeof(struct cbc_shard),
+                    offsetof(struct cbc_shard, st), (uint64_t *) st,
+                    sizeof(struct fchan_cbclnt_stats) / sizeof(uint64_t));
+}
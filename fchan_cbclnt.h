@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_CBCLNT_H
+#define FCHAN_CBCLNT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <rpc/rpc.h>
+
+/*
+ * Backchannel CLIENTs, one per connection.  The first callback on an
+ * xprt creates its CLIENT; later ones, from any thread, find it here,
+ * so callbacks on different connections don't share a handle.  The
+ * table is sharded by xprt address.
+ *
+ * Entries are counted: the table holds one reference and each get
+ * another.  fchan_cbclnt_forget drops the table's when the xprt goes
+ * away; the CLIENT is destroyed with the last reference.  CLIENTs are
+ * created without SVC_VC_CREATE_DISPOSE, destroying one leaves its
+ * xprt alone.
+ */
+
+#define FCHAN_CBCLNT_NSHARDS 16
+
+struct fchan_cbclnt;
+
+struct fchan_cbclnt_stats {
+    uint64_t created;
+    uint64_t destroyed;
+    uint64_t nclients;
+};
+
+/* returns errno */
+int fchan_cbclnt_init(void);
+void fchan_cbclnt_shutdown(void);
+
+/* NULL if a CLIENT can't be made on xprt; otherwise *cep holds a
+ * reference for fchan_cbclnt_put */
+CLIENT *fchan_cbclnt_get(SVCXPRT *xprt, struct fchan_cbclnt **cep);
+void fchan_cbclnt_put(struct fchan_cbclnt *ce);
+
+/* xprt is being destroyed */
+void fchan_cbclnt_forget(SVCXPRT *xprt);
+
+void fchan_cbclnt_stats(struct fchan_cbclnt_stats *st);
+
+#endif /* FCHAN_CBCLNT_H */
@@ -25,17 +25,24 @@
 
 #include "fchan.h"
 #include "bchan.h"
+#include "fchan_stats.h"
+#include "fchan_trace.h"
+#include "fchan_crc.h"
+#include "duplex_unit.h"
 
 #include <rpc/svc_rqst.h>
 
 #include <unistd.h>
 #include <pthread.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <memory.h>
 
 #include <sys/signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 
 #define FREE_FCHAN_MSG_NONE     0x0000
@@ -77,6 +84,17 @@ static pthread_t fchan_tid;
 static int forechan_shutdown = FALSE;
 AUTH *auth;
 
+/* -k: a checksummed WRITE and READ back with every SENDMSG1 */
+#define FCHAN_CRC_IO_FILENO 0
+#define FCHAN_CRC_IO_SIZE 4096
+
+static bool crc_io = FALSE;
+static struct {
+    uint64_t calls;
+    uint64_t write_bad; /* the server found our WRITE damaged */
+    uint64_t read_bad;  /* READ data didn't match the server's checksum */
+} crc_counts;
+
 void fchan_sighand(int sig)
 {
     int code = 0;
@@ -151,6 +169,60 @@ backchan_rpc_server(CLIENT *cl)
     return;
 }
 
+/* mismatches are counted, the loop goes on */
+static void
+fchan_crc_io(CLIENT *cl, uint32_t seqnum)
+{
+    enum clnt_stat retval;
+    write_args wargs;
+    write_res wres;
+    read_args rargs;
+    read_res rres;
+    char data[FCHAN_CRC_IO_SIZE];
+    int ix;
+
+    for (ix = 0; ix < sizeof(data); ++ix)
+        data[ix] = (char) (seqnum + ix);
+
+    memset(&wargs, 0, sizeof(write_args));
+    wargs.seqnum = seqnum;
+    wargs.fileno = FCHAN_CRC_IO_FILENO;
+    wargs.len = sizeof(data);
+    wargs.flags = FCHAN_FLAG_CRC32C;
+    wargs.flags2 = fchan_crc32c(0, data, sizeof(data));
+    wargs.data.data_len = sizeof(data);
+    wargs.data.data_val = data;
+
+    memset(&wres, 0, sizeof(write_res));
+    retval = write_1(&wargs, &wres, cl);
+    if (retval != RPC_SUCCESS) {
+        clnt_perror (cl, "write call failed");
+        return;
+    }
+    ++(crc_counts.calls);
+    if (wres.flags & FCHAN_RES_FLAG_BADCRC)
+        ++(crc_counts.write_bad);
+
+    memset(&rargs, 0, sizeof(read_args));
+    rargs.seqnum = seqnum;
+    rargs.fileno = FCHAN_CRC_IO_FILENO;
+    rargs.len = sizeof(data);
+    rargs.flags = FCHAN_FLAG_CRC32C;
+
+    memset(&rres, 0, sizeof(read_res));
+    retval = read_1(&rargs, &rres, cl);
+    if (retval != RPC_SUCCESS) {
+        clnt_perror (cl, "read call failed");
+        return;
+    }
+    ++(crc_counts.calls);
+    if (! (rres.flags & FCHAN_RES_FLAG_CRC32C)
+        || (fchan_crc32c(0, rres.data.data_val, rres.data.data_len)
+            != rres.flags2))
+        ++(crc_counts.read_bad);
+    xdr_free((xdrproc_t) xdr_read_res, (caddr_t) &rres);
+}
+
 static void*
 fchan_call_loop(void *arg)
 {
@@ -185,6 +257,9 @@ fchan_call_loop(void *arg)
 
 	free_fchan_msg(&sendmsg1_1_arg, FREE_FCHAN_MSG_NONE);
 
+	if (crc_io)
+	    fchan_crc_io(cl, sendmsg1_1_arg.seqnum);
+
 	/* delay 1s (wont appear to be lockstep) */
 	thread_delay_s(1);
     }
@@ -193,30 +268,121 @@ fchan_call_loop(void *arg)
 }
 
 
+/* connect to a server's -U socket; what clnt_create does for tcp,
+ * without the portmapper */
+static CLIENT *
+fchan_clnt_create_local(const char *path)
+{
+    struct sockaddr_un sun;
+    struct netbuf raddr;
+    int fd;
+
+    if (strlen(path) >= sizeof(sun.sun_path))
+        return (NULL);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        return (NULL);
+
+    memset(&sun, 0, sizeof(struct sockaddr_un));
+    sun.sun_family = AF_UNIX;
+    memcpy(sun.sun_path, path, strlen(path) + 1);
+
+    if (connect(fd, (struct sockaddr *) &sun,
+                sizeof(struct sockaddr_un)) == -1) {
+        close(fd);
+        return (NULL);
+    }
+
+    raddr.buf = &sun;
+    raddr.maxlen = raddr.len = sizeof(struct sockaddr_un);
+    return (clnt_vc_create2(fd, &raddr, FCHAN_PROG, FCHANV,
+                            0 /* sendsz */,
+                            0 /* recvsz */,
+                            0 /* flags */));
+}
+
+static CLIENT *
+fchan_clnt_create(const char *host, const char *path)
+{
+    if (path)
+        return (fchan_clnt_create_local(path));
+    return (clnt_create(host, FCHAN_PROG, FCHANV, "tcp"));
+}
+
+/* print the server's STATS and exit */
+static int
+fchan_print_stats(CLIENT *cl)
+{
+    enum clnt_stat retval_1;
+    stats_res res;
+
+    memset(&res, 0, sizeof(stats_res));
+    retval_1 = stats_1(NULL, &res, cl);
+    if (retval_1 != RPC_SUCCESS) {
+        clnt_perror (cl, "stats call failed");
+        return (1);
+    }
+
+    fchan_stats_print(stdout, &res);
+    xdr_free((xdrproc_t) xdr_stats_res, (caddr_t) &res);
+
+    return (0);
+}
+
 int
 main (int argc, char *argv[])
 {
     char *host;
     CLIENT *cl, *cl_backchan;
     enum clnt_stat retval_1;
-    int r;
-    
-    if (argc < 2) {
-        printf ("usage: %s server_host\n", argv[0]);
+    bool stats_only = FALSE;
+    char *trace_file = NULL;
+    char *path = NULL;
+    int opt, r;
+
+    while ((opt = getopt(argc, argv, "skt:U:")) != -1) {
+        switch (opt) {
+        case 's':
+            stats_only = TRUE;
+            break;
+        case 'k':
+            crc_io = TRUE;
+            break;
+        case 't':
+            trace_file = optarg;
+            fchan_trace_init();
+            break;
+        case 'U':
+            path = optarg;
+            break;
+        default:
+            break;
+        }
+    }
+
+    if ((optind >= argc) && ! path) {
+        printf ("usage: %s [-s] [-k] [-t trace_file] server_host | "
+                "-U socket_path\n", argv[0]);
         exit (1);
     }
-    host = argv[1];
+    host = path ? path : argv[optind];
 
     fchan_signals();
 
-    cl = clnt_create(host, FCHAN_PROG, FCHANV, "tcp");
+    cl = fchan_clnt_create(host, path);
     if (cl == NULL) {
         clnt_pcreateerror (host);
         exit (1);
     }
 
+    if (stats_only) {
+        auth = authnone_create();
+        exit (fchan_print_stats(cl));
+    }
+
     /* create a dedicated connection for the backchan */
-    cl_backchan = clnt_create(host, FCHAN_PROG, FCHANV, "tcp");
+    cl_backchan = fchan_clnt_create(host, path);
     if (cl_backchan == NULL) {
         clnt_pcreateerror (host);
         exit (1);
@@ -240,5 +406,17 @@ main (int argc, char *argv[])
     r = pthread_join(fchan_tid, NULL);
     printf("%s cleanup: pthread_join (fchan) result %d\n", argv[0], r);
 
+    if (crc_io)
+        printf("%s: checksummed calls %" PRIu64 ", WRITE mismatches %"
+               PRIu64 ", READ mismatches %" PRIu64 "\n", argv[0],
+               crc_counts.calls, crc_counts.write_bad, crc_counts.read_bad);
+
+    if (trace_file) {
+        r = fchan_trace_dump(trace_file);
+        if (r)
+            printf("%s: cannot write %s (%s)\n", argv[0], trace_file,
+                   strerror(r));
+    }
+
     exit (0);
 }
@@ -46,3 +46,201 @@ write_1(write_args *argp, write_res *clnt_res, CLIENT *clnt)
                       (xdrproc_t) xdr_write_res, (caddr_t) clnt_res,
                       TIMEOUT));
 }
+
+enum clnt_stat 
+stats_1(void *argp, stats_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, STATS,
+                      (xdrproc_t) xdr_void, (caddr_t) argp,
+                      (xdrproc_t) xdr_stats_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+create_session_1(create_session_args *argp, create_session_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, CREATE_SESSION,
+                      (xdrproc_t) xdr_create_session_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_create_session_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+destroy_session_1(u_quad_t *argp, u_int *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, DESTROY_SESSION,
+                      (xdrproc_t) xdr_u_quad_t, (caddr_t) argp,
+                      (xdrproc_t) xdr_u_int, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+sequence_1(sequence_args *argp, sequence_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, SEQUENCE,
+                      (xdrproc_t) xdr_sequence_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_sequence_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+compound_1(compound_args *argp, compound_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, COMPOUND,
+                      (xdrproc_t) xdr_compound_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_compound_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+readv_1(readv_args *argp, readv_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, READV,
+                      (xdrproc_t) xdr_readv_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_readv_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+writev_1(writev_args *argp, writev_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, WRITEV,
+                      (xdrproc_t) xdr_writev_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_writev_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+sendmsg1_2(fchan_msg *argp, fchan_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, SENDMSG1,
+                      (xdrproc_t) xdr_fchan_msg, (caddr_t) argp,
+                      (xdrproc_t) xdr_fchan_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+bind_conn_to_session1_2(void *argp, int *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, BIND_CONN_TO_SESSION1,
+                      (xdrproc_t) xdr_void, (caddr_t) argp,
+                      (xdrproc_t) xdr_int, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+read_2(read64_args *argp, read_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, READ,
+                      (xdrproc_t) xdr_read64_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_read_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+write_2(write64_args *argp, write_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, WRITE,
+                      (xdrproc_t) xdr_write64_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_write_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+stats_2(void *argp, stats_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, STATS,
+                      (xdrproc_t) xdr_void, (caddr_t) argp,
+                      (xdrproc_t) xdr_stats_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+create_session_2(create_session_args *argp, create_session_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, CREATE_SESSION,
+                      (xdrproc_t) xdr_create_session_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_create_session_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+destroy_session_2(u_quad_t *argp, u_int *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, DESTROY_SESSION,
+                      (xdrproc_t) xdr_u_quad_t, (caddr_t) argp,
+                      (xdrproc_t) xdr_u_int, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+sequence_2(sequence_args *argp, sequence_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, SEQUENCE,
+                      (xdrproc_t) xdr_sequence_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_sequence_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+compound_2(compound_args *argp, compound_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, COMPOUND,
+                      (xdrproc_t) xdr_compound_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_compound_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+readv_2(readv_args *argp, readv_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, READV,
+                      (xdrproc_t) xdr_readv_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_readv_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+writev_2(writev_args *argp, writev_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, WRITEV,
+                      (xdrproc_t) xdr_writev_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_writev_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+negotiate_2(negotiate_args *argp, negotiate_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, NEGOTIATE,
+                      (xdrproc_t) xdr_negotiate_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_negotiate_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+read64_2(read64_args *argp, read_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, READ64,
+                      (xdrproc_t) xdr_read64_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_read_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+write64_2(write64_args *argp, write_res *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, WRITE64,
+                      (xdrproc_t) xdr_write64_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_write_res, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
+
+enum clnt_stat 
+bind_conn_to_session_2(bind_conn_args *argp, u_int *clnt_res, CLIENT *clnt)
+{
+    return (clnt_call(clnt, auth, BIND_CONN_TO_SESSION,
+                      (xdrproc_t) xdr_bind_conn_args, (caddr_t) argp,
+                      (xdrproc_t) xdr_u_int, (caddr_t) clnt_res,
+                      TIMEOUT));
+}
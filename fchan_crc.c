@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#define FCHAN_CRC_SSE42 1
+#endif
+
+#include "fchan_crc.h"
+
+#define CRC32C_POLY 0x82f63b78 /* reflected */
+
+static uint32_t crc_table[8][256];
+static pthread_once_t crc_once = PTHREAD_ONCE_INIT;
+static bool crc_hw = false;
+
+static void
+crc_init(void)
+{
+    uint32_t crc;
+    int ix, jx;
+
+    for (ix = 0; ix < 256; ++ix) {
+        crc = ix;
+        for (jx = 0; jx < 8; ++jx)
+            crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY : 0);
+        crc_table[0][ix] = crc;
+    }
+    for (ix = 0; ix < 256; ++ix) {
+        crc = crc_table[0][ix];
+        for (jx = 1; jx < 8; ++jx) {
+            crc = crc_table[0][crc & 0xff] ^ (crc >> 8);
+            crc_table[jx][ix] = crc;
+        }
+    }
+
+#if defined(FCHAN_CRC_SSE42)
+    __builtin_cpu_init();
+    crc_hw = __builtin_cpu_supports("sse4.2");
+#endif
+}
+
+static uint32_t
+crc_sw(uint32_t crc, const unsigned char *p, size_t len)
+{
+    uint64_t word;
+
+    while (len && ((uintptr_t) p & 7)) {
+        crc = crc_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+        --len;
+    }
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    /* the table order assumes little-endian words */
+    while (len >= 8) {
+        memcpy(&word, p, sizeof(word));
+        word ^= crc;
+        crc = crc_table[7][word & 0xff] ^
+            crc_table[6][(word >> 8) & 0xff] ^
+            crc_table[5][(word >> 16) & 0xff] ^
+            crc_table[4][(word >> 24) & 0xff] ^
+            crc_table[3][(word >> 32) & 0xff] ^
+            crc_table[2][(word >> 40) & 0xff] ^
+            crc_table[1][(word >> 48) & 0xff] ^
+            crc_table[0][word >> 56];
+        p += 8;
+        len -= 8;
+    }
+#endif
+    while (len--)
+        crc = crc_table[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+    return (crc);
+}
+
+#if defined(FCHAN_CRC_SSE42)
+__attribute__((target("sse4.2")))
+static uint32_t
+crc_hw_sse42(uint32_t crc, const unsigned char *p, size_t len)
+{
+    uint64_t crc64, word;
+
+    while (len && ((uintptr_t) p & 7)) {
+        crc = _mm_crc32_u8(crc, *p++);
+        --len;
+    }
+    crc64 = crc;
+    while (len >= 8) {
+        memcpy(&word, p, sizeof(word));
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        len -= 8;
+    }
+    crc = (uint32_t) crc64;
+    while (len--)
+        crc = _mm_crc32_u8(crc, *p++);
+
+    return (crc);
+}
+#endif
+
+uint32_t
+fchan_crc32c(uint32_t crc, const void *buf, size_t len)
+{
+    pthread_once(&crc_once, crc_init);
+
+    crc = ~crc;
+#if defined(FCHAN_CRC_SSE42)
+    if (crc_hw)
+        return (~crc_hw_sse42(crc, buf, len));
+#endif
+    return (~crc_sw(crc, buf, len));
+}
+
+bool
+fchan_crc32c_hw(void)
+{
+    pthread_once(&crc_once, crc_init);
+    return (crc_hw);
+}
@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <pthread.h>
+#include <string.h>
+
+#include "fchan_credit.h"
+
+static struct {
+    pthread_mutex_t mtx;
+    bool enabled;
+    struct fchan_credit_limits conn;
+    struct fchan_credit_limits total;
+    fchan_credit_resume_fn resume;
+    uint32_t reqs;
+    uint64_t bytes;
+    struct fchan_credit *paused;
+    uint32_t npaused;
+    uint64_t pauses;
+} cr_g = {
+    PTHREAD_MUTEX_INITIALIZER
+};
+
+void
+fchan_credit_init(const struct fchan_credit_limits *conn,
+                  const struct fchan_credit_limits *total,
+                  fchan_credit_resume_fn resume)
+{
+    cr_g.conn = *conn;
+    cr_g.total = *total;
+    cr_g.resume = resume;
+    cr_g.enabled = (conn->reqs || conn->bytes || total->reqs ||
+                    total->bytes);
+}
+
+bool
+fchan_credit_enabled(void)
+{
+    return (cr_g.enabled);
+}
+
+/* with cr_g.mtx held */
+static inline bool
+cr_over(const struct fchan_credit *cr)
+{
+    return ((cr_g.conn.reqs && cr->reqs >= cr_g.conn.reqs) ||
+            (cr_g.conn.bytes && cr->bytes >= cr_g.conn.bytes) ||
+            (cr_g.total.reqs && cr_g.reqs >= cr_g.total.reqs) ||
+            (cr_g.total.bytes && cr_g.bytes >= cr_g.total.bytes));
+}
+
+/* with cr_g.mtx held */
+static inline void
+cr_unpark(struct fchan_credit *cr)
+{
+    if (cr->prev)
+        cr->prev->next = cr->next;
+    else
+        cr_g.paused = cr->next;
+    if (cr->next)
+        cr->next->prev = cr->prev;
+    cr->prev = cr->next = NULL;
+    cr->paused = false;
+    --(cr_g.npaused);
+}
+
+/* with cr_g.mtx held */
+static inline void
+cr_take(struct fchan_credit *cr)
+{
+    ++(cr->reqs);
+    ++(cr_g.reqs);
+}
+
+/* with cr_g.mtx held */
+static inline void
+cr_give(struct fchan_credit *cr)
+{
+    --(cr->reqs);
+    --(cr_g.reqs);
+}
+
+/* With cr_g.mtx held.  Oldest parked first; anyone still over stays
+ * parked.  Each one resumed has a request's credit reserved for it,
+ * which counts against the rest, so no more are resumed than the
+ * credit given back covers. */
+static void
+cr_resume_parked(void)
+{
+    struct fchan_credit *p, *next;
+
+    for (p = cr_g.paused; p; p = next) {
+        next = p->next;
+        if (cr_over(p))
+            continue;
+        cr_take(p);
+        p->held = true;
+        if (! cr_g.resume(p)) {
+            /* couldn't be woken now, it keeps its place */
+            p->held = false;
+            cr_give(p);
+            break;
+        }
+        cr_unpark(p);
+    }
+}
+
+bool
+fchan_credit_reserve(struct fchan_credit *cr)
+{
+    struct fchan_credit *p;
+    bool admit = true;
+
+    pthread_mutex_lock(&cr_g.mtx);
+    if (cr->held) {
+        /* set aside when it was resumed */
+        cr->held = false;
+    } else if (cr->paused) {
+        admit = false;
+    } else if (cr_over(cr)) {
+        /* park at the tail, it has waited least */
+        admit = false;
+        cr->paused = true;
+        cr->next = NULL;
+        cr->prev = NULL;
+        if (! cr_g.paused)
+            cr_g.paused = cr;
+        else {
+            for (p = cr_g.paused; p->next; p = p->next)
+                ;
+            p->next = cr;
+            cr->prev = p;
+        }
+        ++(cr_g.npaused);
+        ++(cr_g.pauses);
+    } else
+        cr_take(cr);
+    pthread_mutex_unlock(&cr_g.mtx);
+
+    return (admit);
+}
+
+void
+fchan_credit_charge(struct fchan_credit *cr, uint64_t bytes)
+{
+    pthread_mutex_lock(&cr_g.mtx);
+    cr->bytes += bytes;
+    cr_g.bytes += bytes;
+    pthread_mutex_unlock(&cr_g.mtx);
+}
+
+void
+fchan_credit_uncharge(struct fchan_credit *cr, uint64_t bytes)
+{
+    pthread_mutex_lock(&cr_g.mtx);
+    cr->bytes -= bytes;
+    cr_g.bytes -= bytes;
+    pthread_mutex_unlock(&cr_g.mtx);
+}
+
+void
+fchan_credit_release(struct fchan_credit *cr, uint64_t bytes)
+{
+    pthread_mutex_lock(&cr_g.mtx);
+    cr_give(cr);
+    cr->bytes -= bytes;
+    cr_g.bytes -= bytes;
+    cr_resume_parked();
+    pthread_mutex_unlock(&cr_g.mtx);
+}
+
+uint32_t
+fchan_credit_granted(struct fchan_credit *cr)
+{
+    uint32_t granted = UINT32_MAX;
+
+    pthread_mutex_lock(&cr_g.mtx);
+    if (cr_g.conn.reqs)
+        granted = cr_g.conn.reqs;
+    /* what's left globally, on top of what it already has */
+    if (cr_g.total.reqs) {
+        uint32_t left = (cr_g.reqs < cr_g.total.reqs)
+            ? cr_g.total.reqs - cr_g.reqs : 0;
+        if (cr->reqs + left < granted)
+            granted = cr->reqs + left;
+    }
+    pthread_mutex_unlock(&cr_g.mtx);
+
+    return (granted ? granted : 1);
+}
+
+void
+fchan_credit_forget(struct fchan_credit *cr)
+{
+    pthread_mutex_lock(&cr_g.mtx);
+    if (cr->paused)
+        cr_unpark(cr);
+    if (cr->held) {
+        /* resumed but never read again; pass it on */
+        cr->held = false;
+        cr_give(cr);
+        cr_resume_parked();
+    }
+    pthread_mutex_unlock(&cr_g.mtx);
+}
+
+void
+fchan_credit_stats(struct fchan_credit_stats *st)
+{
+    pthread_mutex_lock(&cr_g.mtx);
+    st->reqs = cr_g.reqs;
+    st->bytes = cr_g.bytes;
+    st->paused = cr_g.npaused;
+    st->pauses = cr_g.pauses;
+    st->conn_reqs = cr_g.conn.reqs;
+    pthread_mutex_unlock(&cr_g.mtx);
+}
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_CREDIT_H
+#define FCHAN_CREDIT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Admission control for requests handed to workers.  Each connection,
+ * and the server as a whole, may have a bounded number of requests and
+ * payload bytes in flight (0 is no bound).  A request's credit is
+ * reserved before it is read, so the request caps hold exactly; its
+ * bytes are only known once it's decoded, so the byte caps can be
+ * passed by the last request admitted.  A connection that can't
+ * reserve stops being read: it's parked until enough of its own, or
+ * anyone's, requests complete, then the resume function is called for
+ * it with a request's credit already reserved.  Meanwhile the client's
+ * sends back up in TCP.
+ *
+ * One mutex covers all of it; it's taken once when a request is read,
+ * once when it's handed off and once when it completes.
+ */
+
+struct fchan_credit;
+typedef bool (*fchan_credit_resume_fn)(struct fchan_credit *cr);
+
+/* per connection */
+struct fchan_credit {
+    uint32_t reqs;   /* in flight */
+    uint64_t bytes;  /* in flight */
+    bool paused;
+    bool held;       /* reserved for it on resume, not yet taken */
+    struct fchan_credit *prev, *next; /* paused list */
+    void *arg;       /* for the resume function */
+};
+
+struct fchan_credit_limits {
+    uint32_t reqs;
+    uint64_t bytes;
+};
+
+struct fchan_credit_stats {
+    uint64_t reqs;     /* in flight, all connections */
+    uint64_t bytes;
+    uint64_t paused;   /* connections parked now */
+    uint64_t pauses;   /* times a connection was parked */
+    uint64_t conn_reqs; /* the per-connection cap, 0 for none */
+};
+
+/* the resume function is called with the credit lock held, and must
+ * not call back in; if it returns false, cr stays parked and is tried
+ * again at the next release */
+void fchan_credit_init(const struct fchan_credit_limits *conn,
+                       const struct fchan_credit_limits *total,
+                       fchan_credit_resume_fn resume);
+bool fchan_credit_enabled(void);
+
+static inline void
+fchan_credit_setup(struct fchan_credit *cr, void *arg)
+{
+    cr->reqs = 0;
+    cr->bytes = 0;
+    cr->paused = false;
+    cr->held = false;
+    cr->prev = cr->next = NULL;
+    cr->arg = arg;
+}
+
+/* May cr read another request?  If so, its credit is reserved; if
+ * not, cr is parked and the caller should stop reading it until
+ * resumed. */
+bool fchan_credit_reserve(struct fchan_credit *cr);
+
+/* a reserved request was handed off, holding bytes */
+void fchan_credit_charge(struct fchan_credit *cr, uint64_t bytes);
+
+/* a charged request ran in place after all; its bytes come back, and
+ * its credit stays reserved until released */
+void fchan_credit_uncharge(struct fchan_credit *cr, uint64_t bytes);
+
+/* a reserved request completed (bytes as charged, 0 if it never was);
+ * may resume this or other connections */
+void fchan_credit_release(struct fchan_credit *cr, uint64_t bytes);
+
+/* requests cr may have in flight right now, its own included */
+uint32_t fchan_credit_granted(struct fchan_credit *cr);
+
+/* the connection is going away */
+void fchan_credit_forget(struct fchan_credit *cr);
+
+void fchan_credit_stats(struct fchan_credit_stats *st);
+
+#endif /* FCHAN_CREDIT_H */
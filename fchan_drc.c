@@ -0,0 +1,334 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#define _GNU_SOURCE /* struct ucred */
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <sys/un.h>
+
+#include "fchan_drc.h"
+#include "fchan_lru.h"
+#include "fchan_shard.h"
+
+#define DRC_NBUCKETS 256 /* per shard */
+#define DRC_ADDRLEN  sizeof(struct sockaddr_in6)
+
+enum drc_state {
+    DRC_INPROGRESS,
+    DRC_DONE,
+};
+
+struct fchan_drc_entry {
+    /* key */
+    uint8_t addr[DRC_ADDRLEN];
+    uint32_t addrlen;
+    uint32_t xid;
+    uint32_t prog, vers, proc;
+    uint64_t hash;
+
+    enum drc_state state;
+    struct fchan_reply_buf reply;
+    struct fchan_drc_entry *hnext;
+    struct fchan_lru_link lru;
+};
+
+struct drc_shard {
+    pthread_mutex_t mtx; /* first, see fchan_shard.h */
+    struct fchan_drc_entry *buckets[DRC_NBUCKETS];
+    struct fchan_lru lru;
+    struct fchan_drc_stats st; /* with the shard's nentries and bytes */
+} FCHAN_SHARD_ALIGNED;
+
+static struct drc_shard *shards = NULL;
+static uint64_t shard_budget = 0;
+
+/* FNV-1a */
+static inline uint64_t
+drc_hash_bytes(uint64_t h, const void *ptr, uint32_t len)
+{
+    const uint8_t *p = (const uint8_t *) ptr;
+    uint32_t ix;
+
+    for (ix = 0; ix < len; ++ix) {
+        h ^= p[ix];
+        h *= 0x100000001b3ULL;
+    }
+    return (h);
+}
+
+static uint64_t
+drc_hash(const struct fchan_drc_entry *k)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    h = drc_hash_bytes(h, k->addr, k->addrlen);
+    h = drc_hash_bytes(h, &k->xid, sizeof(uint32_t));
+    h = drc_hash_bytes(h, &k->proc, sizeof(uint32_t));
+    return (h);
+}
+
+static inline bool
+drc_key_eq(const struct fchan_drc_entry *a, const struct fchan_drc_entry *b)
+{
+    return ((a->xid == b->xid) && (a->proc == b->proc) &&
+            (a->prog == b->prog) && (a->vers == b->vers) &&
+            (a->addrlen == b->addrlen) &&
+            (memcmp(a->addr, b->addr, a->addrlen) == 0));
+}
+
+static inline struct drc_shard *
+drc_shard(uint64_t h)
+{
+    return (&shards[h % FCHAN_DRC_NSHARDS]);
+}
+
+static inline struct fchan_drc_entry **
+drc_bucket(struct drc_shard *sh, uint64_t h)
+{
+    return (&sh->buckets[(h / FCHAN_DRC_NSHARDS) % DRC_NBUCKETS]);
+}
+
+static inline uint64_t
+drc_entry_size(const struct fchan_drc_entry *de)
+{
+    return (sizeof(struct fchan_drc_entry) + de->reply.len);
+}
+
+/* with sh->mtx held */
+static void
+drc_remove(struct drc_shard *sh, struct fchan_drc_entry *de)
+{
+    struct fchan_drc_entry **dep;
+
+    for (dep = drc_bucket(sh, de->hash); *dep; dep = &(*dep)->hnext) {
+        if (*dep == de) {
+            *dep = de->hnext;
+            break;
+        }
+    }
+    fchan_lru_unlink(&sh->lru, &de->lru);
+    --(sh->st.nentries);
+    sh->st.bytes -= drc_entry_size(de);
+}
+
+/* with sh->mtx held; requests still executing are skipped */
+static void
+drc_evict(struct drc_shard *sh)
+{
+    struct fchan_drc_entry *de, *prev;
+
+    for (de = fchan_lru_entry(sh->lru.tail, struct fchan_drc_entry, lru);
+         de && sh->st.bytes > shard_budget; de = prev) {
+        prev = fchan_lru_entry(de->lru.prev, struct fchan_drc_entry, lru);
+        if (de->state != DRC_DONE)
+            continue;
+        drc_remove(sh, de);
+        ++(sh->st.evictions);
+        fchan_reply_release(&de->reply);
+        free(de);
+    }
+}
+
+/* Every AF_UNIX client has the same (empty) address, so key those by
+ * the peer's credentials instead; a client that reconnects keeps them,
+ * as it would its address.  False if there is nothing to key on. */
+static bool
+drc_key_addr(struct svc_req *req, struct fchan_drc_entry *key)
+{
+    struct netbuf *caller = svc_getrpccaller(req->rq_xprt);
+    struct {
+        sa_family_t family;
+        struct ucred cred;
+    } peer;
+    socklen_t len = sizeof(struct ucred);
+
+    if (caller && caller->len
+        && ((struct sockaddr *) caller->buf)->sa_family != AF_UNIX) {
+        key->addrlen = MIN(caller->len, DRC_ADDRLEN);
+        memcpy(key->addr, caller->buf, key->addrlen);
+        return (true);
+    }
+
+    memset(&peer, 0, sizeof(peer));
+    peer.family = AF_UNIX;
+    if (getsockopt(req->rq_xprt->xp_fd, SOL_SOCKET, SO_PEERCRED, &peer.cred,
+                   &len) < 0)
+        return (false);
+    key->addrlen = sizeof(peer);
+    memcpy(key->addr, &peer, key->addrlen);
+    return (true);
+}
+
+enum fchan_drc_status
+fchan_drc_start(struct svc_req *req, struct fchan_drc_entry **dep,
+                struct fchan_reply_buf *rb)
+{
+    struct fchan_drc_entry *key, *de;
+    struct drc_shard *sh;
+
+    /* no entry, the request just runs uncached */
+    *dep = NULL;
+    key = calloc(1, sizeof(struct fchan_drc_entry));
+    if (! key)
+        return (FCHAN_DRC_NEW);
+    if (! drc_key_addr(req, key)) {
+        free(key);
+        return (FCHAN_DRC_NEW);
+    }
+    key->xid = req->rq_msg->rm_xid;
+    key->prog = req->rq_prog;
+    key->vers = req->rq_vers;
+    key->proc = req->rq_proc;
+    key->hash = drc_hash(key);
+
+    sh = drc_shard(key->hash);
+    pthread_mutex_lock(&sh->mtx);
+    for (de = *drc_bucket(sh, key->hash); de; de = de->hnext) {
+        if ((de->hash == key->hash) && drc_key_eq(de, key))
+            break;
+    }
+
+    if (de) {
+        enum fchan_drc_status status;
+
+        if (de->state == DRC_DONE && fchan_reply_copy(rb, &de->reply)) {
+            fchan_lru_touch(&sh->lru, &de->lru);
+            ++(sh->st.replays);
+            status = FCHAN_DRC_REPLAY;
+        } else {
+            /* still running, or no memory to replay it with; either
+             * way the client retransmits */
+            ++(sh->st.inprogress);
+            status = FCHAN_DRC_INPROGRESS;
+        }
+        pthread_mutex_unlock(&sh->mtx);
+        free(key);
+        *dep = NULL;
+        return (status);
+    }
+
+    /* new request, the key becomes the entry */
+    key->state = DRC_INPROGRESS;
+    key->hnext = *drc_bucket(sh, key->hash);
+    *drc_bucket(sh, key->hash) = key;
+    fchan_lru_push(&sh->lru, &key->lru);
+    ++(sh->st.nentries);
+    sh->st.bytes += drc_entry_size(key);
+    ++(sh->st.misses);
+    if (sh->st.bytes > shard_budget)
+        drc_evict(sh);
+    pthread_mutex_unlock(&sh->mtx);
+
+    *dep = key;
+    return (FCHAN_DRC_NEW);
+}
+
+void
+fchan_drc_finish(struct fchan_drc_entry *de, struct fchan_reply_buf *rb)
+{
+    struct drc_shard *sh = drc_shard(de->hash);
+
+    pthread_mutex_lock(&sh->mtx);
+    de->reply = *rb;
+    de->state = DRC_DONE;
+    sh->st.bytes += rb->len;
+    if (sh->st.bytes > shard_budget)
+        drc_evict(sh);
+    pthread_mutex_unlock(&sh->mtx);
+
+    rb->buf = NULL;
+    rb->len = 0;
+}
+
+void
+fchan_drc_abort(struct fchan_drc_entry *de)
+{
+    struct drc_shard *sh = drc_shard(de->hash);
+
+    pthread_mutex_lock(&sh->mtx);
+    drc_remove(sh, de);
+    pthread_mutex_unlock(&sh->mtx);
+
+    free(de);
+}
+
+int
+fchan_drc_init(uint64_t budget)
+{
+    shards = fchan_shard_alloc(FCHAN_DRC_NSHARDS, sizeof(struct drc_shard));
+    if (! shards)
+        return (ENOMEM);
+
+    shard_budget = budget / FCHAN_DRC_NSHARDS;
+
+    return (0);
+}
+
+void
+fchan_drc_shutdown(void)
+{
+    struct fchan_drc_entry *de;
+    struct drc_shard *sh;
+    int ix;
+
+    if (! shards)
+        return;
+
+    for (ix = 0; ix < FCHAN_DRC_NSHARDS; ++ix) {
+        sh = &shards[ix];
+        while ((de = fchan_lru_entry(sh->lru.head, struct fchan_drc_entry,
+                                     lru))) {
+            fchan_lru_unlink(&sh->lru, &de->lru);
+            fchan_reply_release(&de->reply);
+            free(de);
+        }
+    }
+    fchan_shard_free(shards, FCHAN_DRC_NSHARDS, sizeof(struct drc_shard));
+    shards = NULL;
+}
+
+bool
+fchan_drc_enabled(void)
+{
+    return (shards != NULL);
+}
+
+void
+fchan_drc_stats(struct fchan_drc_stats *st)
+{
+    memset(st, 0, sizeof(struct fchan_drc_stats));
+    if (! shards)
+        return;
+
+    fchan_shard_sum(shards, FCHAN_DRC_NSHARDS, sizeof(struct drc_shard),
+                    offsetof(struct drc_shard, st), (uint64_t *) st,
+                    sizeof(struct fchan_drc_stats) / sizeof(uint64_t));
+}
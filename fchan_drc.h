@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_DRC_H
+#define FCHAN_DRC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <rpc/rpc.h>
+
+#include "fchan_reply.h"
+
+/*
+ * Duplicate request cache for non-idempotent procedures.  Requests are
+ * keyed by caller address (with port), xid, and prog/vers/proc; the
+ * encoded reply is kept so a retransmission is answered without running
+ * the procedure again.  A retransmission that arrives while the
+ * original is still executing is dropped, the client will retry.
+ *
+ * The table is sharded by key hash.  Each shard has its own lock, LRU
+ * and an equal part of the memory budget; completed entries are
+ * evicted oldest first once a shard goes over.
+ */
+
+#define FCHAN_DRC_NSHARDS 32
+
+enum fchan_drc_status {
+    FCHAN_DRC_NEW,        /* run it, then finish or abort the entry */
+    FCHAN_DRC_INPROGRESS, /* drop it */
+    FCHAN_DRC_REPLAY,     /* send the returned reply */
+};
+
+struct fchan_drc_stats {
+    uint64_t misses;
+    uint64_t replays;
+    uint64_t inprogress;
+    uint64_t evictions;
+    uint64_t nentries;
+    uint64_t bytes;
+};
+
+struct fchan_drc_entry;
+
+/* budget in bytes, entries included; returns errno */
+int fchan_drc_init(uint64_t budget);
+void fchan_drc_shutdown(void);
+bool fchan_drc_enabled(void);
+
+/* On REPLAY, rb gets a private copy of the cached reply, which the
+ * caller sends and releases.  On NEW, *dep (if not NULL, when the
+ * request could not be keyed) must later be passed to fchan_drc_finish
+ * or fchan_drc_abort. */
+enum fchan_drc_status fchan_drc_start(struct svc_req *req,
+                                      struct fchan_drc_entry **dep,
+                                      struct fchan_reply_buf *rb);
+
+/* store the encoded reply (the entry takes rb's buffer) */
+void fchan_drc_finish(struct fchan_drc_entry *de, struct fchan_reply_buf *rb);
+
+/* no cacheable reply, forget the request */
+void fchan_drc_abort(struct fchan_drc_entry *de);
+
+void fchan_drc_stats(struct fchan_drc_stats *st);
+
+#endif /* FCHAN_DRC_H */
@@ -0,0 +1,83 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FCHAN_LRU_H
+#define FCHAN_LRU_H
+
+#include <stddef.h>
+
+/*
+ * Intrusive LRU list, for the caches.  Entries embed a struct
+ * fchan_lru_link; the head is the most recently used, and eviction
+ * walks back from the tail.  Callers do their own locking.
+ */
+
+struct fchan_lru_link {
+    struct fchan_lru_link *prev, *next;
+};
+
+struct fchan_lru {
+    struct fchan_lru_link *head, *tail;
+};
+
+/* the entry holding link as member, or NULL for a NULL link */
+#define fchan_lru_entry(link, type, member)                             \
+    ((link) ? (type *) ((char *) (link) - offsetof(type, member)) : NULL)
+
+static inline void
+fchan_lru_unlink(struct fchan_lru *lru, struct fchan_lru_link *e)
+{
+    if (e->prev)
+        e->prev->next = e->next;
+    else
+        lru->head = e->next;
+    if (e->next)
+        e->next->prev = e->prev;
+    else
+        lru->tail = e->prev;
+    e->prev = e->next = NULL;
+}
+
+static inline void
+fchan_lru_push(struct fchan_lru *lru, struct fchan_lru_link *e)
+{
+    e->prev = NULL;
+    e->next = lru->head;
+    if (lru->head)
+        lru->head->prev = e;
+    lru->head = e;
+    if (! lru->tail)
+        lru->tail = e;
+}
+
+/* make e the most recently used */
+static inline void
+fchan_lru_touch(struct fchan_lru *lru, struct fchan_lru_link *e)
+{
+    fchan_lru_unlink(lru, e);
+    fchan_lru_push(lru, e);
+}
+
+#endif /* FCHAN_LRU_H */
@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fchan_objcache.h"
+
+struct fchan_objcache {
+    struct fchan_objcache_obj *head;
+    uint32_t count;
+    struct fchan_objcache_obj *returned; /* pushed by other threads */
+    uint32_t refs;
+    struct fchan_objcache_stats st;
+    uint64_t extra[FCHAN_OBJCACHE_NEXTRA];
+    struct fchan_objcache_pool *pool;
+    struct fchan_objcache *next;
+};
+
+static __thread struct fchan_objcache *tcache[FCHAN_OBJCACHE_MAXPOOLS];
+
+static pthread_mutex_t objcache_mtx = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t objcache_npools = 0;
+
+static inline void *
+objcache_ptr(struct fchan_objcache_pool *pool, struct fchan_objcache_obj *obj)
+{
+    return ((char *) obj - pool->link);
+}
+
+static inline struct fchan_objcache_obj *
+objcache_obj(struct fchan_objcache_pool *pool, void *p)
+{
+    return ((struct fchan_objcache_obj *) ((char *) p + pool->link));
+}
+
+static void
+objcache_free_list(struct fchan_objcache_pool *pool,
+                   struct fchan_objcache_obj *obj)
+{
+    struct fchan_objcache_obj *next;
+
+    for (; obj; obj = next) {
+        next = obj->next;
+        free(objcache_ptr(pool, obj));
+    }
+}
+
+static inline void
+objcache_release(struct fchan_objcache *tc)
+{
+    if (__sync_sub_and_fetch(&tc->refs, 1) == 0) {
+        objcache_free_list(tc->pool, tc->head);
+        objcache_free_list(tc->pool, tc->returned);
+        free(tc);
+    }
+}
+
+static void
+objcache_thread_exit(void *arg)
+{
+    struct fchan_objcache *tc = (struct fchan_objcache *) arg, **tcp;
+    struct fchan_objcache_pool *pool = tc->pool;
+    int ix;
+
+    pthread_mutex_lock(&pool->mtx);
+    for (tcp = &pool->threads; *tcp; tcp = &(*tcp)->next) {
+        if (*tcp == tc) {
+            *tcp = tc->next;
+            break;
+        }
+    }
+    pool->retired.hits += tc->st.hits;
+    pool->retired.misses += tc->st.misses;
+    pool->retired.frees += tc->st.frees;
+    pool->retired.remote += tc->st.remote;
+    for (ix = 0; ix < FCHAN_OBJCACHE_NEXTRA; ++ix)
+        pool->retired_extra[ix] += tc->extra[ix];
+    pthread_mutex_unlock(&pool->mtx);
+
+    tcache[pool->ix] = NULL;
+    objcache_release(tc);
+}
+
+/* the pool's key and slot, made by its first thread; with pool->mtx */
+static bool
+objcache_key(struct fchan_objcache_pool *pool)
+{
+    if (pool->keyed)
+        return (true);
+
+    pthread_mutex_lock(&objcache_mtx);
+    if (objcache_npools < FCHAN_OBJCACHE_MAXPOOLS
+        && pthread_key_create(&pool->key, objcache_thread_exit) == 0) {
+        pool->ix = objcache_npools++;
+        pool->keyed = true;
+    }
+    pthread_mutex_unlock(&objcache_mtx);
+
+    return (pool->keyed);
+}
+
+/* the calling thread's cache, NULL if it can't have one */
+static struct fchan_objcache *
+objcache_tcache(struct fchan_objcache_pool *pool)
+{
+    struct fchan_objcache *tc;
+
+    /* ix is set before keyed, and neither changes after */
+    if (pool->keyed && (tc = tcache[pool->ix]))
+        return (tc);
+
+    tc = calloc(1, sizeof(struct fchan_objcache));
+    if (! tc)
+        return (NULL);
+    tc->refs = 1; /* the thread's own */
+    tc->pool = pool;
+
+    pthread_mutex_lock(&pool->mtx);
+    if (! objcache_key(pool)
+        || pthread_setspecific(pool->key, tc)) {
+        pthread_mutex_unlock(&pool->mtx);
+        free(tc);
+        return (NULL);
+    }
+    tc->next = pool->threads;
+    pool->threads = tc;
+    pthread_mutex_unlock(&pool->mtx);
+
+    tcache[pool->ix] = tc;
+    return (tc);
+}
+
+/* Take back everything other threads put, keeping no more than a full
+ * cache. */
+static void
+objcache_take_back(struct fchan_objcache *tc)
+{
+    struct fchan_objcache_obj *obj, *rest;
+
+    tc->head = __sync_lock_test_and_set(&tc->returned, NULL);
+    for (obj = tc->head; obj; obj = obj->next) {
+        if (++(tc->count) == tc->pool->max) {
+            rest = obj->next;
+            obj->next = NULL;
+            for (obj = rest; obj; obj = obj->next)
+                ++(tc->st.frees);
+            objcache_free_list(tc->pool, rest);
+            break;
+        }
+    }
+}
+
+void *
+fchan_objcache_get(struct fchan_objcache_pool *pool)
+{
+    struct fchan_objcache *tc = objcache_tcache(pool);
+    struct fchan_objcache_obj *obj;
+    void *p;
+
+    if (! tc) {
+        /* nowhere to cache it either; it's freed on put */
+        if (! (p = malloc(pool->size)))
+            return (NULL);
+        obj = objcache_obj(pool, p);
+        obj->next = NULL;
+        obj->cache = NULL;
+        return (p);
+    }
+
+    if (! tc->head && tc->returned)
+        objcache_take_back(tc);
+
+    if ((obj = tc->head)) {
+        tc->head = obj->next;
+        --(tc->count);
+        ++(tc->st.hits);
+        p = objcache_ptr(pool, obj);
+    } else {
+        if (! (p = malloc(pool->size)))
+            return (NULL);
+        obj = objcache_obj(pool, p);
+        ++(tc->st.misses);
+    }
+    __sync_fetch_and_add(&tc->refs, 1);
+
+    obj->next = NULL;
+    obj->cache = tc;
+
+    return (p);
+}
+
+void
+fchan_objcache_put(struct fchan_objcache_pool *pool, void *p)
+{
+    struct fchan_objcache_obj *obj = objcache_obj(pool, p), *head;
+    struct fchan_objcache *owner = obj->cache, *tc;
+
+    if (! owner) {
+        free(p);
+        return;
+    }
+
+    tc = objcache_tcache(pool);
+    if (owner != tc) {
+        /* home to the thread it came from */
+        if (tc)
+            ++(tc->st.remote);
+        do {
+            head = owner->returned;
+            obj->next = head;
+        } while (! __sync_bool_compare_and_swap(&owner->returned, head, obj));
+        objcache_release(owner);
+        return;
+    }
+
+    if (tc->count >= pool->max) {
+        ++(tc->st.frees);
+        free(p);
+    } else {
+        obj->next = tc->head;
+        tc->head = obj;
+        ++(tc->count);
+    }
+    objcache_release(tc);
+}
+
+uint64_t *
+fchan_objcache_extra(struct fchan_objcache_pool *pool)
+{
+    struct fchan_objcache *tc = objcache_tcache(pool);
+
+    return (tc ? tc->extra : NULL);
+}
+
+/* Counters are only written by their owning thread, so a racy sum is
+ * good enough here. */
+void
+fchan_objcache_stats(struct fchan_objcache_pool *pool,
+                     struct fchan_objcache_stats *st, uint64_t *extra)
+{
+    struct fchan_objcache *tc;
+    int ix;
+
+    pthread_mutex_lock(&pool->mtx);
+    *st = pool->retired;
+    if (extra)
+        memcpy(extra, pool->retired_extra, sizeof(pool->retired_extra));
+    for (tc = pool->threads; tc; tc = tc->next) {
+        st->hits += tc->st.hits;
+        st->misses += tc->st.misses;
+        st->frees += tc->st.frees;
+        st->remote += tc->st.remote;
+        for (ix = 0; extra && ix < FCHAN_OBJCACHE_NEXTRA; ++ix)
+            extra[ix] += tc->extra[ix];
+    }
+    pthread_mutex_unlock(&pool->mtx);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FCHAN_OBJCACHE_H
+#define FCHAN_OBJCACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/*
+ * Per-thread object cache, behind the request pool and the arenas.
+ * Each thread keeps a private free list per pool, so the hot path takes
+ * no locks.  The pool's lock is only taken when a thread first uses
+ * it, when the thread exits, and when stats are read.
+ *
+ * An object may be put back on another thread than the one that got
+ * it (as -w workers do).  It goes onto its own cache's return stack,
+ * which the owner takes back when its free list runs dry, so each
+ * cache only ever recycles its own objects.  Every object out, plus
+ * the owner thread itself, holds a reference on its cache; the last
+ * one frees it, so a cache outlives its thread until its objects come
+ * home.
+ *
+ * Objects embed a struct fchan_objcache_obj anywhere in them, at the
+ * offset given to the pool.
+ */
+
+/* owner-written counters a pool's user may keep per thread */
+#define FCHAN_OBJCACHE_NEXTRA 4
+
+/* pools in the process */
+#define FCHAN_OBJCACHE_MAXPOOLS 4
+
+struct fchan_objcache;
+
+struct fchan_objcache_obj {
+    struct fchan_objcache_obj *next;
+    struct fchan_objcache *cache; /* the one it came from, or NULL */
+};
+
+struct fchan_objcache_stats {
+    uint64_t hits;   /* served from the thread cache */
+    uint64_t misses; /* had to malloc */
+    uint64_t frees;  /* cache full, returned to malloc */
+    uint64_t remote; /* put back by another thread */
+};
+
+struct fchan_objcache_pool {
+    size_t size;  /* of an object */
+    size_t link;  /* offset of its struct fchan_objcache_obj */
+    uint32_t max; /* cached per thread before we give them back */
+    pthread_mutex_t mtx;
+    bool keyed; /* under mtx, from here on */
+    uint32_t ix;
+    pthread_key_t key;
+    struct fchan_objcache *threads;
+    struct fchan_objcache_stats retired; /* from exited threads */
+    uint64_t retired_extra[FCHAN_OBJCACHE_NEXTRA];
+};
+
+#define FCHAN_OBJCACHE_POOL_INIT(type, member, max) \
+    { sizeof(type), offsetof(type, member), (max), PTHREAD_MUTEX_INITIALIZER }
+
+/* NULL if out of memory */
+void *fchan_objcache_get(struct fchan_objcache_pool *pool);
+/* may be called on any thread */
+void fchan_objcache_put(struct fchan_objcache_pool *pool, void *p);
+
+/* the calling thread's extra counters, or NULL if it has no cache */
+uint64_t *fchan_objcache_extra(struct fchan_objcache_pool *pool);
+
+/* extra may be NULL, else takes FCHAN_OBJCACHE_NEXTRA counters */
+void fchan_objcache_stats(struct fchan_objcache_pool *pool,
+                          struct fchan_objcache_stats *st, uint64_t *extra);
+
+#endif /* FCHAN_OBJCACHE_H */
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+
+#include "fchan_wq.h"
+#include "fchan_bcache.h"
+#include "fchan_readahead.h"
+
+struct ra_job {
+    uint32_t fileno;
+    uint64_t blkno;
+    uint32_t nblks;
+};
+
+static struct fchan_wq *ra_wq = NULL;
+static uint32_t ra_max_window = 0;
+static struct fchan_ra_stats ra_stats;
+
+static void
+ra_worker(void *arg)
+{
+    struct ra_job *job = (struct ra_job *) arg;
+    uint32_t ix;
+
+    for (ix = 0; ix < job->nblks; ++ix)
+        fchan_bcache_prefetch(job->fileno, job->blkno + ix);
+
+    free(job);
+}
+
+static struct fchan_ra_stream *
+ra_stream(struct fchan_ra_state *ras, uint32_t fileno)
+{
+    struct fchan_ra_stream *s, *lru = &ras->streams[0];
+    int ix;
+
+    for (ix = 0; ix < FCHAN_RA_NSTREAMS; ++ix) {
+        s = &ras->streams[ix];
+        if (s->last_use && s->fileno == fileno)
+            return (s);
+        if (s->last_use < lru->last_use)
+            lru = s;
+    }
+
+    /* recycle the least recently used slot */
+    memset(lru, 0, sizeof(struct fchan_ra_stream));
+    lru->fileno = fileno;
+    return (lru);
+}
+
+void
+fchan_ra_note_read(struct fchan_ra_state *ras, uint32_t fileno,
+                   uint64_t off, uint32_t len)
+{
+    struct fchan_ra_stream *s;
+    struct ra_job *job;
+    uint64_t first, end;
+
+    if (! ra_wq || ! len)
+        return;
+
+    s = ra_stream(ras, fileno);
+    s->last_use = ++(ras->clock);
+
+    if (s->next_off && off == s->next_off) {
+        ++(s->seq);
+        __sync_fetch_and_add(&ra_stats.sequential, 1);
+        /* a stream earns read-ahead on its second sequential READ */
+        if (s->seq >= 2)
+            s->window = s->window ? MIN(s->window * 2, ra_max_window)
+                : MIN(FCHAN_RA_MIN_BLKS, ra_max_window);
+    } else {
+        s->seq = 0;
+        s->window = 0;
+        s->ra_next = 0;
+    }
+    s->next_off = off + len;
+
+    if (! s->window)
+        return;
+
+    /* blocks beyond this READ, not counting ones already scheduled */
+    first = (off + len) / FCHAN_BCACHE_BLKSIZE;
+    end = first + s->window;
+    if (s->ra_next > first)
+        first = s->ra_next;
+    if (first >= end)
+        return;
+
+    job = malloc(sizeof(struct ra_job));
+    if (! job) {
+        /* as for a full queue */
+        __sync_fetch_and_add(&ra_stats.dropped, end - first);
+        return;
+    }
+    job->fileno = fileno;
+    job->blkno = first;
+    job->nblks = end - first;
+
+    if (! fchan_wq_submit(ra_wq, ra_worker, job)) {
+        /* demand reads will fill these; try again next time */
+        __sync_fetch_and_add(&ra_stats.dropped, job->nblks);
+        free(job);
+        return;
+    }
+    __sync_fetch_and_add(&ra_stats.issued, job->nblks);
+    s->ra_next = end;
+}
+
+int
+fchan_ra_init(uint32_t max_window)
+{
+    if (! fchan_bcache_enabled())
+        return (EINVAL);
+
+    ra_max_window = max_window;
+    ra_wq = fchan_wq_create(FCHAN_RA_NTHREADS, FCHAN_RA_DEPTH);
+    if (! ra_wq)
+        return (ENOMEM);
+
+    return (0);
+}
+
+void
+fchan_ra_shutdown(void)
+{
+    if (! ra_wq)
+        return;
+
+    fchan_wq_destroy(ra_wq);
+    ra_wq = NULL;
+}
+
+bool
+fchan_ra_enabled(void)
+{
+    return (ra_wq != NULL);
+}
+
+void
+fchan_ra_stats(struct fchan_ra_stats *st)
+{
+    st->sequential = ra_stats.sequential;
+    st->issued = ra_stats.issued;
+    st->dropped = ra_stats.dropped;
+}
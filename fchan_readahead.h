@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_READAHEAD_H
+#define FCHAN_READAHEAD_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Sequential READ detection and asynchronous read-ahead into the block
+ * cache.  Each connection tracks a few streams, one per fileno; a READ
+ * that starts where the previous one on the same stream ended grows the
+ * stream's window (doubling, up to the configured maximum), anything
+ * else resets it.  Blocks past the current READ, up to the window, are
+ * filled by a small pool of prefetch threads.
+ */
+
+#define FCHAN_RA_NSTREAMS  4 /* per connection */
+#define FCHAN_RA_MIN_BLKS  2 /* initial window */
+#define FCHAN_RA_NTHREADS  2
+#define FCHAN_RA_DEPTH     256
+
+struct fchan_ra_stream {
+    uint32_t fileno;
+    uint32_t seq;        /* consecutive sequential READs */
+    uint32_t window;     /* in blocks, 0 when not streaming */
+    uint64_t next_off;   /* where a sequential READ would start */
+    uint64_t ra_next;    /* first block not yet scheduled */
+    uint64_t last_use;
+};
+
+/* caller serializes access, e.g. under the connection's mutex */
+struct fchan_ra_state {
+    struct fchan_ra_stream streams[FCHAN_RA_NSTREAMS];
+    uint64_t clock;
+};
+
+struct fchan_ra_stats {
+    uint64_t sequential; /* READs that continued a stream */
+    uint64_t issued;     /* blocks scheduled */
+    uint64_t dropped;    /* blocks skipped, prefetch queue full */
+};
+
+/* max_window is in cache blocks; requires the block cache */
+int fchan_ra_init(uint32_t max_window);
+void fchan_ra_shutdown(void);
+bool fchan_ra_enabled(void);
+
+void fchan_ra_note_read(struct fchan_ra_state *ras, uint32_t fileno,
+                        uint64_t off, uint32_t len);
+
+void fchan_ra_stats(struct fchan_ra_stats *st);
+
+#endif /* FCHAN_READAHEAD_H */
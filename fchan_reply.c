@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fchan_reply.h"
+
+static pthread_mutex_t reply_tmpl_mtx = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t reply_tmpl_used = 0;
+
+/* the template a handler chose for the call on this thread */
+static __thread const struct fchan_reply_buf *reply_cur = NULL;
+
+bool_t
+fchan_reply_encode(struct fchan_reply_buf *rb, xdrproc_t proc, void *res)
+{
+    XDR xdrs[1];
+    u_int len;
+
+    len = xdr_sizeof(proc, res);
+    rb->buf = malloc(len ? len : BYTES_PER_XDR_UNIT);
+    rb->len = 0;
+    if (! rb->buf)
+        return (FALSE);
+
+    xdrmem_create(xdrs, rb->buf, len, XDR_ENCODE);
+    if (! (*proc)(xdrs, res)) {
+        XDR_DESTROY(xdrs);
+        fchan_reply_release(rb);
+        return (FALSE);
+    }
+    rb->len = XDR_GETPOS(xdrs);
+    XDR_DESTROY(xdrs);
+
+    return (TRUE);
+}
+
+bool_t
+fchan_reply_copy(struct fchan_reply_buf *to,
+                 const struct fchan_reply_buf *from)
+{
+    to->buf = malloc(from->len ? from->len : BYTES_PER_XDR_UNIT);
+    if (! to->buf) {
+        to->len = 0;
+        return (FALSE);
+    }
+    to->len = from->len;
+    memcpy(to->buf, from->buf, from->len);
+
+    return (TRUE);
+}
+
+void
+fchan_reply_release(struct fchan_reply_buf *rb)
+{
+    free(rb->buf);
+    rb->buf = NULL;
+    rb->len = 0;
+}
+
+bool_t
+xdr_fchan_reply_buf(XDR *xdrs, struct fchan_reply_buf *rb)
+{
+    switch (xdrs->x_op) {
+    case XDR_ENCODE:
+        /* already padded, so no length word and no fill */
+        return (xdr_opaque(xdrs, rb->buf, rb->len));
+    case XDR_FREE:
+        return (TRUE);
+    default:
+        return (FALSE);
+    }
+}
+
+const struct fchan_reply_buf *
+fchan_reply_tmpl_get(struct fchan_reply_tmpl *tmpl)
+{
+    if (! __sync_fetch_and_add(&tmpl->ready, 0)) {
+        pthread_mutex_lock(&reply_tmpl_mtx);
+        if (! tmpl->ready && fchan_reply_encode(&tmpl->rb, tmpl->proc,
+                                                tmpl->res)) {
+            /* the buffer is complete before anyone sees ready */
+            __sync_synchronize();
+            tmpl->ready = 1;
+        }
+        pthread_mutex_unlock(&reply_tmpl_mtx);
+        if (! tmpl->ready)
+            return (NULL);
+    }
+
+    return (&tmpl->rb);
+}
+
+bool_t
+fchan_reply_use(struct fchan_reply_tmpl *tmpl)
+{
+    reply_cur = fchan_reply_tmpl_get(tmpl);
+    if (! reply_cur)
+        return (FALSE);
+
+    __sync_fetch_and_add(&reply_tmpl_used, 1);
+    return (TRUE);
+}
+
+uint64_t
+fchan_reply_tmpl_used(void)
+{
+    return (reply_tmpl_used);
+}
+
+const struct fchan_reply_buf *
+fchan_reply_take(void)
+{
+    const struct fchan_reply_buf *rb = reply_cur;
+
+    reply_cur = NULL;
+    return (rb);
+}
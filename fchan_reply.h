@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_REPLY_H
+#define FCHAN_REPLY_H
+
+#include <stdint.h>
+#include <rpc/rpc.h>
+
+/*
+ * A reply body that has already been XDR encoded.  Sending one through
+ * svc_sendreply with xdr_fchan_reply_buf copies the bytes into the
+ * stream as they are, so a cached result goes out without re-encoding.
+ */
+struct fchan_reply_buf {
+    u_int len; /* always a multiple of BYTES_PER_XDR_UNIT */
+    char *buf;
+};
+
+/* encode res with proc into a fresh buffer; FALSE if encoding fails */
+bool_t fchan_reply_encode(struct fchan_reply_buf *rb, xdrproc_t proc,
+                          void *res);
+
+/* deep copy, e.g. to take a cached reply out from under its lock;
+ * FALSE if out of memory */
+bool_t fchan_reply_copy(struct fchan_reply_buf *to,
+                      const struct fchan_reply_buf *from);
+
+void fchan_reply_release(struct fchan_reply_buf *rb);
+
+/* encode only; decoding a reply this way makes no sense */
+bool_t xdr_fchan_reply_buf(XDR *xdrs, struct fchan_reply_buf *rb);
+
+/*
+ * A reply template: the body of a result that never changes, encoded
+ * the first time it's needed and then sent as is by every call.  A
+ * handler hands it to its dispatcher with fchan_reply_use instead of
+ * filling in a result; the dispatcher then sends the template with
+ * xdr_fchan_reply_buf, so only the RPC header is built per call.
+ */
+struct fchan_reply_tmpl {
+    xdrproc_t proc;
+    void *res;
+    struct fchan_reply_buf rb;
+    uint32_t ready;
+};
+
+#define FCHAN_REPLY_TMPL_INIT(proc, res) \
+    { (xdrproc_t) (proc), (res), { 0, NULL }, 0 }
+
+/* the encoded body, or NULL if it won't encode */
+const struct fchan_reply_buf *fchan_reply_tmpl_get(
+    struct fchan_reply_tmpl *tmpl);
+
+/* called by a handler; FALSE if the template can't be used, and the
+ * handler should fill in its result after all */
+bool_t fchan_reply_use(struct fchan_reply_tmpl *tmpl);
+
+/* replies sent from templates, for STATS */
+uint64_t fchan_reply_tmpl_used(void);
+
+/* called by the dispatcher after each handler: the body to send in
+ * place of the result, or NULL; clears it for the next call */
+const struct fchan_reply_buf *fchan_reply_take(void);
+
+#endif /* FCHAN_REPLY_H */
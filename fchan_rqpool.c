@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+
+#include "fchan_rqpool.h"
+
+/*
+ * Per-thread request cache.  Each event channel thread (and anything
+ * else calling getreq) recycles its own requests; a request handed to
+ * a worker (-w) goes home when put back there.  See fchan_objcache.h.
+ */
+static struct fchan_objcache_pool rqpool =
+    FCHAN_OBJCACHE_POOL_INIT(struct fchan_rq, rq_obj, FCHAN_RQPOOL_MAX);
+
+struct svc_req *
+fchan_rqpool_get(SVCXPRT *xprt)
+{
+    struct fchan_rq *rq;
+
+    rq = fchan_objcache_get(&rqpool);
+    if (! rq)
+        return (NULL);
+
+    rq->rq_flags = FCHAN_RQ_FLAG_NONE;
+    rq->rq_req.rq_xprt = xprt;
+    rq->rq_req.rq_clntcred = &(rq->rq_cred_area[2 * MAX_AUTH_BYTES]);
+
+    return (&rq->rq_req);
+}
+
+void
+fchan_rqpool_put(struct svc_req *req)
+{
+    fchan_objcache_put(&rqpool, (struct fchan_rq *) req);
+}
+
+void
+fchan_rqpool_stats(struct fchan_rqpool_stats *st)
+{
+    struct fchan_objcache_stats ost;
+
+    fchan_objcache_stats(&rqpool, &ost, NULL);
+    st->hits = ost.hits;
+    st->misses = ost.misses;
+    st->frees = ost.frees;
+    st->remote = ost.remote;
+}
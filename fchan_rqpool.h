@@ -0,0 +1,75 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FCHAN_RQPOOL_H
+#define FCHAN_RQPOOL_H
+
+#include <stdint.h>
+#include <rpc/rpc.h>
+
+#include "fchan_objcache.h"
+
+/* size of the authenticator-specific credential area (cf. svc.c) */
+#define FCHAN_RQCRED_SIZE 400
+
+/* max requests cached per thread before we give them back to malloc */
+#define FCHAN_RQPOOL_MAX 64
+
+/* per-request space for a dispatcher that outlives its stack frame */
+#define FCHAN_RQ_SCRATCH_SIZE 512
+
+#define FCHAN_RQ_FLAG_NONE    0x0000
+#define FCHAN_RQ_FLAG_HANDOFF 0x0001 /* another thread now owns it */
+
+/* A pooled request.  The svc_req must be first, since getreq
+ * handlers only see the svc_req pointer. */
+struct fchan_rq {
+    struct svc_req rq_req;
+    struct fchan_objcache_obj rq_obj; /* the thread cache it came from */
+    uint32_t rq_flags;
+    /* decode scratch, rq_clntcred points into it */
+    char rq_cred_area[2 * MAX_AUTH_BYTES + FCHAN_RQCRED_SIZE];
+    uint64_t rq_scratch[FCHAN_RQ_SCRATCH_SIZE / sizeof(uint64_t)];
+};
+
+static inline struct fchan_rq *
+fchan_rq(struct svc_req *req)
+{
+    return ((struct fchan_rq *) req);
+}
+
+struct fchan_rqpool_stats {
+    uint64_t hits;   /* served from the thread cache */
+    uint64_t misses; /* had to malloc */
+    uint64_t frees;  /* cache full, returned to malloc */
+    uint64_t remote; /* put back by another thread */
+};
+
+/* NULL if out of memory */
+struct svc_req *fchan_rqpool_get(SVCXPRT *xprt);
+void fchan_rqpool_put(struct svc_req *req);
+void fchan_rqpool_stats(struct fchan_rqpool_stats *st);
+
+#endif /* FCHAN_RQPOOL_H */
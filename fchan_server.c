@@ -23,12 +23,15 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#define _GNU_SOURCE /* pthread_setaffinity_np */
+
 #include "fchan.h"
 #include "bchan.h"
 
 #include <unistd.h>
 #include <pthread.h>
 
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -36,21 +39,103 @@
 #include <string.h>
 #include <memory.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <sys/signal.h>
 #include <netinet/in.h>
 #include <assert.h>
+#include <sched.h>
+#include <sys/param.h>
+#include <sys/stat.h>
 
 #include <rpc/svc_rqst.h>
 #include <rpc/rpc_dplx.h>
 
 #include "duplex_unit.h"
+#include "fchan_rqpool.h"
+#include "fchan_arena.h"
+#include "fchan_wq.h"
+#include "fchan_backend.h"
+#include "fchan_zcopy.h"
+#include "fchan_bcache.h"
+#include "fchan_readahead.h"
+#include "fchan_stats.h"
+#include "fchan_trace.h"
+#include "fchan_reply.h"
+#include "fchan_drc.h"
+#include "fchan_timer.h"
+#include "fchan_cbclnt.h"
+#include "fchan_session.h"
+#include "fchan_credit.h"
+#include "fchan_udp.h"
+#include "fchan_crc.h"
 
 static uint32_t fchan_id;
-static CLIENT *duplex_clnt = NULL;
 static bool new_style_event_loop = FALSE;
 static bool override_getreq = FALSE;
 static bool signal_shutdown = FALSE;
 static bool verbose = FALSE;
+static bool zero_copy_read = FALSE;
+static bool zero_copy_write = FALSE;
+
+/* largest READ64/WRITE64 transfer (-x), and the most NEGOTIATE grants */
+#define FCHAN_MAXIO_LIMIT (256 * 1024 * 1024)
+static uint64_t fchan_maxio = FCHAN_BACKEND_MAXIO;
+
+/* With -Z, receive buffers are sized so a whole WRITE can sit in one,
+ * header and fixed arguments ahead of the payload included.  Every
+ * connection has one, so they're held to FCHAN_RECV_MAX whatever -x
+ * allows; larger WRITEs are copied out as without -Z. */
+#define FCHAN_RECV_SLACK (8 * 1024)
+#define FCHAN_RECV_MAX (FCHAN_BACKEND_MAXIO + FCHAN_RECV_SLACK)
+
+static inline u_int
+fchan_recvsz(void)
+{
+    if (! zero_copy_write)
+        return (0);
+    return ((u_int) MIN(fchan_maxio + FCHAN_RECV_SLACK, FCHAN_RECV_MAX));
+}
+
+/* sharded event channels (-c), one pinned thread each */
+#define FCHAN_EVCHAN_MAX 256
+
+struct fchan_evchan {
+    uint32_t chan_id;
+    uint32_t ix;
+    uint32_t nxprts; /* xprts currently bound */
+    pthread_t tid;
+};
+
+static struct fchan_evchan *fchan_evchans = NULL;
+static uint32_t n_evchans = 0;
+static uint32_t evchan_rr = 0;
+static bool evchan_least_loaded = FALSE;
+
+/* per-connection state, hung on xp_u1 */
+struct fchan_xprt_private {
+    struct fchan_evchan *evchan;
+    pthread_mutex_t mtx;
+    pthread_cond_t cv;
+    uint32_t inflight; /* requests handed to workers */
+    struct fchan_ra_state ra; /* under mtx */
+    uint64_t sessionid; /* created on this connection, under mtx */
+    struct fchan_credit credit;
+    uint32_t chan_id; /* event channel, if has_chan */
+    bool has_chan;
+    bool parked; /* off its channel for credits, under mtx */
+    bool buffered; /* parked with requests already read in, under mtx */
+    uint32_t resume_gen; /* under mtx */
+    uint64_t maxio; /* granted by NEGOTIATE, 0 if none; under mtx */
+};
+
+/* worker pool for -w; decode stays on the event channel thread */
+static struct fchan_wq *fchan_wq = NULL;
+static uint32_t n_workers = 0;
+
+/* UDP service threads (-u), see fchan_udp.c */
+static uint32_t n_udp_threads = 0;
+
+#define FCHAN_WQ_DEPTH 1024
 
 /* we want the main thread to be the last to exit on shutdown. */
 struct shutdown_semaphore {
@@ -79,6 +164,8 @@ dec_shutdown_sem()
     pthread_mutex_lock(&shutdown_sem.mtx);
     --(shutdown_sem.ctr);
     assert(shutdown_sem.ctr >= 0);
+    if (shutdown_sem.ctr == 0)
+        pthread_cond_broadcast(&shutdown_sem.cv);
     pthread_mutex_unlock(&shutdown_sem.mtx);
 }
 
@@ -94,23 +181,6 @@ barrier_shutdown_sem()
 
 void svc_xprt_dump_xprts(const char *tag);
 
-void
-thread_delay_s(int s)
-{
-    time_t now;
-    struct timespec then;
-    pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
-    pthread_cond_t cv = PTHREAD_COND_INITIALIZER;
-
-    now = time(0);
-    then.tv_sec = now + s;
-    then.tv_nsec = 0;
-    
-    pthread_mutex_lock(&mtx);
-    pthread_cond_timedwait(&cv, &mtx, &then);
-    pthread_mutex_unlock(&mtx);
-}
-
 #define DISP_SLOCK(x) do { \
     if (! slocked) { \
         rpc_dplx_slx((x)); \
@@ -139,35 +209,199 @@ thread_delay_s(int s)
       }\
     } while (0);
 
-static struct svc_req *
-alloc_rpc_request(SVCXPRT *xprt)
+static inline void
+fchan_xprt_inflight_inc(SVCXPRT *xprt)
+{
+    struct fchan_xprt_private *xpp =
+        (struct fchan_xprt_private *) xprt->xp_u1;
+
+    pthread_mutex_lock(&xpp->mtx);
+    ++(xpp->inflight);
+    pthread_mutex_unlock(&xpp->mtx);
+}
+
+static inline void
+fchan_xprt_inflight_dec(SVCXPRT *xprt)
+{
+    struct fchan_xprt_private *xpp =
+        (struct fchan_xprt_private *) xprt->xp_u1;
+
+    pthread_mutex_lock(&xpp->mtx);
+    if (--(xpp->inflight) == 0)
+        pthread_cond_broadcast(&xpp->cv);
+    pthread_mutex_unlock(&xpp->mtx);
+}
+
+/* workers may still be replying on xprt, don't destroy it under them */
+static inline void
+fchan_xprt_drain(SVCXPRT *xprt)
+{
+    struct fchan_xprt_private *xpp =
+        (struct fchan_xprt_private *) xprt->xp_u1;
+
+    if (! xpp)
+        return;
+
+    pthread_mutex_lock(&xpp->mtx);
+    while (xpp->inflight > 0)
+        pthread_cond_wait(&xpp->cv, &xpp->mtx);
+    pthread_mutex_unlock(&xpp->mtx);
+}
+
+/* Out of credits.  The xprt is taken off its event channel and the
+ * caller stops reading it (returns TRUE); buffered says requests were
+ * already read in, which no event would bring back.  FALSE if credits
+ * came back since gen was sampled, and it should try again. */
+static bool
+fchan_xprt_pause(SVCXPRT *xprt, uint32_t gen, bool buffered)
+{
+    struct fchan_xprt_private *xpp =
+        (struct fchan_xprt_private *) xprt->xp_u1;
+    bool paused = FALSE;
+
+    pthread_mutex_lock(&xpp->mtx);
+    if (xpp->resume_gen != gen)
+        goto unlock; /* credits already came back */
+    if (xpp->has_chan && ! xpp->parked) {
+        (void) svc_rqst_evchan_unreg(xpp->chan_id, xprt, SVC_RQST_FLAG_NONE);
+        xpp->parked = TRUE;
+    }
+    if (buffered)
+        xpp->buffered = TRUE;
+    paused = TRUE;
+
+unlock:
+    pthread_mutex_unlock(&xpp->mtx);
+
+    return (paused);
+}
+
+/* Reserve a request's credit before reading one.  FALSE if there is
+ * none, and the xprt is parked until there is. */
+static bool
+fchan_xprt_reserve(SVCXPRT *xprt, bool buffered)
 {
-    struct svc_req *req = malloc(sizeof(struct svc_req));
-    req->rq_xprt = xprt;
-    return (req);
+    struct fchan_xprt_private *xpp =
+        (struct fchan_xprt_private *) xprt->xp_u1;
+    uint32_t gen;
+
+    for (;;) {
+        pthread_mutex_lock(&xpp->mtx);
+        gen = xpp->resume_gen;
+        pthread_mutex_unlock(&xpp->mtx);
+
+        if (fchan_credit_reserve(&xpp->credit))
+            return (TRUE);
+        if (fchan_xprt_pause(xprt, gen, buffered))
+            return (FALSE);
+    }
 }
 
+static bool fchan_xprt_getreq(SVCXPRT *xprt, bool resumed);
+
+/* a parked xprt had requests read in; a worker reads on from there */
 static void
+fchan_xprt_resume_worker(void *arg)
+{
+    SVCXPRT *xprt = (SVCXPRT *) arg;
+
+    if (! fchan_xprt_getreq(xprt, TRUE))
+        fchan_xprt_inflight_dec(xprt);
+}
+
+/* Credits came back; called with the credit lock held.  FALSE if it
+ * has to wait, when a worker is needed and the queue is full. */
+static bool
+fchan_xprt_resume(struct fchan_credit *cr)
+{
+    SVCXPRT *xprt = (SVCXPRT *) cr->arg;
+    struct fchan_xprt_private *xpp =
+        (struct fchan_xprt_private *) xprt->xp_u1;
+
+    pthread_mutex_lock(&xpp->mtx);
+    if (xpp->buffered || ! xpp->has_chan) {
+        /* counted in flight, so it isn't destroyed under the worker */
+        ++(xpp->inflight);
+        if (! fchan_wq_submit(fchan_wq, fchan_xprt_resume_worker, xprt)) {
+            --(xpp->inflight);
+            pthread_mutex_unlock(&xpp->mtx);
+            return (FALSE);
+        }
+        xpp->buffered = FALSE;
+    }
+    ++(xpp->resume_gen);
+    if (xpp->parked) {
+        xpp->parked = FALSE;
+        (void) svc_rqst_evchan_reg(xpp->chan_id, xprt,
+                                   SVC_RQST_FLAG_CHAN_AFFINITY);
+    }
+    pthread_mutex_unlock(&xpp->mtx);
+
+    return (TRUE);
+}
+
+/* set by handlers that reply with an error, for the STATS counters */
+static __thread bool fchan_call_failed = FALSE;
+
+/* set while a handler runs under COMPOUND or SEQUENCE, or on the UDP
+ * path, which report its failure in their own reply */
+static __thread bool fchan_call_nested = FALSE;
+
+static inline void
+fchan_svcerr_systemerr(SVCXPRT *xprt, struct svc_req *req)
+{
+    fchan_call_failed = TRUE;
+    if (! fchan_call_nested)
+        svcerr_systemerr(xprt, req);
+}
+
+/* requests come from a per-thread pool (fchan_rqpool.c), so the
+ * getreq path doesn't malloc once the pool is warm */
+static inline struct svc_req *
+alloc_rpc_request(SVCXPRT *xprt)
+{
+    return (fchan_rqpool_get(xprt));
+}
+
+static inline void
 free_rpc_request(struct svc_req *req)
 {
-    free(req);
+    fchan_rqpool_put(req);
 }
 
-static bool_t
-fchan_server_getreq(SVCXPRT *xprt)
+/* The body of our getreq; resumed is set on a worker reading on from
+ * a parked xprt, which holds one of its in-flight counts.  TRUE if the
+ * xprt was destroyed. */
+static bool
+fchan_xprt_getreq(SVCXPRT *xprt, bool resumed)
 {
     struct svc_req *req;
     bool destroyed = FALSE, recv_status;
     bool rlocked = FALSE, slocked = FALSE;
+    bool credits, reserved = FALSE, buffered = resumed;
     enum xprt_stat stat;
 
-    req = alloc_rpc_request(xprt); /* ! NULL */
+    /* admission control, only handed-off requests hold credits */
+    credits = fchan_credit_enabled() && fchan_wq && xprt->xp_u1;
+
+    /* Without one, leave the xprt be; it's polled again when more
+     * arrives, and anything already read in waits for that. */
+    req = alloc_rpc_request(xprt);
+    if (! req)
+        return (FALSE);
 
     /* serialize recv channel */
     DISP_RLOCK(xprt);
 
     /* now receive msgs from xprt (support batch calls) */
     do {
+        /* a request's credit is taken before it's read */
+        if (credits) {
+            if (! fchan_xprt_reserve(xprt, buffered))
+                break;
+            reserved = TRUE;
+        }
+
         if (SVC_RECV(xprt, req)) {
 
             /* if msg->rm_direction=REPLY, another thread is waiting
@@ -205,6 +439,17 @@ fchan_server_getreq(SVCXPRT *xprt)
         } /* SVC_RECV again */
 
     call_done:
+        /* dispatched to a worker, which now owns req and its credit */
+        if (fchan_rq(req)->rq_flags & FCHAN_RQ_FLAG_HANDOFF) {
+            req = alloc_rpc_request(xprt);
+            reserved = FALSE;
+        }
+        if (reserved) {
+            fchan_credit_release(
+                &((struct fchan_xprt_private *) xprt->xp_u1)->credit, 0);
+            reserved = FALSE;
+        }
+
         /* XXX locking and destructive ops on xprt need to be reviewed */
         if ((stat = SVC_STAT(xprt)) == XPRT_DIED) {
             /* XXX the xp_destroy methods call the new svc_rqst_xprt_unregister
@@ -216,6 +461,9 @@ fchan_server_getreq(SVCXPRT *xprt)
             __warnx(TIRPC_DEBUG_FLAG_SVC,
                     "%s: stat == XPRT_DIED (%p) \n", __func__, xprt);
             DISP_RUNLOCK(xprt);
+            if (resumed)
+                fchan_xprt_inflight_dec(xprt);
+            fchan_xprt_drain(xprt);
             SVC_DESTROY(xprt);
             destroyed = TRUE;
             break;
@@ -229,100 +477,284 @@ fchan_server_getreq(SVCXPRT *xprt)
                 break;
         }
 
+        /* anything more is already read in */
+        buffered = TRUE;
+
+        /* out of requests for the next one, as above */
+        if (! req)
+            break;
+
     } while (stat == XPRT_MOREREQS);
 
-    free_rpc_request(req);
+    if (req)
+        free_rpc_request(req);
 
     if (! destroyed)
         DISP_RUNLOCK(xprt);
+
+    return (destroyed);
+}
+
+static bool_t
+fchan_server_getreq(SVCXPRT *xprt)
+{
+    (void) fchan_xprt_getreq(xprt, FALSE);
+
+    return (TRUE);
 }
 
 AUTH *auth;
 
-static void *
-fchan_callbackthread(void *arg)
+/*
+ * Backchannel callbacks.  Every bound session is a timer on the wheel;
+ * when it fires, one of a few callback threads makes the CALLBACK1 and
+ * re-arms it, so thread count doesn't grow with sessions.
+ */
+#define FCHAN_CB_PERIOD_MS 1000
+#define FCHAN_CB_NTHREADS 4
+#define FCHAN_CB_WQ_DEPTH 1024
+#define FCHAN_CB_RETRY_MS 50 /* when the queue is full */
+
+struct fchan_cb_session {
+    struct fchan_timer timer; /* first */
+    struct fchan_cb_session *prev, *next;
+    CLIENT *cl;
+    uint64_t sessionid; /* callbacks stop with it, if not 0 */
+    bchan_msg arg;
+};
+
+static struct {
+    pthread_mutex_t mtx;
+    struct fchan_cb_session *sessions;
+    uint32_t nsessions;
+    struct fchan_wq *wq;
+    uint64_t deferred; /* the queue was full when it fired */
+    bool running;
+} fchan_cb = {
+    PTHREAD_MUTEX_INITIALIZER
+};
+
+/* with fchan_cb.mtx held */
+static void
+fchan_cb_unlink(struct fchan_cb_session *cs)
 {
-    SVCXPRT *xprt = (SVCXPRT *) arg;
+    if (cs->prev)
+        cs->prev->next = cs->next;
+    else
+        fchan_cb.sessions = cs->next;
+    if (cs->next)
+        cs->next->prev = cs->prev;
+    --(fchan_cb.nsessions);
+}
+
+static void
+fchan_cb_reclaim(struct fchan_cb_session *cs)
+{
+    svc_xprt_dump_xprts("fchan_cb_reclaim"); /* XXXX debugging */
+
+    free(cs->arg.msg1);
+    free(cs->arg.msg2);
+
+    /* reclaim resources */
+    clnt_destroy(cs->cl);
+    free(cs);
+
+    dec_shutdown_sem();
+}
+
+static void
+fchan_cb_call(void *arg)
+{
+    struct fchan_cb_session *cs = (struct fchan_cb_session *) arg;
     enum clnt_stat retval_1;
     bchan_res result_1;
-    bchan_msg callback1_1_arg;
-    CLIENT *cl;
+    uint64_t start;
+    bool rearmed = FALSE;
+
+    if (! signal_shutdown &&
+        ! (cs->sessionid && ! fchan_session_exists(cs->sessionid))) {
+        cs->arg.seqnum++;
+
+        /* XDR's encode and decode routines will only
+         * allocate memory if the relevant destination pointer
+         * is NULL */
+        memset(&result_1, 0, sizeof(bchan_res));
+
+        start = fchan_stats_now();
+        retval_1 = callback1_1(&cs->arg, &result_1, cs->cl);
+        fchan_stats_record(BCHAN_PROG, CALLBACK1, fchan_stats_now() - start,
+                           retval_1 != RPC_SUCCESS);
+        FCHAN_TRACE(FCHAN_TR_CALLBACK1, retval_1, 0, cs->arg.seqnum,
+                    0, 0, 0);
+        if (retval_1 == RPC_SUCCESS) {
+            free(result_1.msg1);
+            pthread_mutex_lock(&fchan_cb.mtx);
+            if (fchan_cb.running) {
+                fchan_timer_add(&cs->timer, FCHAN_CB_PERIOD_MS);
+                rearmed = TRUE;
+            }
+            pthread_mutex_unlock(&fchan_cb.mtx);
+        } else
+            printf("callback failed--client may be gone, session dropped\n");
+    }
+
+    if (! rearmed) {
+        pthread_mutex_lock(&fchan_cb.mtx);
+        fchan_cb_unlink(cs);
+        pthread_mutex_unlock(&fchan_cb.mtx);
+        fchan_cb_reclaim(cs);
+    }
+}
 
-    printf("fchan_callbackthread started\n");
+/* On the wheel thread, which mustn't block on a callback.  With the
+ * queue full, try again shortly; a stopping server drops the session
+ * from fchan_cb_stop. */
+static void
+fchan_cb_expire(struct fchan_timer *t)
+{
+    struct fchan_cb_session *cs = (struct fchan_cb_session *) t;
 
-    inc_shutdown_sem();
+    if (fchan_wq_submit(fchan_cb.wq, fchan_cb_call, cs))
+        return;
 
-    svc_xprt_dump_xprts("fchan_callbackthread before create"); /* XXXX debugging */
+    pthread_mutex_lock(&fchan_cb.mtx);
+    ++(fchan_cb.deferred);
+    if (fchan_cb.running)
+        fchan_timer_add(&cs->timer, FCHAN_CB_RETRY_MS);
+    pthread_mutex_unlock(&fchan_cb.mtx);
+}
+
+static bool
+fchan_cb_session_create(SVCXPRT *xprt, uint64_t sessionid)
+{
+    struct fchan_cb_session *cs;
+
+    cs = calloc(1, sizeof(struct fchan_cb_session));
+    if (! cs)
+        return (FALSE);
+
+    svc_xprt_dump_xprts("fchan_cb_session_create before create"); /* XXXX debugging */
 
     /* convert xprt to a dedicated client channel */
-    cl = clnt_vc_create_svc(
+    cs->cl = clnt_vc_create_svc(
         xprt,
         BCHAN_PROG, BCHANV,
         SVC_VC_CREATE_ONEWAY | SVC_VC_CREATE_DISPOSE);
 
-    if (! cl) {
-        printf("%s: clnt_vc_create_from_svc failed\n");
-        goto out;
+    if (! cs->cl) {
+        printf("%s: clnt_vc_create_from_svc failed\n", __func__);
+        free(cs);
+        return (FALSE);
     }
 
-    svc_xprt_dump_xprts("fchan_callbackthread after create"); /* XXXX debugging */
+    svc_xprt_dump_xprts("fchan_cb_session_create after create"); /* XXXX debugging */
 
-    callback1_1_arg.seqnum = 0;
-    callback1_1_arg.msg1 = strdup("holla");
-    callback1_1_arg.msg2 = strdup("back");
+    cs->sessionid = sessionid;
+    cs->arg.seqnum = 0;
+    cs->arg.msg1 = strdup("holla");
+    cs->arg.msg2 = strdup("back");
+    fchan_timer_setup(&cs->timer, fchan_cb_expire);
 
-    while (1) {
+    inc_shutdown_sem();
 
-	/* arrange to delay every 5s */
-	thread_delay_s(1);
-	if (verbose)
-            printf("fchan_callbackthread wakeup\n");
+    pthread_mutex_lock(&fchan_cb.mtx);
+    if (! fchan_cb.running) {
+        pthread_mutex_unlock(&fchan_cb.mtx);
+        fchan_cb_reclaim(cs);
+        return (FALSE);
+    }
+    cs->next = fchan_cb.sessions;
+    if (cs->next)
+        cs->next->prev = cs;
+    fchan_cb.sessions = cs;
+    ++(fchan_cb.nsessions);
+    fchan_timer_add(&cs->timer, FCHAN_CB_PERIOD_MS);
+    pthread_mutex_unlock(&fchan_cb.mtx);
+
+    return (TRUE);
+}
 
-        if (signal_shutdown)
-            break;
+static int
+fchan_cb_start(void)
+{
+    int code;
 
-	callback1_1_arg.seqnum++;
-	
-	/* XDR's encode and decode routines will only
-	 * allocate memory if the relevant destination pointer
-	 * is NULL */
-	memset(&result_1, 0, sizeof(bchan_res));
+    code = fchan_cbclnt_init();
+    if (code)
+        return (code);
 
-	retval_1 = callback1_1(&callback1_1_arg, &result_1, cl);
-	if (retval_1 != RPC_SUCCESS) {
-	    printf("callback failed--client may be gone, thread return\n");
-            goto reclaim;
-	}
+    fchan_cb.wq = fchan_wq_create(FCHAN_CB_NTHREADS, FCHAN_CB_WQ_DEPTH);
+    if (! fchan_cb.wq) {
+        fchan_cbclnt_shutdown();
+        return (ENOMEM);
+    }
 
-	printf("result: msg1: %s\n", result_1.msg1);
-        free(result_1.msg1);
+    code = fchan_timer_init();
+    if (code) {
+        fchan_wq_destroy(fchan_cb.wq);
+        fchan_cb.wq = NULL;
+        fchan_cbclnt_shutdown();
+        return (code);
     }
 
-reclaim:
-    svc_xprt_dump_xprts("fchan_callbackthread reclaim"); /* XXXX debugging */
+    fchan_cb.running = TRUE;
 
-    free(callback1_1_arg.msg1);
-    free(callback1_1_arg.msg2);
+    return (0);
+}
 
-    /* reclaim resources */
-    clnt_destroy(cl);
+static void
+fchan_cb_stop(void)
+{
+    struct fchan_cb_session *cs;
+
+    if (! fchan_cb.wq)
+        return;
+
+    pthread_mutex_lock(&fchan_cb.mtx);
+    fchan_cb.running = FALSE;
+    pthread_mutex_unlock(&fchan_cb.mtx);
+
+    /* nothing new gets queued once the wheel stops, and calls already
+     * queued drop their sessions rather than re-arm */
+    fchan_timer_shutdown();
+    fchan_wq_destroy(fchan_cb.wq);
+    fchan_cb.wq = NULL;
+
+    /* what's left is parked on the wheel */
+    pthread_mutex_lock(&fchan_cb.mtx);
+    while ((cs = fchan_cb.sessions)) {
+        fchan_timer_cancel(&cs->timer);
+        fchan_cb_unlink(cs);
+        pthread_mutex_unlock(&fchan_cb.mtx);
+        fchan_cb_reclaim(cs);
+        pthread_mutex_lock(&fchan_cb.mtx);
+    }
+    pthread_mutex_unlock(&fchan_cb.mtx);
 
-out:
-    dec_shutdown_sem();
-    return;
-} /* fchan_callbackthread */
+    /* async calls have completed, nothing else holds a CLIENT */
+    fchan_cbclnt_shutdown();
+}
+
+/* SENDMSG1 always answers the same */
+static fchan_res sendmsg1_res = { 0, "freebird" };
+static struct fchan_reply_tmpl sendmsg1_tmpl =
+    FCHAN_REPLY_TMPL_INIT(xdr_fchan_res, &sendmsg1_res);
 
 bool_t
 sendmsg1_1_svc(fchan_msg *argp, fchan_res *result, struct svc_req *req)
 {
     bool_t retval = TRUE;
 
-    if (verbose)
-        printf("svc rcpt fchan_msg msg1: %s msg2: %s seqnum: %d\n",
-               argp->msg1, argp->msg2, argp->seqnum);
+    FCHAN_TRACE(FCHAN_TR_SENDMSG1, 0, req->rq_msg->rm_xid, argp->seqnum,
+                0, 0, 0);
 
-    result->result = 0;
-    result->msg1 = strdup("freebird");
+    /* under COMPOUND, SEQUENCE or UDP the result goes into a larger
+     * reply, so it has to be filled in */
+    if (! fchan_call_nested && fchan_reply_use(&sendmsg1_tmpl))
+        return (retval);
+
+    result->result = sendmsg1_res.result;
+    result->msg1 = fchan_arena_strdup(sendmsg1_res.msg1);
 
     return (retval);
 }
@@ -330,78 +762,302 @@ sendmsg1_1_svc(fchan_msg *argp, fchan_res *result, struct svc_req *req)
 bool_t
 bind_conn_to_session1_1_svc(void *argp, int *result, struct svc_req *req)
 {
-    int r;
     SVCXPRT *xprt = req->rq_xprt;
-    pthread_t fchan_cb_tid = (pthread_t) 0;
-
-    printf("svc rcpt bind_conn_to_session1_1\n");
+    struct fchan_xprt_private *xpp =
+        (struct fchan_xprt_private *) xprt->xp_u1;
+    uint64_t sessionid = 0;
+
+    FCHAN_TRACE(FCHAN_TR_BIND_CONN, 0, req->rq_msg->rm_xid, 0, 0, 0, 0);
+
+    /* the backchannel belongs to the session made on this connection,
+     * if there is one */
+    if (xpp) {
+        pthread_mutex_lock(&xpp->mtx);
+        sessionid = xpp->sessionid;
+        pthread_mutex_unlock(&xpp->mtx);
+    }
 
     /*
      * when we receive this call, we may convert the svc
      * xprtort handle to a client, and call on the backchannel
      */
-    r = pthread_create(&fchan_cb_tid, NULL, &fchan_callbackthread,
-                       (void*) xprt);
+    return (fchan_cb_session_create(xprt, sessionid));
+}
+
+/*
+ * Asynchronous backchannel calls.  The caller fills in a
+ * fchan_cb_async and queues it; a callback thread makes the call and
+ * then runs done, which owns the result (and the fchan_cb_async) from
+ * there on.  Nothing waits for the client inside a forechannel handler.
+ */
+struct fchan_cb_async;
+typedef void (*fchan_cb_done_fn)(struct fchan_cb_async *ca);
+
+struct fchan_cb_async {
+    CLIENT *cl;
+    bchan_msg arg;
+    bchan_res res;
+    enum clnt_stat stat;
+    uint64_t start;
+    fchan_cb_done_fn done;
+};
+
+static void
+fchan_cb_async_call(void *arg)
+{
+    struct fchan_cb_async *ca = (struct fchan_cb_async *) arg;
+    static struct timeval timeout = { /* 25 */ 120, 0 };
 
-    pthread_detach(fchan_cb_tid);
+    memset(&ca->res, 0, sizeof(bchan_res));
+    ca->start = fchan_stats_now();
+    ca->stat = clnt_call(ca->cl, auth, CALLBACK1,
+                         (xdrproc_t) xdr_bchan_msg, (caddr_t) &ca->arg,
+                         (xdrproc_t) xdr_bchan_res, (caddr_t) &ca->res,
+                         timeout);
+    fchan_stats_record(BCHAN_PROG, CALLBACK1, fchan_stats_now() - ca->start,
+                       ca->stat != RPC_SUCCESS);
+    ca->done(ca);
+}
+
+/* if there's no room to queue, the call is made here */
+static void
+fchan_cb_async_submit(struct fchan_cb_async *ca)
+{
+    if (! fchan_cb.wq || ! fchan_wq_submit(fchan_cb.wq, fchan_cb_async_call,
+                                           ca))
+        fchan_cb_async_call(ca);
+}
+
+struct read_1_svc_cb {
+    struct fchan_cb_async ca; /* first */
+    struct fchan_cbclnt *ce;
+    uint32_t fileno;
+    uint32_t off;
+    uint32_t len;
+};
+
+static void
+read_1_svc_callback_done(struct fchan_cb_async *ca)
+{
+    struct read_1_svc_cb *rcb = (struct read_1_svc_cb *) ca;
+
+    FCHAN_TRACE(FCHAN_TR_CALLBACK1, ca->stat, 0, ca->arg.seqnum,
+                rcb->fileno, rcb->off, rcb->len);
+
+    if (ca->stat != RPC_SUCCESS)
+        clnt_perror(ca->cl, "callback1_1 failed");
+    else
+        xdr_free((xdrproc_t) xdr_bchan_res, (caddr_t) &ca->res);
 
-    return ( (r) ? FALSE : TRUE );
+    free(ca->arg.msg1);
+    free(ca->arg.msg2);
+    fchan_cbclnt_put(rcb->ce);
+    free(rcb);
 }
 
-/* Send a synchronous callback on the shared RPC channel. */
+/* Queue a callback on the connection's backchannel; the READ reply
+ * doesn't wait for it. */
 int
 read_1_svc_callback(read_args *args, struct svc_req *rq)
 {
-    enum clnt_stat cl_stat;
-    bchan_msg callback1_1_arg[1];
-    bchan_res callback1_1_res[1];
+    struct read_1_svc_cb *rcb;
 
-    SVCXPRT *xprt = rq->rq_xprt;
-    static struct timeval timeout = { /* 25 */ 120, 0 };
-
-    /* convert xprt to a shared client channel */
-    if (! duplex_clnt)
-        duplex_clnt = clnt_vc_create_svc(
-            xprt,
-            BCHAN_PROG, BCHANV,
-            SVC_VC_CREATE_DISPOSE);
+    rcb = malloc(sizeof(struct read_1_svc_cb));
+    if (! rcb)
+        return (ENOMEM);
 
-    fprintf(stderr, "read_1_svc_callback before call\n");
+    rcb->ca.cl = fchan_cbclnt_get(rq->rq_xprt, &rcb->ce);
+    if (! rcb->ca.cl) {
+        free(rcb);
+        return (ENOTCONN);
+    }
 
-    callback1_1_arg->seqnum = 969;
-    callback1_1_arg->msg1 = strdup("read_1_svc_callback");
-    callback1_1_arg->msg2 = strdup("sync");
+    rcb->ca.arg.seqnum = DUPLEX_UNIT_READ_CB_SEQNUM;
+    rcb->ca.arg.msg1 = strdup("read_1_svc_callback");
+    rcb->ca.arg.msg2 = strdup("async");
+    rcb->ca.done = read_1_svc_callback_done;
+    rcb->fileno = args->fileno;
+    rcb->off = args->off;
+    rcb->len = args->len;
 
-    cl_stat = clnt_call(duplex_clnt, auth, CALLBACK1,
-                        (xdrproc_t) xdr_bchan_msg, (caddr_t) callback1_1_arg,
-                        (xdrproc_t) xdr_bchan_res, (caddr_t) callback1_1_res,
-                        timeout);
+    fchan_cb_async_submit(&rcb->ca);
 
-    if (cl_stat != RPC_SUCCESS)
-        clnt_perror(duplex_clnt, "callback1_1 failed");
-    
     return (0);
 }
 
-bool_t
-read_1_svc(read_args *args, read_res *res, struct svc_req *req)
+/* Reply straight from the backing file; only accepted (stream)
+ * connections get here. */
+static bool_t
+fchan_read_zcopy(uint32_t fileno, uint64_t off, uint32_t len, read_res *res,
+                 struct svc_req *req)
 {
-    bool_t retval = TRUE;
+    struct fchan_backend_file *fe;
+    struct stat st;
+    bool_t sent = FALSE;
+
+    fe = fchan_backend_get(fileno);
+    if (! fe)
+        return (FALSE);
+
+    if (fstat(fchan_backend_fd(fe), &st) == 0) {
+        if (off < st.st_size)
+            len = MIN(len, st.st_size - off);
+        else
+            len = 0;
+        res->eof = (off + len >= st.st_size);
+        res->flags = FCHAN_RES_FLAG_BACKED;
+        res->data.data_len = len; /* for the trace, nothing to free */
+        sent = fchan_zcopy_read_reply(req->rq_xprt, req, res,
+                                      fchan_backend_fd(fe), off, len);
+    }
+
+    fchan_backend_put(fe);
+    return (sent);
+}
+
+/* payload checksums (FCHAN_FLAG_CRC32C), for STATS */
+static struct {
+    uint64_t computed; /* READ data checksummed */
+    uint64_t verified; /* WRITE data matched */
+    uint64_t mismatches; /* WRITE data didn't, and wasn't written */
+} fchan_crc_counts;
 
-    printf("svc rcpt read seqnum: %d fileno %d off %d len %d flags %d\n",
-	   args->seqnum,
-           args->fileno,
-           args->off,
-           args->len,
-           args->flags);
+/* The body of READ and READ64, len already clamped to what the
+ * connection may transfer.  Returns FALSE if the reply went out
+ * zero-copy, or on error with *failed set. */
+static bool_t
+fchan_read(uint16_t ev, uint32_t seqnum, uint32_t fileno, uint64_t off,
+           uint32_t len, uint32_t flags, read_res *res, struct svc_req *req,
+           bool *failed)
+{
+    bool_t retval = TRUE;
 
     memset(res, 0, sizeof(read_res));
+    *failed = FALSE;
+
+    /* the cache serves from memory, so only go zero-copy without it;
+     * inside SEQUENCE or COMPOUND it is part of a larger reply, and a
+     * checksum needs the data in hand */
+    if (zero_copy_read && fchan_backend_enabled() && ! fchan_bcache_enabled()
+        && ! (flags & FCHAN_FLAG_CRC32C) && req->rq_xprt->xp_u1
+        && (req->rq_proc == READ || req->rq_proc == READ64)) {
+        if (fchan_read_zcopy(fileno, off, len, res, req)) {
+            retval = FALSE; /* already replied */
+            goto out;
+        }
+    }
+
+    if (fchan_backend_enabled()) {
+        bool eof;
+        ssize_t nread;
+
+        if (fchan_ra_enabled() && req->rq_xprt->xp_u1) {
+            struct fchan_xprt_private *xpp =
+                (struct fchan_xprt_private *) req->rq_xprt->xp_u1;
+            pthread_mutex_lock(&xpp->mtx);
+            fchan_ra_note_read(&xpp->ra, fileno, off, len);
+            pthread_mutex_unlock(&xpp->mtx);
+        }
 
-    /* in this case, send a pattern */
+        res->data.data_val = fchan_arena_alloc(MAX(len, 1));
+        if (fchan_bcache_enabled())
+            nread = fchan_bcache_read(fileno, off, len, res->data.data_val,
+                                      &eof);
+        else
+            nread = fchan_backend_read(fileno, off, len, res->data.data_val,
+                                       &eof);
+        if (nread < 0) {
+            FCHAN_TRACE(ev, errno, req->rq_msg->rm_xid, seqnum, fileno, off,
+                        len);
+            perror("fchan_backend_read");
+            fchan_arena_free(res->data.data_val);
+            res->data.data_val = NULL;
+            fchan_svcerr_systemerr(req->rq_xprt, req);
+            *failed = TRUE;
+            return (FALSE);
+        }
+        res->data.data_len = nread;
+        res->eof = eof;
+        res->flags = FCHAN_RES_FLAG_BACKED;
+        goto out;
+    }
+
+    /* in this case, send a pattern, no longer than asked for (UDP
+     * READs are cut to fit a datagram) */
     res->flags = 0;
-    res->data.data_len = 32768;
-    res->data.data_val = malloc(32768 * sizeof(char));
-    sprintf(res->data.data_val, "%d %d", args->off, args->len);
+    res->data.data_len = MIN(32768, len);
+    res->data.data_val = fchan_arena_alloc(MAX(res->data.data_len, 1));
+    snprintf(res->data.data_val, MAX(res->data.data_len, 1), "%llu %u",
+             (unsigned long long) off, len);
+
+out:
+    if (retval && (flags & FCHAN_FLAG_CRC32C)) {
+        res->flags |= FCHAN_RES_FLAG_CRC32C;
+        res->flags2 = fchan_crc32c(0, res->data.data_val, res->data.data_len);
+        __sync_fetch_and_add(&fchan_crc_counts.computed, 1);
+    }
+
+    FCHAN_TRACE(ev, 0, req->rq_msg->rm_xid, seqnum, fileno, off,
+                res->data.data_len);
+
+    return (retval);
+}
+
+/* the body of WRITE and WRITE64; with FCHAN_FLAG_CRC32C, crc is the
+ * client's checksum of data */
+static bool_t
+fchan_write(uint16_t ev, uint32_t seqnum, uint32_t fileno, uint64_t off,
+            uint32_t len, const char *data, uint32_t flags, uint32_t crc,
+            write_res *res, struct svc_req *req)
+{
+    memset(res, 0, sizeof(write_res));
+
+    if (flags & FCHAN_FLAG_CRC32C) {
+        if (fchan_crc32c(0, data, len) != crc) {
+            /* damaged on the way; don't store it, and tell the client
+             * in the reply rather than failing the call */
+            FCHAN_TRACE(ev, EBADMSG, req->rq_msg->rm_xid, seqnum, fileno,
+                        off, len);
+            __sync_fetch_and_add(&fchan_crc_counts.mismatches, 1);
+            fchan_call_failed = TRUE;
+            res->flags = FCHAN_RES_FLAG_BADCRC;
+            return (TRUE);
+        }
+        __sync_fetch_and_add(&fchan_crc_counts.verified, 1);
+    }
+
+    if (fchan_backend_enabled()) {
+        ssize_t nwritten;
+
+        nwritten = fchan_backend_write(fileno, off, len, data);
+        if (fchan_bcache_enabled())
+            fchan_bcache_invalidate(fileno, off, len);
+        if (nwritten < 0) {
+            FCHAN_TRACE(ev, errno, req->rq_msg->rm_xid, seqnum, fileno, off,
+                        len);
+            perror("fchan_backend_write");
+            fchan_svcerr_systemerr(req->rq_xprt, req);
+            return (FALSE);
+        }
+        res->flags = FCHAN_RES_FLAG_BACKED;
+    }
+
+    FCHAN_TRACE(ev, 0, req->rq_msg->rm_xid, seqnum, fileno, off, len);
+
+    return (TRUE);
+}
+
+bool_t
+read_1_svc(read_args *args, read_res *res, struct svc_req *req)
+{
+    bool_t retval;
+    bool failed;
+
+    retval = fchan_read(FCHAN_TR_READ, args->seqnum, args->fileno, args->off,
+                        MIN(args->len, FCHAN_BACKEND_MAXIO), args->flags, res,
+                        req, &failed);
+    if (failed)
+        return (FALSE);
 
     if (args->flags & DUPLEX_UNIT_IMMED_CB) {
         read_1_svc_callback(args, req);
@@ -413,98 +1069,1176 @@ read_1_svc(read_args *args, read_res *res, struct svc_req *req)
 bool_t
 write_1_svc(write_args *args, write_res *res, struct svc_req *req)
 {
-    bool_t retval = TRUE;
-
-    printf("svc rcpt write seqnum: %d fileno %d off %d len %d flags %d\n",
-	   args->seqnum,
-           args->fileno,
-           args->off,
-           args->len,
-           args->flags);
+    return (fchan_write(FCHAN_TR_WRITE, args->seqnum, args->fileno,
+                        args->off, args->data.data_len, args->data.data_val,
+                        args->flags, args->flags2, res, req));
+}
 
-    /* do something with data */
+/* what READ64 and WRITE64 may move on this connection */
+static inline uint64_t
+fchan_xprt_maxio(SVCXPRT *xprt)
+{
+    struct fchan_xprt_private *xpp =
+        (struct fchan_xprt_private *) xprt->xp_u1;
+    uint64_t maxio = 0;
+
+    if (xpp) {
+        pthread_mutex_lock(&xpp->mtx);
+        maxio = xpp->maxio;
+        pthread_mutex_unlock(&xpp->mtx);
+    }
+    return (maxio ? maxio : fchan_maxio);
+}
 
-    memset(res, 0, sizeof(write_res));
+bool_t
+negotiate_2_svc(negotiate_args *args, negotiate_res *res,
+                struct svc_req *req)
+{
+    struct fchan_xprt_private *xpp =
+        (struct fchan_xprt_private *) req->rq_xprt->xp_u1;
+
+    memset(res, 0, sizeof(negotiate_res));
+    res->maxio = fchan_maxio;
+    if (args->maxio && (args->maxio < fchan_maxio))
+        res->maxio = args->maxio;
+
+    /* only connections have anywhere to keep it */
+    if (xpp) {
+        pthread_mutex_lock(&xpp->mtx);
+        xpp->maxio = res->maxio;
+        pthread_mutex_unlock(&xpp->mtx);
+    }
 
-    return (retval);
+    return (TRUE);
 }
 
-#ifndef SIG_PF
-#define SIG_PF void(*)(int)
-#endif
+bool_t
+read64_2_svc(read64_args *args, read_res *res, struct svc_req *req)
+{
+    bool failed;
 
-/* !! Regenerate in fchan_svc.c */
+    return (fchan_read(FCHAN_TR_READ64, args->seqnum, args->fileno,
+                       args->off,
+                       MIN(args->len, fchan_xprt_maxio(req->rq_xprt)),
+                       args->flags, res, req, &failed));
+}
 
-static void
-fchan_prog_1(struct svc_req *req, register SVCXPRT *xprt)
+bool_t
+write64_2_svc(write64_args *args, write_res *res, struct svc_req *req)
 {
-	union {
-		fchan_msg sendmsg1_1_arg;
-		read_args read_1_arg;
-		write_args write_1_arg;
-	} argument;
-	union {
-		fchan_res sendmsg1_1_res;
-		int bind_conn_to_session1_1_res;
-		read_res read_1_res;
-		write_res write_1_res;
-	} result;
-	bool_t retval;
-	xdrproc_t _xdr_argument, _xdr_result;
-	bool_t (*local)(char *, void *, struct svc_req *);
+    if (args->data.data_len > fchan_xprt_maxio(req->rq_xprt)) {
+        FCHAN_TRACE(FCHAN_TR_WRITE64, EFBIG, req->rq_msg->rm_xid,
+                    args->seqnum, args->fileno, args->off,
+                    args->data.data_len);
+        memset(res, 0, sizeof(write_res));
+        fchan_svcerr_systemerr(req->rq_xprt, req);
+        return (FALSE);
+    }
 
-        /* XXXX valgrind warns these used uninitialized */
-        memset(&argument, 0, sizeof(argument));
-        memset(&result, 0, sizeof(result));
+    return (fchan_write(FCHAN_TR_WRITE64, args->seqnum, args->fileno,
+                        args->off, args->data.data_len, args->data.data_val,
+                        args->flags, args->flags2, res, req));
+}
 
-	switch (req->rq_proc) {
-	case NULLPROC:
-            (void) svc_sendreply(xprt, req, (xdrproc_t) xdr_void, (char *)NULL);
-		return;
+/* the rest of version 2 is version 1's */
+bool_t
+sendmsg1_2_svc(fchan_msg *args, fchan_res *res, struct svc_req *req)
+{
+    return (sendmsg1_1_svc(args, res, req));
+}
 
-	case SENDMSG1:
-		_xdr_argument = (xdrproc_t) xdr_fchan_msg;
-		_xdr_result = (xdrproc_t) xdr_fchan_res;
-		local = (bool_t (*) (char *, void *,  struct svc_req *))sendmsg1_1_svc;
+bool_t
+bind_conn_to_session1_2_svc(void *args, int *res, struct svc_req *req)
+{
+    return (bind_conn_to_session1_1_svc(args, res, req));
+}
+
+bool_t
+read_2_svc(read64_args *args, read_res *res, struct svc_req *req)
+{
+    return (read64_2_svc(args, res, req));
+}
+
+bool_t
+write_2_svc(write64_args *args, write_res *res, struct svc_req *req)
+{
+    return (write64_2_svc(args, res, req));
+}
+
+bool_t
+stats_2_svc(void *args, stats_res *res, struct svc_req *req)
+{
+    return (stats_1_svc(args, res, req));
+}
+
+bool_t
+create_session_2_svc(create_session_args *args, create_session_res *res,
+                     struct svc_req *req)
+{
+    return (create_session_1_svc(args, res, req));
+}
+
+bool_t
+destroy_session_2_svc(u_quad_t *args, u_int *res, struct svc_req *req)
+{
+    return (destroy_session_1_svc(args, res, req));
+}
+
+bool_t
+sequence_2_svc(sequence_args *args, sequence_res *res, struct svc_req *req)
+{
+    return (sequence_1_svc(args, res, req));
+}
+
+bool_t
+compound_2_svc(compound_args *args, compound_res *res, struct svc_req *req)
+{
+    return (compound_1_svc(args, res, req));
+}
+
+bool_t
+readv_2_svc(readv_args *args, readv_res *res, struct svc_req *req)
+{
+    return (readv_1_svc(args, res, req));
+}
+
+bool_t
+writev_2_svc(writev_args *args, writev_res *res, struct svc_req *req)
+{
+    return (writev_1_svc(args, res, req));
+}
+
+/* The extents are clamped, in order, to FCHAN_BACKEND_MAXIO in all,
+ * and go to the backend together; through the block cache they are
+ * read one by one. */
+bool_t
+readv_1_svc(readv_args *args, readv_res *res, struct svc_req *req)
+{
+    struct fchan_backend_extent ext[FCHAN_IOV_MAX];
+    u_int n = args->extents.extents_len;
+    uint64_t total = 0;
+    ssize_t nread, n1;
+    bool eof = false, eof1;
+    u_int ix;
+
+    memset(res, 0, sizeof(readv_res));
+
+    for (ix = 0; ix < n; ++ix) {
+        ext[ix].off = args->extents.extents_val[ix].off;
+        ext[ix].len = MIN(args->extents.extents_val[ix].len,
+                          FCHAN_BACKEND_MAXIO - total);
+        total += ext[ix].len;
+    }
+
+    res->lens.lens_len = n;
+    res->lens.lens_val = fchan_arena_calloc(MAX(n, 1), sizeof(u_int));
+    res->data.data_val = fchan_arena_alloc(MAX(total, 1));
+
+    if (! fchan_backend_enabled()) {
+        /* as READ, no backing store; extents come back zero-filled */
+        for (ix = 0; ix < n; ++ix)
+            res->lens.lens_val[ix] = ext[ix].len;
+        memset(res->data.data_val, 0, total);
+        res->data.data_len = total;
+        goto out;
+    }
+
+    if (fchan_bcache_enabled()) {
+        for (nread = 0, ix = 0; ix < n; ++ix) {
+            if (! ext[ix].len)
+                continue;
+            n1 = fchan_bcache_read(args->fileno, ext[ix].off, ext[ix].len,
+                                   res->data.data_val + nread, &eof1);
+            if (n1 < 0) {
+                nread = -1;
+                break;
+            }
+            res->lens.lens_val[ix] = n1;
+            nread += n1;
+            eof |= eof1;
+        }
+    } else
+        nread = fchan_backend_readv(args->fileno, ext, n, res->data.data_val,
+                                    res->lens.lens_val, &eof);
+    if (nread < 0) {
+        FCHAN_TRACE(FCHAN_TR_READV, errno, req->rq_msg->rm_xid,
+                    args->seqnum, args->fileno, n, total);
+        perror("fchan_backend_readv");
+        fchan_arena_free(res->lens.lens_val);
+        fchan_arena_free(res->data.data_val);
+        memset(res, 0, sizeof(readv_res));
+        fchan_svcerr_systemerr(req->rq_xprt, req);
+        return (FALSE);
+    }
+    res->data.data_len = nread;
+    res->eof = eof;
+    res->flags = FCHAN_RES_FLAG_BACKED;
+
+out:
+    FCHAN_TRACE(FCHAN_TR_READV, 0, req->rq_msg->rm_xid, args->seqnum,
+                args->fileno, n, res->data.data_len);
+
+    return (TRUE);
+}
+
+bool_t
+writev_1_svc(writev_args *args, writev_res *res, struct svc_req *req)
+{
+    struct fchan_backend_extent ext[FCHAN_IOV_MAX];
+    u_int n = args->extents.extents_len;
+    uint64_t total = 0;
+    ssize_t nwritten;
+    u_int ix;
+
+    memset(res, 0, sizeof(writev_res));
+
+    for (ix = 0; ix < n; ++ix) {
+        ext[ix].off = args->extents.extents_val[ix].off;
+        ext[ix].len = args->extents.extents_val[ix].len;
+        total += ext[ix].len;
+    }
+
+    /* the data is the extents' back to back, nothing more or less */
+    if (total != args->data.data_len) {
+        FCHAN_TRACE(FCHAN_TR_WRITEV, EINVAL, req->rq_msg->rm_xid,
+                    args->seqnum, args->fileno, n, args->data.data_len);
+        fchan_svcerr_systemerr(req->rq_xprt, req);
+        return (FALSE);
+    }
+
+    if (fchan_backend_enabled()) {
+        nwritten = fchan_backend_writev(args->fileno, ext, n,
+                                        args->data.data_val);
+        if (fchan_bcache_enabled())
+            for (ix = 0; ix < n; ++ix)
+                fchan_bcache_invalidate(args->fileno, ext[ix].off,
+                                        ext[ix].len);
+        if (nwritten < 0) {
+            FCHAN_TRACE(FCHAN_TR_WRITEV, errno, req->rq_msg->rm_xid,
+                        args->seqnum, args->fileno, n, total);
+            perror("fchan_backend_writev");
+            fchan_svcerr_systemerr(req->rq_xprt, req);
+            return (FALSE);
+        }
+        res->flags = FCHAN_RES_FLAG_BACKED;
+    }
+    res->count = total;
+
+    FCHAN_TRACE(FCHAN_TR_WRITEV, 0, req->rq_msg->rm_xid, args->seqnum,
+                args->fileno, n, total);
+
+    return (TRUE);
+}
+
+/* everything STATS reports, also dumped on SIGUSR1 */
+static void
+fchan_server_stats(stats_res *res)
+{
+    struct fchan_rqpool_stats rqst;
+    struct fchan_arena_stats arst;
+    struct fchan_session_stats sest;
+
+    fchan_stats_fill(res);
+
+    fchan_rqpool_stats(&rqst);
+    fchan_stats_counter(res, "rqpool.hits", rqst.hits);
+    fchan_stats_counter(res, "rqpool.misses", rqst.misses);
+    fchan_stats_counter(res, "rqpool.frees", rqst.frees);
+    fchan_stats_counter(res, "rqpool.remote", rqst.remote);
+
+    fchan_arena_stats(&arst);
+    fchan_stats_counter(res, "arena.hits", arst.hits);
+    fchan_stats_counter(res, "arena.misses", arst.misses);
+    fchan_stats_counter(res, "arena.frees", arst.frees);
+    fchan_stats_counter(res, "arena.allocs", arst.allocs);
+    fchan_stats_counter(res, "arena.overflows", arst.overflows);
+    fchan_stats_counter(res, "arena.borrowed", arst.borrowed);
+    fchan_stats_counter(res, "arena.borrowed_bytes", arst.borrowed_bytes);
+    fchan_stats_counter(res, "arena.remote", arst.remote);
+
+    fchan_stats_counter(res, "reply.templated", fchan_reply_tmpl_used());
+
+    if (fchan_backend_enabled()) {
+        struct fchan_backend_stats best;
+        fchan_backend_stats(&best);
+        fchan_stats_counter(res, "fdcache.hits", best.fd_hits);
+        fchan_stats_counter(res, "fdcache.misses", best.fd_misses);
+        fchan_stats_counter(res, "fdcache.evictions", best.fd_evictions);
+    }
+
+    if (fchan_bcache_enabled()) {
+        struct fchan_bcache_stats bcst;
+        fchan_bcache_stats(&bcst);
+        fchan_stats_counter(res, "bcache.hits", bcst.hits);
+        fchan_stats_counter(res, "bcache.misses", bcst.misses);
+        fchan_stats_counter(res, "bcache.evictions", bcst.evictions);
+        fchan_stats_counter(res, "bcache.invalidations", bcst.invalidations);
+        fchan_stats_counter(res, "bcache.blocks", bcst.nblocks);
+        fchan_stats_counter(res, "bcache.max_blocks", bcst.max_blocks);
+        fchan_stats_counter(res, "bcache.prefetched", bcst.prefetched);
+        fchan_stats_counter(res, "bcache.prefetch_hits", bcst.prefetch_hits);
+    }
+
+    if (fchan_ra_enabled()) {
+        struct fchan_ra_stats rast;
+        fchan_ra_stats(&rast);
+        fchan_stats_counter(res, "readahead.sequential", rast.sequential);
+        fchan_stats_counter(res, "readahead.issued", rast.issued);
+        fchan_stats_counter(res, "readahead.dropped", rast.dropped);
+    }
+
+    if (fchan_drc_enabled()) {
+        struct fchan_drc_stats drst;
+        fchan_drc_stats(&drst);
+        fchan_stats_counter(res, "drc.misses", drst.misses);
+        fchan_stats_counter(res, "drc.replays", drst.replays);
+        fchan_stats_counter(res, "drc.inprogress", drst.inprogress);
+        fchan_stats_counter(res, "drc.evictions", drst.evictions);
+        fchan_stats_counter(res, "drc.entries", drst.nentries);
+        fchan_stats_counter(res, "drc.bytes", drst.bytes);
+    }
+
+    fchan_stats_counter(res, "callback.sessions", fchan_cb.nsessions);
+    fchan_stats_counter(res, "callback.deferred", fchan_cb.deferred);
+
+    if (fchan_cb.wq) {
+        struct fchan_cbclnt_stats cbst;
+        fchan_cbclnt_stats(&cbst);
+        fchan_stats_counter(res, "cbclnt.created", cbst.created);
+        fchan_stats_counter(res, "cbclnt.destroyed", cbst.destroyed);
+        fchan_stats_counter(res, "cbclnt.clients", cbst.nclients);
+    }
+
+    fchan_session_stats(&sest);
+    fchan_stats_counter(res, "session.created", sest.created);
+    fchan_stats_counter(res, "session.destroyed", sest.destroyed);
+    fchan_stats_counter(res, "session.expired", sest.expired);
+    fchan_stats_counter(res, "session.sessions", sest.nsessions);
+    fchan_stats_counter(res, "session.replays", sest.replays);
+    fchan_stats_counter(res, "session.misordered", sest.misordered);
+    fchan_stats_counter(res, "session.cached_bytes", sest.cached_bytes);
+
+    if (fchan_credit_enabled()) {
+        struct fchan_credit_stats crst;
+        fchan_credit_stats(&crst);
+        fchan_stats_counter(res, "credit.reqs", crst.reqs);
+        fchan_stats_counter(res, "credit.bytes", crst.bytes);
+        fchan_stats_counter(res, "credit.paused", crst.paused);
+        fchan_stats_counter(res, "credit.pauses", crst.pauses);
+        fchan_stats_counter(res, "credit.conn_reqs", crst.conn_reqs);
+    }
+
+    fchan_stats_counter(res, "crc.hw", fchan_crc32c_hw());
+    fchan_stats_counter(res, "crc.computed", fchan_crc_counts.computed);
+    fchan_stats_counter(res, "crc.verified", fchan_crc_counts.verified);
+    fchan_stats_counter(res, "crc.mismatches", fchan_crc_counts.mismatches);
+
+    if (zero_copy_read) {
+        struct fchan_zcopy_stats zst;
+        fchan_zcopy_stats(&zst);
+        fchan_stats_counter(res, "zcopy.replies", zst.replies);
+        fchan_stats_counter(res, "zcopy.bytes", zst.bytes);
+        fchan_stats_counter(res, "zcopy.failed", zst.failed);
+    }
+
+    if (fchan_udp_enabled()) {
+        struct fchan_udp_stats ust;
+        fchan_udp_stats(&ust);
+        fchan_stats_counter(res, "udp.datagrams", ust.datagrams);
+        fchan_stats_counter(res, "udp.batches", ust.batches);
+        fchan_stats_counter(res, "udp.replies", ust.replies);
+        fchan_stats_counter(res, "udp.drops", ust.drops);
+    }
+
+    /* where -c placed connections */
+    if (n_evchans) {
+        char name[32];
+        uint32_t ix;
+
+        fchan_stats_counter(res, "evchan.count", n_evchans);
+        for (ix = 0; ix < n_evchans; ++ix) {
+            snprintf(name, sizeof(name), "evchan.%u.xprts", ix);
+            fchan_stats_counter(res, name, fchan_evchans[ix].nxprts);
+        }
+    }
+}
+
+bool_t
+stats_1_svc(void *argp, stats_res *res, struct svc_req *req)
+{
+    memset(res, 0, sizeof(stats_res));
+    fchan_server_stats(res);
+
+    return (TRUE);
+}
+
+#ifndef SIG_PF
+#define SIG_PF void(*)(int)
+#endif
+
+/* !! Regenerate in fchan_svc.c */
+
+union fchan_prog_1_argument {
+	fchan_msg sendmsg1_1_arg;
+	read_args read_1_arg;
+	write_args write_1_arg;
+	create_session_args create_session_1_arg;
+	u_quad_t destroy_session_1_arg;
+	sequence_args sequence_1_arg;
+	compound_args compound_1_arg;
+	readv_args readv_1_arg;
+	writev_args writev_1_arg;
+	negotiate_args negotiate_2_arg;
+	read64_args read64_2_arg;
+	write64_args write64_2_arg;
+	bind_conn_args bind_conn_to_session_2_arg;
+};
+
+union fchan_prog_1_result {
+	fchan_res sendmsg1_1_res;
+	int bind_conn_to_session1_1_res;
+	read_res read_1_res;
+	write_res write_1_res;
+	stats_res stats_1_res;
+	create_session_res create_session_1_res;
+	u_int destroy_session_1_res;
+	sequence_res sequence_1_res;
+	compound_res compound_1_res;
+	readv_res readv_1_res;
+	writev_res writev_1_res;
+	negotiate_res negotiate_2_res;
+	read_res read64_2_res;
+	write_res write64_2_res;
+	u_int bind_conn_to_session_2_res;
+};
+
+/* The session lives while the connection does, and for a lease after,
+ * unless destroyed; a connection only holds its latest session.  Over
+ * a connection without our private (UDP), it's left on its lease. */
+static u_int
+fchan_session_bind_xprt(SVCXPRT *xprt, uint64_t sessionid,
+                        const struct fchan_session_owner *owner)
+{
+    struct fchan_xprt_private *xpp =
+        (struct fchan_xprt_private *) xprt->xp_u1;
+    uint64_t prev;
+    u_int status;
+
+    status = fchan_session_bind(sessionid, owner);
+    if (status != FCHAN_SESS_OK)
+        return (status);
+
+    if (! xpp) {
+        fchan_session_unbind(sessionid);
+        return (status);
+    }
+
+    pthread_mutex_lock(&xpp->mtx);
+    prev = xpp->sessionid;
+    xpp->sessionid = sessionid;
+    pthread_mutex_unlock(&xpp->mtx);
+    if (prev)
+        fchan_session_unbind(prev);
+
+    return (status);
+}
+
+bool_t
+create_session_1_svc(create_session_args *args, create_session_res *res,
+                     struct svc_req *req)
+{
+    struct fchan_session_owner owner;
+
+    fchan_session_owner(req, &owner);
+    memset(res, 0, sizeof(create_session_res));
+    res->status = fchan_session_create(&owner, args->nslots, args->maxcache,
+                                       &res->sessionid, &res->nslots,
+                                       &res->maxcache);
+
+    if (res->status == FCHAN_SESS_OK)
+        (void) fchan_session_bind_xprt(req->rq_xprt, res->sessionid, &owner);
+
+    return (TRUE);
+}
+
+/* a reconnected client picks up its session again */
+bool_t
+bind_conn_to_session_2_svc(bind_conn_args *args, u_int *res,
+                           struct svc_req *req)
+{
+    struct fchan_session_owner owner;
+
+    fchan_session_owner(req, &owner);
+    *res = fchan_session_bind_xprt(req->rq_xprt, args->sessionid, &owner);
+
+    return (TRUE);
+}
+
+bool_t
+destroy_session_1_svc(u_quad_t *sessionid, u_int *res, struct svc_req *req)
+{
+    struct fchan_xprt_private *xpp =
+        (struct fchan_xprt_private *) req->rq_xprt->xp_u1;
+    struct fchan_session_owner owner;
+
+    fchan_session_owner(req, &owner);
+    *res = fchan_session_destroy(*sessionid, &owner);
+
+    if (xpp) {
+        pthread_mutex_lock(&xpp->mtx);
+        if (xpp->sessionid == *sessionid)
+            xpp->sessionid = 0;
+        pthread_mutex_unlock(&xpp->mtx);
+    }
+
+    return (TRUE);
+}
+
+/* procedures that may be sent through SEQUENCE; in version 2, READ
+ * and WRITE are READ64 and WRITE64 */
+static bool
+fchan_sequence_proc(u_int vers, u_int proc, xdrproc_t *xdr_argument,
+                    xdrproc_t *xdr_result,
+                    bool_t (**local)(char *, void *, struct svc_req *))
+{
+    if (vers == FCHANV2) {
+        if (proc == READ)
+            proc = READ64;
+        else if (proc == WRITE)
+            proc = WRITE64;
+    }
+
+    switch (proc) {
+    case SENDMSG1:
+        *xdr_argument = (xdrproc_t) xdr_fchan_msg;
+        *xdr_result = (xdrproc_t) xdr_fchan_res;
+        *local = (bool_t (*) (char *, void *,  struct svc_req *))sendmsg1_1_svc;
+        return (TRUE);
+    case READ:
+        *xdr_argument = (xdrproc_t) xdr_read_args;
+        *xdr_result = (xdrproc_t) xdr_read_res;
+        *local = (bool_t (*) (char *, void *,  struct svc_req *))read_1_svc;
+        return (TRUE);
+    case WRITE:
+        *xdr_argument = (xdrproc_t) xdr_write_args;
+        *xdr_result = (xdrproc_t) xdr_write_res;
+        *local = (bool_t (*) (char *, void *,  struct svc_req *))write_1_svc;
+        return (TRUE);
+    case COMPOUND:
+        *xdr_argument = (xdrproc_t) xdr_compound_args;
+        *xdr_result = (xdrproc_t) xdr_compound_res;
+        *local = (bool_t (*) (char *, void *,  struct svc_req *))compound_1_svc;
+        return (TRUE);
+    case READV:
+        *xdr_argument = (xdrproc_t) xdr_readv_args;
+        *xdr_result = (xdrproc_t) xdr_readv_res;
+        *local = (bool_t (*) (char *, void *,  struct svc_req *))readv_1_svc;
+        return (TRUE);
+    case WRITEV:
+        *xdr_argument = (xdrproc_t) xdr_writev_args;
+        *xdr_result = (xdrproc_t) xdr_writev_res;
+        *local = (bool_t (*) (char *, void *,  struct svc_req *))writev_1_svc;
+        return (TRUE);
+    case READ64:
+        *xdr_argument = (xdrproc_t) xdr_read64_args;
+        *xdr_result = (xdrproc_t) xdr_read_res;
+        *local = (bool_t (*) (char *, void *,  struct svc_req *))read64_2_svc;
+        return (TRUE);
+    case WRITE64:
+        *xdr_argument = (xdrproc_t) xdr_write64_args;
+        *xdr_result = (xdrproc_t) xdr_write_res;
+        *local = (bool_t (*) (char *, void *,  struct svc_req *))write64_2_svc;
+        return (TRUE);
+    default:
+        return (FALSE);
+    }
+}
+
+/* Run one call on a session slot.  The slot's last result is kept
+ * encoded, so a replay is sent back byte for byte. */
+bool_t
+sequence_1_svc(sequence_args *args, sequence_res *res, struct svc_req *req)
+{
+    union fchan_prog_1_argument argument;
+    union fchan_prog_1_result result;
+    struct fchan_slot_ref ref;
+    struct fchan_reply_buf rb, crb;
+    xdrproc_t xdr_argument, xdr_result;
+    bool_t (*local)(char *, void *, struct svc_req *);
+    bool_t retval = TRUE;
+    struct fchan_session_owner owner;
+    XDR xdrs[1];
+
+    memset(res, 0, sizeof(sequence_res));
+    res->slotid = args->slotid;
+    res->seqid = args->seqid;
+
+    fchan_session_owner(req, &owner);
+    switch (fchan_session_slot_start(args->sessionid, &owner, args->slotid,
+                                     args->seqid, &ref, &rb, &res->status,
+                                     &res->highest_slotid)) {
+    case FCHAN_SLOT_REPLAY:
+        /* freed with the result */
+        res->res.res_len = rb.len;
+        res->res.res_val = rb.buf;
+        goto out;
+    case FCHAN_SLOT_ERROR:
+        goto out;
+    default:
+        break;
+    }
+
+    /* errors before the call runs leave the seqid to be retried */
+    if (! fchan_sequence_proc(req->rq_vers, args->proc, &xdr_argument,
+                              &xdr_result, &local)) {
+        res->status = FCHAN_SESS_BADPROC;
+        fchan_session_slot_finish(&ref, FALSE, NULL);
+        goto out;
+    }
+
+    memset(&argument, 0, sizeof(argument));
+    memset(&result, 0, sizeof(result));
+
+    xdrmem_create(xdrs, args->args.args_val, args->args.args_len,
+                  XDR_DECODE);
+    if (! (*xdr_argument)(xdrs, &argument)) {
+        XDR_DESTROY(xdrs);
+        xdr_free(xdr_argument, (caddr_t) &argument);
+        res->status = FCHAN_SESS_GARBAGE_ARGS;
+        fchan_session_slot_finish(&ref, FALSE, NULL);
+        goto out;
+    }
+    XDR_DESTROY(xdrs);
+
+    fchan_call_nested = TRUE;
+    retval = (*local)((char *) &argument, (void *) &result, req);
+    fchan_call_nested = FALSE;
+    xdr_free(xdr_argument, (caddr_t) &argument);
+
+    if (retval <= 0) {
+        retval = TRUE;
+        res->status = FCHAN_SESS_SERVERFAULT;
+        fchan_session_slot_finish(&ref, FALSE, NULL);
+    } else if (! fchan_reply_encode(&rb, xdr_result, &result)) {
+        res->status = FCHAN_SESS_SERVERFAULT;
+        fchan_session_slot_finish(&ref, FALSE, NULL);
+    } else {
+        res->res.res_len = rb.len;
+        res->res.res_val = rb.buf;
+        /* without memory for the copy, the slot just isn't cached */
+        if (args->cachethis && rb.len <= FCHAN_SESS_MAXCACHE
+            && fchan_reply_copy(&crb, &rb))
+            fchan_session_slot_finish(&ref, TRUE, &crb);
+        else
+            fchan_session_slot_finish(&ref, TRUE, NULL);
+    }
+    xdr_free(xdr_result, (caddr_t) &result);
+
+out:
+    /* the slots a client should use: its session's, cut down to the
+     * credits this connection has now */
+    if (fchan_credit_enabled() && req->rq_xprt->xp_u1) {
+        uint32_t granted = fchan_credit_granted(
+            &((struct fchan_xprt_private *) req->rq_xprt->xp_u1)->credit);
+        if (res->highest_slotid >= granted)
+            res->highest_slotid = granted - 1;
+    }
+
+    FCHAN_TRACE(FCHAN_TR_SEQUENCE, res->status, req->rq_msg->rm_xid,
+                args->seqid, args->slotid, 0, args->proc);
+
+    return (retval);
+}
+
+/* Run the ops in order, stopping at the first that fails.  They were
+ * all decoded with the call, and their results go out in its reply. */
+bool_t
+compound_1_svc(compound_args *args, compound_res *res, struct svc_req *req)
+{
+    fchan_op_args *op;
+    fchan_op_res *r;
+    bool_t ok = TRUE;
+    bool nested = fchan_call_nested;
+    u_int ix;
+
+    memset(res, 0, sizeof(compound_res));
+    res->tag = args->tag;
+    res->results.results_val = fchan_arena_calloc(MAX(args->ops.ops_len, 1),
+                                                  sizeof(fchan_op_res));
+    if (! res->results.results_val) {
+        fchan_svcerr_systemerr(req->rq_xprt, req);
+        return (FALSE);
+    }
+
+    fchan_call_nested = TRUE;
+    for (ix = 0; (ix < args->ops.ops_len) && ok; ++ix) {
+        op = &args->ops.ops_val[ix];
+        r = &res->results.results_val[ix];
+        r->op = op->op;
+        res->results.results_len = ix + 1;
+
+        switch (op->op) {
+        case OP_SENDMSG:
+            ok = sendmsg1_1_svc(&op->fchan_op_args_u.sendmsg,
+                                &r->fchan_op_res_u.sendmsg, req);
+            break;
+        case OP_READ:
+            ok = read_1_svc(&op->fchan_op_args_u.read,
+                            &r->fchan_op_res_u.read, req);
+            break;
+        case OP_WRITE:
+            ok = write_1_svc(&op->fchan_op_args_u.write,
+                             &r->fchan_op_res_u.write, req);
+            break;
+        case OP_READ64:
+            ok = read64_2_svc(&op->fchan_op_args_u.read64,
+                              &r->fchan_op_res_u.read64, req);
+            break;
+        case OP_WRITE64:
+            ok = write64_2_svc(&op->fchan_op_args_u.write64,
+                               &r->fchan_op_res_u.write64, req);
+            break;
+        default:
+            /* decode lets nothing else through */
+            ok = FALSE;
+            break;
+        }
+    }
+    fchan_call_nested = nested;
+
+    if (! ok)
+        res->status = FCHAN_COMPOUND_OPFAILED;
+
+    FCHAN_TRACE(FCHAN_TR_COMPOUND, res->status, req->rq_msg->rm_xid,
+                args->tag, 0, 0, res->results.results_len);
+
+    return (TRUE);
+}
+
+/* procedures whose replies go in the duplicate request cache */
+static inline bool
+fchan_drc_cacheable(u_int proc)
+{
+	switch (proc) {
+	case WRITE:
+	case COMPOUND:
+	case WRITEV:
+	case WRITE64:
+		return (TRUE);
+	default:
+		return (FALSE);
+	}
+}
+
+/* A decoded call.  With -w it lives in the request's scratch area and
+ * is run on a worker, otherwise on the dispatch thread's stack. */
+struct fchan_call {
+	struct svc_req *req;
+	uint64_t start; /* for the latency histogram */
+	struct fchan_drc_entry *drc; /* non-idempotent, reply gets cached */
+	struct rpc_msg msg; /* call header, survives the next SVC_RECV */
+	uint64_t cost; /* payload bytes charged to the connection */
+	struct fchan_arena *arena; /* arguments and results, or NULL */
+	xdrproc_t _xdr_argument, _xdr_result;
+	bool_t (*local)(char *, void *, struct svc_req *);
+	union fchan_prog_1_argument argument;
+	union fchan_prog_1_result result;
+};
+
+typedef char fchan_call_fits_scratch[
+    (sizeof(struct fchan_call) <= FCHAN_RQ_SCRATCH_SIZE) ? 1 : -1];
+
+/* procedures that allocate nothing outside the call's arena, so a reset
+ * frees all of their arguments and results */
+static inline bool
+fchan_arena_covers(u_int proc)
+{
+	switch (proc) {
+	case SENDMSG1:
+	case BIND_CONN_TO_SESSION1:
+	case READ:
+	case WRITE:
+	case DESTROY_SESSION:
+	case COMPOUND:
+	case READV:
+	case WRITEV:
+	case NEGOTIATE:
+	case READ64:
+	case WRITE64:
+	case BIND_CONN_TO_SESSION:
+		return (TRUE);
+	default:
+		return (FALSE);
+	}
+}
+
+/* Procedures whose payload is the last thing in the record.  Inside
+ * COMPOUND more ops are decoded after a WRITE, and reading them in
+ * can refill the buffer under the WRITE's data, so that gets copied. */
+static inline bool
+fchan_call_borrows(u_int proc)
+{
+	switch (proc) {
+	case WRITE:
+	case WRITEV:
+	case WRITE64:
+		return (TRUE);
+	default:
+		return (FALSE);
+	}
+}
+
+/* Done with a call's arguments (and results, if it ran).  Anything
+ * left outside the arena is freed the old way first, with the arena
+ * current so those walks step over its memory.  This may run on a
+ * worker, while the event thread decodes the next request with the
+ * xprt's own XDR stream, so the arguments are freed without it. */
+static void
+fchan_call_free(struct fchan_call *call, bool_t results)
+{
+	SVCXPRT *xprt = call->req->rq_xprt;
+
+	(void) fchan_arena_set(call->arena);
+	if (!call->arena || !fchan_arena_covers(call->req->rq_proc)) {
+		xdr_free((xdrproc_t) call->_xdr_argument,
+			 (caddr_t) &call->argument);
+		if (results && !fchan_prog_1_freeresult (xprt, call->_xdr_result,
+							 (caddr_t) &call->result))
+			fprintf (stderr, "%s", "unable to free results");
+	}
+	(void) fchan_arena_set(NULL);
+
+	if (call->arena) {
+		fchan_arena_put(call->arena);
+		call->arena = NULL;
+	}
+}
+
+static void
+fchan_prog_1_call(struct fchan_call *call)
+{
+	struct svc_req *req = call->req;
+	SVCXPRT *xprt = req->rq_xprt;
+	u_int proc = req->rq_proc;
+	const struct fchan_reply_buf *tmpl;
+	bool_t retval;
+
+	fchan_call_failed = FALSE;
+	(void) fchan_arena_set(call->arena);
+	retval = (bool_t) (*call->local)((char *)&call->argument,
+					 (void *)&call->result, req);
+	/* a constant reply, already encoded */
+	tmpl = fchan_reply_take();
+	if (call->drc) {
+		struct fchan_reply_buf rb;
+		bool_t encoded = FALSE;
+
+		/* encode once, send those bytes and keep them for replay;
+		 * the cache takes its own copy of a template */
+		if (retval > 0 && tmpl)
+			encoded = fchan_reply_copy(&rb, tmpl);
+		else if (retval > 0)
+			encoded = fchan_reply_encode(&rb, call->_xdr_result,
+						     &call->result);
+		if (encoded) {
+			if (!svc_sendreply(xprt, req,
+					   (xdrproc_t) xdr_fchan_reply_buf,
+					   (caddr_t) &rb))
+				fchan_svcerr_systemerr(xprt, req);
+			fchan_drc_finish(call->drc, &rb);
+		} else {
+			if (retval > 0)
+				fchan_svcerr_systemerr(xprt, req);
+			fchan_drc_abort(call->drc);
+		}
+	} else if (retval > 0 && tmpl) {
+		if (!svc_sendreply(xprt, req, (xdrproc_t) xdr_fchan_reply_buf,
+				   (caddr_t) tmpl))
+			fchan_svcerr_systemerr(xprt, req);
+	} else if (retval > 0 && !svc_sendreply(xprt, req,
+					 (xdrproc_t) call->_xdr_result,
+					 (char *)&call->result)) {
+            fchan_svcerr_systemerr(xprt, req);
+	}
+	fchan_stats_record(FCHAN_PROG, proc, fchan_stats_now() - call->start,
+			   fchan_call_failed);
+	fchan_call_free(call, TRUE);
+}
+
+/* worker side of -w: execute, reply (possibly out of order), and drop
+ * the connection's in-flight count */
+static void
+fchan_prog_1_worker(void *arg)
+{
+	struct fchan_call *call = (struct fchan_call *) arg;
+	struct svc_req *req = call->req;
+	SVCXPRT *xprt = req->rq_xprt;
+
+	fchan_prog_1_call(call);
+	free_rpc_request(req);
+	if (fchan_credit_enabled())
+		fchan_credit_release(
+		    &((struct fchan_xprt_private *) xprt->xp_u1)->credit,
+		    call->cost);
+	fchan_xprt_inflight_dec(xprt);
+}
+
+/* payload a request holds while in flight, for admission control */
+static inline uint64_t
+fchan_call_cost(SVCXPRT *xprt, u_int proc,
+		union fchan_prog_1_argument *argument)
+{
+	switch (proc) {
+	case READ:
+		return (MIN(argument->read_1_arg.len, FCHAN_BACKEND_MAXIO));
+	case WRITE:
+		return (argument->write_1_arg.data.data_len);
+	case SEQUENCE:
+		return (argument->sequence_1_arg.args.args_len);
+	case COMPOUND: {
+		fchan_op_args *op = argument->compound_1_arg.ops.ops_val;
+		uint64_t cost = 0;
+		u_int ix;
+
+		for (ix = 0; ix < argument->compound_1_arg.ops.ops_len; ++ix) {
+			if (op[ix].op == OP_READ)
+				cost += MIN(op[ix].fchan_op_args_u.read.len,
+					    FCHAN_BACKEND_MAXIO);
+			else if (op[ix].op == OP_WRITE)
+				cost += op[ix].fchan_op_args_u.write.data.data_len;
+			else if (op[ix].op == OP_READ64)
+				cost += MIN(op[ix].fchan_op_args_u.read64.len,
+					    fchan_xprt_maxio(xprt));
+			else if (op[ix].op == OP_WRITE64)
+				cost += op[ix].fchan_op_args_u.write64.data.data_len;
+		}
+		return (cost);
+	}
+	case READV: {
+		fchan_extent *ext = argument->readv_1_arg.extents.extents_val;
+		uint64_t cost = 0;
+		u_int ix;
+
+		for (ix = 0; ix < argument->readv_1_arg.extents.extents_len; ++ix)
+			cost += ext[ix].len;
+		return (MIN(cost, FCHAN_BACKEND_MAXIO));
+	}
+	case WRITEV:
+		return (argument->writev_1_arg.data.data_len);
+	case READ64:
+		/* as read64_2_svc will clamp it */
+		return (MIN(argument->read64_2_arg.len,
+			    fchan_xprt_maxio(xprt)));
+	case WRITE64:
+		return (argument->write64_2_arg.data.data_len);
+	default:
+		return (0);
+	}
+}
+
+static void
+fchan_prog_1(struct svc_req *req, register SVCXPRT *xprt)
+{
+	struct fchan_call call_s, *call = &call_s;
+
+	/* with -w, accepted xprts use our getreq (pooled req) and carry
+	 * the private in-flight count */
+	if (fchan_wq && xprt->xp_u1)
+		call = (struct fchan_call *) fchan_rq(req)->rq_scratch;
+
+        /* XXXX valgrind warns these used uninitialized */
+        memset(&call->argument, 0, sizeof(call->argument));
+        memset(&call->result, 0, sizeof(call->result));
+	call->req = req;
+	call->start = fchan_stats_now();
+
+	/* registered for both versions.  Version 2 answers everything
+	 * version 1 does, but its READ and WRITE are READ64 and WRITE64;
+	 * renumber them here so the per-procedure tables need no version */
+	if (req->rq_vers == FCHANV2) {
+		if (req->rq_proc == READ)
+			req->rq_proc = READ64;
+		else if (req->rq_proc == WRITE)
+			req->rq_proc = WRITE64;
+	} else if (req->rq_proc >= NEGOTIATE) {
+            svcerr_noproc(xprt, req);
+		return;
+	}
+
+	switch (req->rq_proc) {
+	case NULLPROC:
+            (void) svc_sendreply(xprt, req, (xdrproc_t) xdr_void, (char *)NULL);
+		fchan_stats_record(FCHAN_PROG, NULLPROC,
+				   fchan_stats_now() - call->start, FALSE);
+		return;
+
+	case SENDMSG1:
+		call->_xdr_argument = (xdrproc_t) xdr_fchan_msg;
+		call->_xdr_result = (xdrproc_t) xdr_fchan_res;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))sendmsg1_1_svc;
 		break;
 
 	case BIND_CONN_TO_SESSION1:
-		_xdr_argument = (xdrproc_t) xdr_void;
-		_xdr_result = (xdrproc_t) xdr_int;
-		local = (bool_t (*) (char *, void *,  struct svc_req *))bind_conn_to_session1_1_svc;
+		call->_xdr_argument = (xdrproc_t) xdr_void;
+		call->_xdr_result = (xdrproc_t) xdr_int;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))bind_conn_to_session1_1_svc;
 		break;
 
 	case READ:
-		_xdr_argument = (xdrproc_t) xdr_read_args;
-		_xdr_result = (xdrproc_t) xdr_read_res;
-		local = (bool_t (*) (char *, void *,  struct svc_req *))read_1_svc;
+		call->_xdr_argument = (xdrproc_t) xdr_read_args;
+		call->_xdr_result = (xdrproc_t) xdr_read_res;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))read_1_svc;
 		break;
 
 	case WRITE:
-		_xdr_argument = (xdrproc_t) xdr_write_args;
-		_xdr_result = (xdrproc_t) xdr_write_res;
-		local = (bool_t (*) (char *, void *,  struct svc_req *))write_1_svc;
+		call->_xdr_argument = (xdrproc_t) xdr_write_args;
+		call->_xdr_result = (xdrproc_t) xdr_write_res;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))write_1_svc;
+		break;
+
+	case STATS:
+		call->_xdr_argument = (xdrproc_t) xdr_void;
+		call->_xdr_result = (xdrproc_t) xdr_stats_res;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))stats_1_svc;
+		break;
+
+	case CREATE_SESSION:
+		call->_xdr_argument = (xdrproc_t) xdr_create_session_args;
+		call->_xdr_result = (xdrproc_t) xdr_create_session_res;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))create_session_1_svc;
+		break;
+
+	case DESTROY_SESSION:
+		call->_xdr_argument = (xdrproc_t) xdr_u_quad_t;
+		call->_xdr_result = (xdrproc_t) xdr_u_int;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))destroy_session_1_svc;
+		break;
+
+	case SEQUENCE:
+		call->_xdr_argument = (xdrproc_t) xdr_sequence_args;
+		call->_xdr_result = (xdrproc_t) xdr_sequence_res;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))sequence_1_svc;
+		break;
+
+	case COMPOUND:
+		call->_xdr_argument = (xdrproc_t) xdr_compound_args;
+		call->_xdr_result = (xdrproc_t) xdr_compound_res;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))compound_1_svc;
+		break;
+
+	case READV:
+		call->_xdr_argument = (xdrproc_t) xdr_readv_args;
+		call->_xdr_result = (xdrproc_t) xdr_readv_res;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))readv_1_svc;
+		break;
+
+	case WRITEV:
+		call->_xdr_argument = (xdrproc_t) xdr_writev_args;
+		call->_xdr_result = (xdrproc_t) xdr_writev_res;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))writev_1_svc;
+		break;
+
+	case NEGOTIATE:
+		call->_xdr_argument = (xdrproc_t) xdr_negotiate_args;
+		call->_xdr_result = (xdrproc_t) xdr_negotiate_res;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))negotiate_2_svc;
+		break;
+
+	case READ64:
+		call->_xdr_argument = (xdrproc_t) xdr_read64_args;
+		call->_xdr_result = (xdrproc_t) xdr_read_res;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))read64_2_svc;
+		break;
+
+	case WRITE64:
+		call->_xdr_argument = (xdrproc_t) xdr_write64_args;
+		call->_xdr_result = (xdrproc_t) xdr_write_res;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))write64_2_svc;
+		break;
+
+	case BIND_CONN_TO_SESSION:
+		call->_xdr_argument = (xdrproc_t) xdr_bind_conn_args;
+		call->_xdr_result = (xdrproc_t) xdr_u_int;
+		call->local = (bool_t (*) (char *, void *,  struct svc_req *))bind_conn_to_session_2_svc;
 		break;
 
 	default:
             svcerr_noproc(xprt, req);
 		return;
 	}
-	memset ((char *)&argument, 0, sizeof (argument));
-	if (!svc_getargs (xprt, req, _xdr_argument, (caddr_t) &argument, NULL)) {
+	/* decode into a fresh arena; without one, it's malloc as before */
+	call->arena = fchan_arena_get();
+	(void) fchan_arena_set(call->arena);
+	/* run here, the xprt won't read past this record until we reply,
+	 * so WRITE data can stay in its receive buffer */
+	if (zero_copy_write && call->arena && (call == &call_s)
+	    && fchan_call_borrows(req->rq_proc))
+		fchan_arena_borrow(call->arena, TRUE);
+	if (!svc_getargs (xprt, req, call->_xdr_argument, (caddr_t) &call->argument, NULL)) {
+		fchan_call_free(call, FALSE);
             svcerr_decode(xprt, req);
+		fchan_stats_record(FCHAN_PROG, req->rq_proc,
+				   fchan_stats_now() - call->start, TRUE);
 		return;
 	}
-	retval = (bool_t) (*local)((char *)&argument, (void *)&result, req);
-	if (retval > 0 && !svc_sendreply(xprt, req, (xdrproc_t) _xdr_result, (char *)&result)) {
-            svcerr_systemerr(xprt, req);
+	(void) fchan_arena_set(NULL);
+
+	call->drc = NULL;
+	if (fchan_drc_enabled() && fchan_drc_cacheable(req->rq_proc)) {
+		struct fchan_reply_buf rb;
+
+		switch (fchan_drc_start(req, &call->drc, &rb)) {
+		case FCHAN_DRC_REPLAY:
+			if (!svc_sendreply(xprt, req,
+					   (xdrproc_t) xdr_fchan_reply_buf,
+					   (caddr_t) &rb))
+				svcerr_systemerr(xprt, req);
+			fchan_reply_release(&rb);
+			/* FALLTHROUGH */
+		case FCHAN_DRC_INPROGRESS:
+			/* the original will answer */
+			fchan_call_free(call, FALSE);
+			fchan_stats_record(FCHAN_PROG, req->rq_proc,
+					   fchan_stats_now() - call->start,
+					   FALSE);
+			return;
+		default:
+			break;
+		}
 	}
-	if (!svc_freeargs(xprt, (xdrproc_t) _xdr_argument, (caddr_t) &argument)) {
-		fprintf (stderr, "%s", "unable to free arguments");
-		exit (1);
+
+	if (call != &call_s) {
+		struct rpc_msg *msg = req->rq_msg;
+
+		/* the xprt reuses its call header on the next recv */
+		call->msg = *msg;
+		req->rq_msg = &call->msg;
+		fchan_xprt_inflight_inc(xprt);
+		/* its credit was reserved before it was read */
+		if (fchan_credit_enabled()) {
+			call->cost = fchan_call_cost(xprt, req->rq_proc,
+						     &call->argument);
+			fchan_credit_charge(
+			    &((struct fchan_xprt_private *) xprt->xp_u1)->credit,
+			    call->cost);
+		}
+		fchan_rq(req)->rq_flags |= FCHAN_RQ_FLAG_HANDOFF;
+		if (fchan_wq_submit(fchan_wq, fchan_prog_1_worker, call))
+			return;
+		/* queue full, run it here; req and its credit stay with
+		 * getreq, so only the bytes come back */
+		fchan_rq(req)->rq_flags &= ~FCHAN_RQ_FLAG_HANDOFF;
+		fchan_prog_1_call(call);
+		req->rq_msg = msg;
+		if (fchan_credit_enabled())
+			fchan_credit_uncharge(
+			    &((struct fchan_xprt_private *) xprt->xp_u1)->credit,
+			    call->cost);
+		fchan_xprt_inflight_dec(xprt);
+		return;
 	}
-	if (!fchan_prog_1_freeresult (xprt, _xdr_result, (caddr_t) &result))
-		fprintf (stderr, "%s", "unable to free results");
+
+	fchan_prog_1_call(call);
 
 	return;
 }
@@ -521,33 +2255,403 @@ fchan_prog_1_freeresult (SVCXPRT *xprt, xdrproc_t xdr_result, caddr_t result)
     return (1);
 }
 
+int
+fchan_prog_2_freeresult (SVCXPRT *xprt, xdrproc_t xdr_result, caddr_t result)
+{
+    return (fchan_prog_1_freeresult(xprt, xdr_result, result));
+}
+
+/* Calls from the UDP threads: SENDMSG1, and READs no larger than fits
+ * a datagram.  There is no connection, so no backchannel either. */
+static void
+fchan_udp_dispatch(struct fchan_udp_call *uc)
+{
+	struct svc_req *req = uc->req;
+	union fchan_prog_1_argument argument;
+	xdrproc_t _xdr_argument;
+	bool_t (*local)(char *, void *, struct svc_req *);
+	uint64_t start = fchan_stats_now();
+	bool_t retval;
+
+	switch (req->rq_proc) {
+	case SENDMSG1:
+		_xdr_argument = (xdrproc_t) xdr_fchan_msg;
+		uc->xdr_result = (xdrproc_t) xdr_fchan_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))sendmsg1_1_svc;
+		break;
+
+	case READ:
+		_xdr_argument = (xdrproc_t) xdr_read_args;
+		uc->xdr_result = (xdrproc_t) xdr_read_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))read_1_svc;
+		break;
+
+	default:
+		uc->stat = PROC_UNAVAIL;
+		return;
+	}
+
+	memset(&argument, 0, sizeof(argument));
+	if (!(*_xdr_argument)(uc->xdrs, &argument)) {
+		xdr_free(_xdr_argument, (caddr_t) &argument);
+		uc->stat = GARBAGE_ARGS;
+		fchan_stats_record(FCHAN_PROG, req->rq_proc,
+				   fchan_stats_now() - start, TRUE);
+		return;
+	}
+	if (req->rq_proc == READ) {
+		argument.read_1_arg.len = MIN(argument.read_1_arg.len,
+					      FCHAN_UDP_MAXREAD);
+		argument.read_1_arg.flags &= ~DUPLEX_UNIT_IMMED_CB;
+	}
+
+	fchan_call_failed = FALSE;
+	fchan_call_nested = TRUE;
+	retval = (bool_t) (*local)((char *)&argument, (void *)&uc->result,
+				   req);
+	fchan_call_nested = FALSE;
+	uc->stat = (retval > 0) ? SUCCESS : SYSTEM_ERR;
+
+	xdr_free(_xdr_argument, (caddr_t) &argument);
+	fchan_stats_record(FCHAN_PROG, req->rq_proc,
+			   fchan_stats_now() - start, fchan_call_failed);
+}
+
 SVCXPRT *xprt;
 int server_port;
 
+/* listener for co-located clients (-U), beside TCP */
+static SVCXPRT *unix_xprt = NULL;
+static char *unix_path = NULL;
+
 #define FCHAN_SVC_UDP 0x0001
 #define FCHAN_SVC_TCP 0x0002
 
 void fchan_sighand(int sig)
 {
-    int code = 0;
+    int code = 0, ix;
 
     /* signal shutdown forechannel */
     signal_shutdown = TRUE;
 
+    /* signal shutdown sharded channels */
+    for (ix = 0; ix < n_evchans; ++ix)
+        code = svc_rqst_thrd_signal(fchan_evchans[ix].chan_id,
+                                    SVC_RQST_SIGNAL_SHUTDOWN);
+
     /* signal shutdown backchannel */
     code = svc_rqst_thrd_signal(fchan_id, SVC_RQST_SIGNAL_SHUTDOWN);   
 }
 
+static void
+fchan_dump_stats(void)
+{
+    stats_res res[1];
+
+    memset(res, 0, sizeof(stats_res));
+    fchan_server_stats(res);
+    fchan_stats_print(stdout, res);
+    xdr_free((xdrproc_t) xdr_stats_res, (caddr_t) res);
+
+    fflush(stdout);
+}
+
+static const char *trace_file = NULL;
+
+static void
+fchan_dump_trace(void)
+{
+    int code;
+
+    if (! fchan_trace_on)
+        return;
+
+    code = fchan_trace_dump(trace_file);
+    if (code)
+        printf("%s: cannot write %s (%s)\n", __func__, trace_file,
+               strerror(code));
+}
+
+/* SIGUSR1 dumps the counters of a running server, SIGUSR2 the trace */
+static void *
+fchan_statsthread(void *arg)
+{
+    sigset_t mask;
+    int sig;
+
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGUSR1);
+    sigaddset(&mask, SIGUSR2);
+
+    while (sigwait(&mask, &sig) == 0) {
+        switch (sig) {
+        case SIGUSR1:
+            fchan_dump_stats();
+            break;
+        case SIGUSR2:
+            fchan_dump_trace();
+            break;
+        default:
+            break;
+        }
+    }
+
+    return (NULL);
+}
+
 static void
 fchan_signals()
 {
     sigset_t mask, newmask;
+    pthread_t tid;
+
     sigemptyset(&newmask);
     sigaddset(&newmask, SIGPIPE);
+    /* every thread created after this inherits the mask, so only the
+     * stats thread sees SIGUSR1/2 */
+    sigaddset(&newmask, SIGUSR1);
+    sigaddset(&newmask, SIGUSR2);
     pthread_sigmask(SIG_SETMASK, &newmask, &mask);
 
     /* trap shutdown */
     signal(SIGTERM, fchan_sighand);
+
+    if (pthread_create(&tid, NULL, fchan_statsthread, NULL) == 0)
+        pthread_detach(tid);
+}
+
+static struct fchan_evchan *
+fchan_evchan_pick(void)
+{
+    struct fchan_evchan *ch;
+    uint32_t ix, n;
+
+    if (! evchan_least_loaded) {
+        ix = __sync_fetch_and_add(&evchan_rr, 1);
+        return (&fchan_evchans[ix % n_evchans]);
+    }
+
+    /* racy, but the worst case is a slightly uneven spread */
+    ch = &fchan_evchans[0];
+    n = ch->nxprts;
+    for (ix = 1; ix < n_evchans; ++ix) {
+        if (fchan_evchans[ix].nxprts < n) {
+            ch = &fchan_evchans[ix];
+            n = ch->nxprts;
+        }
+    }
+    return (ch);
+}
+
+static void
+fchan_free_user_data(SVCXPRT *xprt)
+{
+    struct fchan_xprt_private *xpp =
+        (struct fchan_xprt_private *) xprt->xp_u1;
+
+    if (! xpp)
+        return;
+
+    if (xpp->evchan)
+        __sync_fetch_and_sub(&xpp->evchan->nxprts, 1);
+
+    fchan_cbclnt_forget(xprt);
+    fchan_credit_forget(&xpp->credit);
+
+    if (xpp->sessionid)
+        fchan_session_unbind(xpp->sessionid);
+
+    pthread_mutex_destroy(&xpp->mtx);
+    pthread_cond_destroy(&xpp->cv);
+    free(xpp);
+    xprt->xp_u1 = NULL;
+}
+
+/* called by the rendezvous xprt for every accepted connection */
+static u_int
+fchan_rdvs(SVCXPRT *xprt, SVCXPRT *newxprt, const u_int flags, void *u_data)
+{
+    struct fchan_xprt_private *xpp;
+    struct fchan_evchan *ch;
+    int code;
+
+    xpp = calloc(1, sizeof(struct fchan_xprt_private));
+    if (! xpp) {
+        /* refuse it; the xprt goes away as any dead connection does */
+        printf("%s: no memory for xprt %p, dropped\n", __func__, newxprt);
+        (void) shutdown(newxprt->xp_fd, SHUT_RDWR);
+        return (0);
+    }
+    pthread_mutex_init(&xpp->mtx, NULL);
+    pthread_cond_init(&xpp->cv, NULL);
+    fchan_credit_setup(&xpp->credit, newxprt);
+    newxprt->xp_u1 = xpp;
+    code = SVC_CONTROL(newxprt, SVCSET_XP_FREE_USER_DATA,
+                       fchan_free_user_data);
+
+    if (override_getreq)
+        code = SVC_CONTROL(newxprt, SVCSET_XP_GETREQ, fchan_server_getreq);
+
+    if (n_evchans) {
+        ch = fchan_evchan_pick();
+        /* move it off the listener's channel */
+        code = svc_rqst_evchan_reg(ch->chan_id, newxprt,
+                                   SVC_RQST_FLAG_XPRT_UREG|
+                                   SVC_RQST_FLAG_CHAN_AFFINITY);
+        if (code) {
+            printf("%s: xprt %p -> evchan %d failed (%d), dropped\n",
+                   __func__, newxprt, ch->ix, code);
+            (void) shutdown(newxprt->xp_fd, SHUT_RDWR);
+            return (0);
+        }
+        xpp->evchan = ch;
+        __sync_fetch_and_add(&ch->nxprts, 1);
+        if (verbose)
+            printf("%s: xprt %p -> evchan %d (%d xprts)\n", __func__,
+                   newxprt, xpp->evchan->ix, xpp->evchan->nxprts);
+        xpp->chan_id = xpp->evchan->chan_id;
+        xpp->has_chan = TRUE;
+    } else if (new_style_event_loop) {
+        /* stays on the listener's channel */
+        xpp->chan_id = fchan_id;
+        xpp->has_chan = TRUE;
+    }
+
+    return (0);
+}
+
+static void *
+fchan_evchan_thread(void *arg)
+{
+    struct fchan_evchan *ch = (struct fchan_evchan *) arg;
+    cpu_set_t cpus;
+    long ncpu;
+    int code;
+
+    ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    if (ncpu > 0) {
+        CPU_ZERO(&cpus);
+        CPU_SET(ch->ix % ncpu, &cpus);
+        code = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                                      &cpus);
+        if (code)
+            printf("%s: evchan %d could not pin to cpu %ld (%d)\n",
+                   __func__, ch->ix, ch->ix % ncpu, code);
+    }
+
+    code = svc_rqst_thrd_run(ch->chan_id, SVC_RQST_FLAG_NONE);
+
+    return (NULL);
+}
+
+static void fchan_evchans_stop(void);
+
+/* returns errno; on failure, channels already started are stopped */
+static int
+fchan_evchans_start(void)
+{
+    struct fchan_evchan *ch;
+    uint32_t want = n_evchans;
+    int ix, code = 0;
+
+    fchan_evchans = calloc(want, sizeof(struct fchan_evchan));
+    if (! fchan_evchans) {
+        n_evchans = 0;
+        return (ENOMEM);
+    }
+
+    /* n_evchans counts the ones running, for fchan_evchans_stop */
+    n_evchans = 0;
+    for (ix = 0; ix < want; ++ix) {
+        ch = &fchan_evchans[ix];
+        ch->ix = ix;
+        code = svc_rqst_new_evchan(&ch->chan_id, NULL /* u_data */,
+                                   SVC_RQST_FLAG_CHAN_AFFINITY);
+        if (code) {
+            code = (code > 0) ? code : EINVAL;
+            break;
+        }
+        code = pthread_create(&ch->tid, NULL, &fchan_evchan_thread,
+                              (void *) ch);
+        if (code) {
+            (void) svc_rqst_delete_evchan(ch->chan_id, SVC_RQST_FLAG_NONE);
+            break;
+        }
+        ++n_evchans;
+    }
+
+    if (code) {
+        fchan_evchans_stop();
+        return (code);
+    }
+
+    return (0);
+}
+
+static void
+fchan_evchans_stop(void)
+{
+    struct fchan_evchan *ch;
+    int ix, code;
+
+    for (ix = 0; ix < n_evchans; ++ix) {
+        ch = &fchan_evchans[ix];
+        code = svc_rqst_thrd_signal(ch->chan_id, SVC_RQST_SIGNAL_SHUTDOWN);
+        pthread_join(ch->tid, NULL);
+        code = svc_rqst_delete_evchan(ch->chan_id, SVC_RQST_FLAG_NONE);
+        if (code)
+            printf("%s: svc_rqst_delete_evchan (%d) returned %d\n",
+                   __func__, ch->chan_id, code);
+    }
+    free(fchan_evchans);
+    fchan_evchans = NULL;
+    n_evchans = 0;
+}
+
+/* A Unix domain stream listener, set up like the TCP one; accepted
+ * connections go through fchan_rdvs the same way. */
+static SVCXPRT *
+fchan_unix_listen(const char *path)
+{
+    struct sockaddr_un sun;
+    SVCXPRT *uxprt;
+    size_t len = strlen(path);
+    int fd;
+
+    if (len >= sizeof(sun.sun_path)) {
+        errno = ENAMETOOLONG;
+        return (NULL);
+    }
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        return (NULL);
+
+    memset(&sun, 0, sizeof(struct sockaddr_un));
+    sun.sun_family = AF_UNIX;
+    memcpy(sun.sun_path, path, len + 1);
+
+    /* a socket left by an earlier run would fail the bind */
+    (void) unlink(path);
+    if ((bind(fd, (struct sockaddr *) &sun, sizeof(struct sockaddr_un))
+         == -1) || (listen(fd, 10) == -1)) {
+        close(fd);
+        return (NULL);
+    }
+
+    /* bound and listening already, so this only wraps fd */
+    uxprt = svc_tli_create(fd, NULL /* nconf */, NULL /* bindaddr */,
+                           0 /* sendsz */, fchan_recvsz());
+    if (! uxprt) {
+        close(fd);
+        return (NULL);
+    }
+
+    if (override_getreq)
+        (void) SVC_CONTROL(uxprt, SVCSET_XP_GETREQ, fchan_server_getreq);
+    (void) SVC_CONTROL(uxprt, SVCSET_XP_RDVS, fchan_rdvs);
+
+    return (uxprt);
 }
 
 static int
@@ -568,19 +2672,13 @@ forechan_rpc_server(unsigned int flags)
     svc_init(&svc_params);
 
     pmap_unset(FCHAN_PROG, FCHANV);
+    pmap_unset(FCHAN_PROG, FCHANV2);
 
     fchan_signals();
 
     switch (server_port) {
     case 0:
-        if (flags & FCHAN_SVC_UDP) {
-            xprt = svcudp_create(RPC_ANYSOCK);
-            if (xprt == NULL) {
-                fprintf(stderr, "%s", "cannot create udp service.");
-                exit(1);
-            }
-        }
-	xprt = svctcp_create(RPC_ANYSOCK, 0, 0);
+	xprt = svctcp_create(RPC_ANYSOCK, 0, fchan_recvsz());
 	if (xprt == NULL) {
             fprintf(stderr, "%s", "cannot create tcp service.");
             exit(1);
@@ -610,7 +2708,7 @@ forechan_rpc_server(unsigned int flags)
                               NULL /* nconf */,
                               &bindaddr,
                               0 /* sendsz */,
-                              0 /* recvsz */);
+                              fchan_recvsz());
         if (! xprt) {
             perror("error svc_fd_create failed");
             exit(1);
@@ -618,23 +2716,81 @@ forechan_rpc_server(unsigned int flags)
 
         if (override_getreq)
             code = SVC_CONTROL(xprt, SVCSET_XP_GETREQ, fchan_server_getreq);
+
+        /* place accepted connections ourselves */
+        code = SVC_CONTROL(xprt, SVCSET_XP_RDVS, fchan_rdvs);
         break;
     } /* switch */
 
-    if (flags & FCHAN_SVC_UDP) {
-        if (!svc_register(xprt, FCHAN_PROG, FCHANV, fchan_prog_1,
-                          IPPROTO_UDP)) {
-            fprintf(stderr, "%s", "unable to register (FCHAN_PROG, FCHANV,"
-                     " udp).");
-            exit(1);
-        }
-    }
     if (!svc_register(xprt, FCHAN_PROG, FCHANV, fchan_prog_1,
                       IPPROTO_TCP)) {
         fprintf(stderr, "%s", "unable to register (FCHAN_PROG, FCHANV, "
                  "tcp).");
         exit(1);
     }
+    if (!svc_register(xprt, FCHAN_PROG, FCHANV2, fchan_prog_1,
+                      IPPROTO_TCP)) {
+        fprintf(stderr, "%s", "unable to register (FCHAN_PROG, FCHANV2, "
+                 "tcp).");
+        exit(1);
+    }
+
+    /* no portmapper for a local socket, clients use the path */
+    if (unix_path) {
+        unix_xprt = fchan_unix_listen(unix_path);
+        if (! unix_xprt) {
+            fprintf(stderr, "cannot listen on %s (%s)\n", unix_path,
+                    strerror(errno));
+            exit(1);
+        }
+        if (!svc_register(unix_xprt, FCHAN_PROG, FCHANV, fchan_prog_1, 0) ||
+            !svc_register(unix_xprt, FCHAN_PROG, FCHANV2, fchan_prog_1, 0)) {
+            fprintf(stderr, "%s", "unable to register (FCHAN_PROG, "
+                    "local).");
+            exit(1);
+        }
+    }
+
+    /* UDP bypasses ntirpc for batching, so we register it ourselves */
+    if (flags & FCHAN_SVC_UDP) {
+        code = fchan_udp_start(server_port, n_udp_threads,
+                               fchan_udp_dispatch);
+        if (code) {
+            fprintf(stderr, "cannot start udp service (%s)\n",
+                    strerror(code));
+            exit(1);
+        }
+        /* version 1 only: READ64/WRITE64 don't fit a datagram, and
+         * fchan_udp answers FCHANV2 with PROG_MISMATCH */
+        if (!pmap_set(FCHAN_PROG, FCHANV, IPPROTO_UDP, server_port)) {
+            fprintf(stderr, "%s", "unable to register (FCHAN_PROG, FCHANV, "
+                     "udp).");
+        }
+    }
+
+    if (n_evchans) {
+        code = fchan_evchans_start();
+        if (code) {
+            fprintf(stderr, "cannot start event channels (%s)\n",
+                    strerror(code));
+            exit(1);
+        }
+    }
+
+    if (n_workers) {
+        fchan_wq = fchan_wq_create(n_workers, FCHAN_WQ_DEPTH);
+        if (! fchan_wq) {
+            fprintf(stderr, "cannot start %u workers\n", n_workers);
+            exit(1);
+        }
+    }
+
+    code = fchan_cb_start();
+    if (code) {
+        fprintf(stderr, "cannot start callback scheduler (%s)\n",
+                strerror(code));
+        exit(1);
+    }
 
     switch (new_style_event_loop) {
     case TRUE:
@@ -647,6 +2803,10 @@ forechan_rpc_server(unsigned int flags)
         code = svc_rqst_evchan_reg(fchan_id, xprt,
                                    SVC_RQST_FLAG_XPRT_UREG|
                                    SVC_RQST_FLAG_CHAN_AFFINITY);
+        if (unix_xprt)
+            code = svc_rqst_evchan_reg(fchan_id, unix_xprt,
+                                       SVC_RQST_FLAG_XPRT_UREG|
+                                       SVC_RQST_FLAG_CHAN_AFFINITY);
 
         /* service the backchannel */
         code = svc_rqst_thrd_run(fchan_id, SVC_RQST_FLAG_NONE);
@@ -657,6 +2817,17 @@ forechan_rpc_server(unsigned int flags)
         break;
     }
 
+    fchan_udp_shutdown();
+    fchan_cb_stop();
+
+    if (n_evchans)
+        fchan_evchans_stop();
+
+    if (fchan_wq) {
+        fchan_wq_destroy(fchan_wq);
+        fchan_wq = NULL;
+    }
+
     /* delete event channel, unregisters all xprts */
     code = svc_rqst_delete_evchan(fchan_id, SVC_RQST_FLAG_NONE);
     if (code)
@@ -665,20 +2836,148 @@ forechan_rpc_server(unsigned int flags)
 
     /* unbind and clean up svc database */
     svc_unregister(FCHAN_PROG, FCHANV); /* and free it? */
+    svc_unregister(FCHAN_PROG, FCHANV2);
 
     /* dispose xprt */
     SVC_DESTROY(xprt);
+    if (unix_xprt) {
+        SVC_DESTROY(unix_xprt);
+        (void) unlink(unix_path);
+    }
 
     return (0);
 }
 
+/* a decimal option argument in [min, max] */
+static bool
+fchan_opt_u64(const char *arg, uint64_t min, uint64_t max, uint64_t *val)
+{
+    unsigned long long v;
+    char *end;
+
+    errno = 0;
+    v = strtoull(arg, &end, 10);
+    if (errno || (end == arg) || *end || (v < min) || (v > max))
+        return (FALSE);
+    *val = v;
+
+    return (TRUE);
+}
+
+/* ... and for options that fit in 32 bits */
+static bool
+fchan_opt_u32(const char *arg, uint32_t min, uint32_t max, uint32_t *val)
+{
+    unsigned long v;
+    char *end;
+
+    errno = 0;
+    v = strtoul(arg, &end, 10);
+    if (errno || (end == arg) || *end || (v < min) || (v > max))
+        return (FALSE);
+    *val = v;
+
+    return (TRUE);
+}
+
 int
 main (int argc, char **argv)
 {
     int opt, code;
-
-    while ((opt = getopt(argc, argv, "vgnp:")) != -1) {
+    bool usage = FALSE;
+    uint32_t port;
+
+    char *export_dir = NULL;
+    uint32_t max_fds = 0;
+    uint64_t cache_mb = 0;
+    uint32_t ra_max = 0;
+    uint64_t drc_mb = 0;
+    struct fchan_credit_limits conn_credits = { 0, 0 };
+    struct fchan_credit_limits total_credits = { 0, 0 };
+
+    while ((opt = getopt(argc, argv, "vgnlzZc:w:u:U:e:f:m:a:t:d:r:b:R:B:x:p:")) != -1) {
         switch (opt) {
+        case 'z':
+            zero_copy_read = TRUE;
+            break;
+        case 'Z':
+            zero_copy_write = TRUE;
+            break;
+        case 'e':
+            export_dir = optarg;
+            break;
+        case 'f':
+            if (! fchan_opt_u32(optarg, 0, UINT32_MAX, &max_fds))
+                usage = TRUE;
+            break;
+        case 'm':
+            if (! fchan_opt_u64(optarg, 0, UINT64_MAX / (1024 * 1024),
+                                &cache_mb))
+                usage = TRUE;
+            break;
+        case 'a':
+            if (! fchan_opt_u32(optarg, 0, UINT32_MAX, &ra_max))
+                usage = TRUE;
+            break;
+        case 'd':
+            if (! fchan_opt_u64(optarg, 0, UINT64_MAX / (1024 * 1024),
+                                &drc_mb))
+                usage = TRUE;
+            break;
+        case 'r':
+            if (! fchan_opt_u32(optarg, 0, UINT32_MAX, &conn_credits.reqs))
+                usage = TRUE;
+            break;
+        case 'b':
+            if (fchan_opt_u64(optarg, 0, UINT64_MAX / 1024,
+                              &conn_credits.bytes))
+                conn_credits.bytes *= 1024;
+            else
+                usage = TRUE;
+            break;
+        case 'R':
+            if (! fchan_opt_u32(optarg, 0, UINT32_MAX, &total_credits.reqs))
+                usage = TRUE;
+            break;
+        case 'B':
+            if (fchan_opt_u64(optarg, 0, UINT64_MAX / 1024,
+                              &total_credits.bytes))
+                total_credits.bytes *= 1024;
+            else
+                usage = TRUE;
+            break;
+        case 'x':
+            if (fchan_opt_u64(optarg, 1, FCHAN_MAXIO_LIMIT / 1024,
+                              &fchan_maxio))
+                fchan_maxio *= 1024;
+            else
+                usage = TRUE;
+            break;
+        case 't':
+            trace_file = optarg;
+            fchan_trace_init();
+            break;
+        case 'w':
+            /* handoff happens in our getreq */
+            if (! fchan_opt_u32(optarg, 0, FCHAN_WQ_MAXTHREADS, &n_workers))
+                usage = TRUE;
+            override_getreq = TRUE;
+            break;
+        case 'u':
+            if (! fchan_opt_u32(optarg, 0, FCHAN_UDP_MAXTHREADS,
+                                &n_udp_threads))
+                usage = TRUE;
+            break;
+        case 'U':
+            unix_path = optarg;
+            break;
+        case 'c':
+            if (! fchan_opt_u32(optarg, 0, FCHAN_EVCHAN_MAX, &n_evchans))
+                usage = TRUE;
+            break;
+        case 'l':
+            evchan_least_loaded = TRUE;
+            break;
         case 'v':
             verbose = TRUE;
             break;
@@ -689,26 +2988,103 @@ main (int argc, char **argv)
             new_style_event_loop = TRUE;
             break;
         case 'p':
-            server_port = atoi(optarg);
+            if (fchan_opt_u32(optarg, 1, UINT16_MAX, &port))
+                server_port = port;
+            else
+                usage = TRUE;
             break;
         default:
             break;
         }
     }
 
-    if (! server_port) {
-        printf ("usage: %s [-n -g] -p server_port\n", argv[0]);
+    /* read-ahead fills the block cache */
+    if (ra_max && ! cache_mb) {
+        printf("%s: -a needs -m\n", argv[0]);
+        usage = TRUE;
+    }
+
+    if (usage || ! server_port) {
+        printf ("usage: %s [-n -g] [-c nchan [-l]] [-w nworkers] "
+                "[-u udp_threads] [-U socket_path] "
+                "[-e export_dir [-f max_fds] "
+                "[-m cache_mb [-a ra_blocks] | -z]] [-Z] [-d drc_mb] "
+                "[-r conn_reqs] [-b conn_kb] [-R total_reqs] [-B total_kb] "
+                "[-x maxio_kb] [-t trace_file] -p server_port\n",
+                argv[0]);
+        return (EXIT_FAILURE);
+    }
+
+    if (export_dir) {
+        code = fchan_backend_init(export_dir, max_fds);
+        if (code) {
+            printf("%s: cannot use export dir %s (%s)\n", argv[0],
+                   export_dir, strerror(code));
+            return (EXIT_FAILURE);
+        }
+        if (cache_mb) {
+            code = fchan_bcache_init(cache_mb * 1024 * 1024);
+            if (code) {
+                printf("%s: cannot create block cache (%s)\n", argv[0],
+                       strerror(code));
+                return (EXIT_FAILURE);
+            }
+            if (ra_max) {
+                code = fchan_ra_init(ra_max);
+                if (code) {
+                    printf("%s: cannot start read-ahead (%s)\n", argv[0],
+                           strerror(code));
+                    return (EXIT_FAILURE);
+                }
+            }
+        }
+    }
+
+    if (drc_mb) {
+        code = fchan_drc_init(drc_mb * 1024 * 1024);
+        if (code) {
+            printf("%s: cannot create duplicate request cache (%s)\n",
+                   argv[0], strerror(code));
+            return (EXIT_FAILURE);
+        }
+    }
+
+    /* credits are held by requests handed to workers */
+    fchan_credit_init(&conn_credits, &total_credits, fchan_xprt_resume);
+    if (fchan_credit_enabled() && ! n_workers)
+        printf("%s: -r/-b/-R/-B have no effect without -w\n", argv[0]);
+    /* a connection out of credits is parked off its event channel */
+    if (fchan_credit_enabled() && ! n_evchans)
+        new_style_event_loop = TRUE;
+
+    code = fchan_session_init();
+    if (code) {
+        printf("%s: cannot create session table (%s)\n", argv[0],
+               strerror(code));
         return (EXIT_FAILURE);
     }
 
     /* auth is explicit */
     auth = authnone_create();
 
-    code = forechan_rpc_server(FCHAN_SVC_TCP);
+    code = forechan_rpc_server(FCHAN_SVC_TCP |
+                               (n_udp_threads ? FCHAN_SVC_UDP : 0));
     printf("forechannel_rpc_server result %d\n", code);
 
     barrier_shutdown_sem();
 
+    if (verbose)
+        fchan_dump_stats();
+
+    fchan_dump_trace();
+
+    fchan_drc_shutdown();
+    fchan_session_shutdown();
+    fchan_ra_shutdown();
+    fchan_bcache_shutdown();
+    if (fchan_backend_enabled())
+        fchan_backend_shutdown();
+
     (void) svc_shutdown(SVC_SHUTDOWN_FLAG_NONE);
 
     exit (0);
@@ -0,0 +1,560 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE /* struct ucred */
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "fchan_session.h"
+#include "fchan_shard.h"
+
+#define SE_NBUCKETS 64
+
+struct se_slot {
+    uint32_t seqid; /* of the last call started here */
+    bool inuse;
+    bool cached;
+    struct fchan_reply_buf reply;
+};
+
+struct fchan_session {
+    struct fchan_session *hnext;
+    uint64_t id;
+    uint32_t refcnt; /* under the shard lock */
+    uint32_t nconns; /* ditto */
+    time_t expires; /* with no connections, under the shard lock */
+    struct fchan_session_owner owner;
+    uint32_t shard;
+    pthread_mutex_t mtx; /* slots */
+    uint32_t nslots;
+    uint32_t maxcache;
+    struct se_slot slots[];
+};
+
+struct se_shard {
+    pthread_mutex_t mtx; /* first, see fchan_shard.h */
+    struct fchan_session *buckets[SE_NBUCKETS];
+    struct fchan_session_stats st; /* the counters ahead of replays */
+} FCHAN_SHARD_ALIGNED;
+
+#define SE_NSTATS \
+    (offsetof(struct fchan_session_stats, replays) / sizeof(uint64_t))
+
+static struct se_shard *shards = NULL;
+
+static uint32_t se_count = 0; /* all shards, for FCHAN_SESSION_MAX */
+static uint32_t se_next = 0;
+static uint64_t se_boot = 0;
+
+static uint64_t se_replays = 0;
+static uint64_t se_misordered = 0;
+static uint64_t se_cached_bytes = 0;
+
+static inline struct se_shard *
+se_shard(uint64_t id)
+{
+    return (&shards[id % FCHAN_SESSION_NSHARDS]);
+}
+
+static inline struct fchan_session **
+se_bucket(struct se_shard *sh, uint64_t id)
+{
+    return (&sh->buckets[(id / FCHAN_SESSION_NSHARDS) % SE_NBUCKETS]);
+}
+
+static inline time_t
+se_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec);
+}
+
+static inline bool
+se_owned(struct fchan_session *se, const struct fchan_session_owner *owner)
+{
+    return ((se->owner.len == owner->len)
+            && (memcmp(se->owner.key, owner->key, owner->len) == 0));
+}
+
+/* with sh->mtx held; a session past its lease isn't found, and waits
+ * for se_reap */
+static struct fchan_session *
+se_find(struct se_shard *sh, uint64_t id)
+{
+    struct fchan_session *se;
+
+    for (se = *se_bucket(sh, id); se; se = se->hnext) {
+        if (se->id == id)
+            break;
+    }
+    if (se && ! se->nconns && se->expires <= se_now())
+        se = NULL;
+    return (se);
+}
+
+/* with sh->mtx held */
+static void
+se_unlink(struct se_shard *sh, struct fchan_session *se)
+{
+    struct fchan_session **sep;
+
+    for (sep = se_bucket(sh, se->id); *sep; sep = &(*sep)->hnext) {
+        if (*sep == se) {
+            *sep = se->hnext;
+            break;
+        }
+    }
+    se->hnext = NULL;
+    --(sh->st.nsessions);
+    ++(sh->st.destroyed);
+    __sync_fetch_and_sub(&se_count, 1);
+}
+
+static void
+se_free(struct fchan_session *se)
+{
+    uint32_t ix;
+
+    for (ix = 0; ix < se->nslots; ++ix) {
+        if (se->slots[ix].cached) {
+            __sync_fetch_and_sub(&se_cached_bytes, se->slots[ix].reply.len);
+            fchan_reply_release(&se->slots[ix].reply);
+        }
+    }
+    pthread_mutex_destroy(&se->mtx);
+    free(se);
+}
+
+/* a call on the session, which renews its lease */
+static struct fchan_session *
+se_get(uint64_t id, const struct fchan_session_owner *owner, u_int *status)
+{
+    struct se_shard *sh = se_shard(id);
+    struct fchan_session *se;
+
+    pthread_mutex_lock(&sh->mtx);
+    se = se_find(sh, id);
+    if (! se)
+        *status = FCHAN_SESS_BADSESSION;
+    else if (! se_owned(se, owner)) {
+        *status = FCHAN_SESS_NOTOWNER;
+        se = NULL;
+    } else {
+        ++(se->refcnt);
+        if (! se->nconns)
+            se->expires = se_now() + FCHAN_SESS_LEASE;
+    }
+    pthread_mutex_unlock(&sh->mtx);
+
+    return (se);
+}
+
+static void
+se_put(struct fchan_session *se)
+{
+    struct se_shard *sh = &shards[se->shard];
+    uint32_t refcnt;
+
+    pthread_mutex_lock(&sh->mtx);
+    refcnt = --(se->refcnt);
+    pthread_mutex_unlock(&sh->mtx);
+
+    /* the table's reference is gone, so it's unlinked */
+    if (refcnt == 0)
+        se_free(se);
+}
+
+/* With sh->mtx held.  Unlinks the shard's sessions past their lease
+ * onto a list through hnext, for the caller to se_put once the lock is
+ * dropped. */
+static struct fchan_session *
+se_reap(struct se_shard *sh)
+{
+    struct fchan_session *se, **sep, *dead = NULL;
+    time_t now = se_now();
+    int bx;
+
+    for (bx = 0; bx < SE_NBUCKETS; ++bx) {
+        for (sep = &sh->buckets[bx]; (se = *sep); ) {
+            if (se->nconns || se->expires > now) {
+                sep = &se->hnext;
+                continue;
+            }
+            se_unlink(sh, se);
+            ++(sh->st.expired);
+            se->hnext = dead;
+            dead = se;
+        }
+    }
+    return (dead);
+}
+
+static void
+se_put_list(struct fchan_session *dead)
+{
+    struct fchan_session *se;
+
+    while ((se = dead)) {
+        dead = se->hnext;
+        se_put(se);
+    }
+}
+
+static void
+se_reap_all(void)
+{
+    struct fchan_session *dead;
+    int ix;
+
+    for (ix = 0; ix < FCHAN_SESSION_NSHARDS; ++ix) {
+        pthread_mutex_lock(&shards[ix].mtx);
+        dead = se_reap(&shards[ix]);
+        pthread_mutex_unlock(&shards[ix].mtx);
+        se_put_list(dead);
+    }
+}
+
+void
+fchan_session_owner(struct svc_req *req, struct fchan_session_owner *owner)
+{
+    struct netbuf *caller = svc_getrpccaller(req->rq_xprt);
+    struct sockaddr *sa;
+    sa_family_t family;
+    struct ucred cred;
+    socklen_t len = sizeof(struct ucred);
+
+    memset(owner, 0, sizeof(struct fchan_session_owner));
+    sa = (caller && caller->len) ? (struct sockaddr *) caller->buf : NULL;
+    family = sa ? sa->sa_family : AF_UNIX;
+    memcpy(owner->key, &family, sizeof(family));
+    owner->len = sizeof(family);
+
+    /* the host, not the port, which changes on reconnect */
+    switch (family) {
+    case AF_INET:
+        memcpy(owner->key + owner->len,
+               &((struct sockaddr_in *) sa)->sin_addr,
+               sizeof(struct in_addr));
+        owner->len += sizeof(struct in_addr);
+        break;
+    case AF_INET6:
+        memcpy(owner->key + owner->len,
+               &((struct sockaddr_in6 *) sa)->sin6_addr,
+               sizeof(struct in6_addr));
+        owner->len += sizeof(struct in6_addr);
+        break;
+    case AF_UNIX:
+        if (getsockopt(req->rq_xprt->xp_fd, SOL_SOCKET, SO_PEERCRED, &cred,
+                       &len) == 0) {
+            memcpy(owner->key + owner->len, &cred.uid, sizeof(cred.uid));
+            owner->len += sizeof(cred.uid);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+u_int
+fchan_session_create(const struct fchan_session_owner *owner,
+                     uint32_t nslots, uint32_t maxcache, uint64_t *idp,
+                     uint32_t *nslotsp, uint32_t *maxcachep)
+{
+    struct fchan_session *se, *dead;
+    struct se_shard *sh;
+
+    if (__sync_add_and_fetch(&se_count, 1) > FCHAN_SESSION_MAX) {
+        /* make room from sessions whose clients never came back */
+        se_reap_all();
+        if (se_count > FCHAN_SESSION_MAX) {
+            __sync_fetch_and_sub(&se_count, 1);
+            return (FCHAN_SESS_TOOMANY);
+        }
+    }
+
+    if (nslots == 0)
+        nslots = 1;
+    if (nslots > FCHAN_SESS_MAXSLOTS)
+        nslots = FCHAN_SESS_MAXSLOTS;
+    if (maxcache > FCHAN_SESS_MAXCACHE)
+        maxcache = FCHAN_SESS_MAXCACHE;
+
+    se = calloc(1, sizeof(struct fchan_session)
+                + nslots * sizeof(struct se_slot));
+    if (! se) {
+        __sync_fetch_and_sub(&se_count, 1);
+        return (FCHAN_SESS_SERVERFAULT);
+    }
+    pthread_mutex_init(&se->mtx, NULL);
+    se->nslots = nslots;
+    se->maxcache = maxcache;
+
+    /* ids from a previous server instance won't match */
+    se->id = se_boot | __sync_add_and_fetch(&se_next, 1);
+    se->shard = se->id % FCHAN_SESSION_NSHARDS;
+    se->refcnt = 1; /* the table's */
+    se->owner = *owner;
+    se->expires = se_now() + FCHAN_SESS_LEASE;
+
+    sh = se_shard(se->id);
+    pthread_mutex_lock(&sh->mtx);
+    dead = se_reap(sh);
+    se->hnext = *se_bucket(sh, se->id);
+    *se_bucket(sh, se->id) = se;
+    ++(sh->st.nsessions);
+    ++(sh->st.created);
+    pthread_mutex_unlock(&sh->mtx);
+    se_put_list(dead);
+
+    *idp = se->id;
+    *nslotsp = nslots;
+    *maxcachep = maxcache;
+
+    return (FCHAN_SESS_OK);
+}
+
+u_int
+fchan_session_destroy(uint64_t id, const struct fchan_session_owner *owner)
+{
+    struct se_shard *sh = se_shard(id);
+    struct fchan_session *se;
+    u_int status = FCHAN_SESS_OK;
+
+    pthread_mutex_lock(&sh->mtx);
+    se = se_find(sh, id);
+    if (! se)
+        status = FCHAN_SESS_BADSESSION;
+    else if (! se_owned(se, owner)) {
+        status = FCHAN_SESS_NOTOWNER;
+        se = NULL;
+    } else
+        se_unlink(sh, se);
+    pthread_mutex_unlock(&sh->mtx);
+
+    if (se)
+        se_put(se);
+    return (status);
+}
+
+u_int
+fchan_session_bind(uint64_t id, const struct fchan_session_owner *owner)
+{
+    struct se_shard *sh = se_shard(id);
+    struct fchan_session *se;
+    u_int status = FCHAN_SESS_OK;
+
+    pthread_mutex_lock(&sh->mtx);
+    se = se_find(sh, id);
+    if (! se)
+        status = FCHAN_SESS_BADSESSION;
+    else if (! se_owned(se, owner))
+        status = FCHAN_SESS_NOTOWNER;
+    else
+        ++(se->nconns);
+    pthread_mutex_unlock(&sh->mtx);
+
+    return (status);
+}
+
+void
+fchan_session_unbind(uint64_t id)
+{
+    struct se_shard *sh;
+    struct fchan_session *se;
+
+    if (! shards)
+        return;
+
+    sh = se_shard(id);
+    pthread_mutex_lock(&sh->mtx);
+    se = se_find(sh, id);
+    if (se && se->nconns && --(se->nconns) == 0)
+        se->expires = se_now() + FCHAN_SESS_LEASE;
+    pthread_mutex_unlock(&sh->mtx);
+}
+
+bool
+fchan_session_exists(uint64_t id)
+{
+    struct se_shard *sh = se_shard(id);
+    bool exists;
+
+    pthread_mutex_lock(&sh->mtx);
+    exists = (se_find(sh, id) != NULL);
+    pthread_mutex_unlock(&sh->mtx);
+
+    return (exists);
+}
+
+enum fchan_slot_status
+fchan_session_slot_start(uint64_t id, const struct fchan_session_owner *owner,
+                         uint32_t slotid, uint32_t seqid,
+                         struct fchan_slot_ref *ref,
+                         struct fchan_reply_buf *rb, u_int *status,
+                         uint32_t *highest)
+{
+    enum fchan_slot_status ss = FCHAN_SLOT_ERROR;
+    struct fchan_session *se;
+    struct se_slot *sl;
+
+    *highest = 0;
+
+    se = se_get(id, owner, status);
+    if (! se)
+        return (FCHAN_SLOT_ERROR);
+    *highest = se->nslots - 1;
+
+    if (slotid >= se->nslots) {
+        *status = FCHAN_SESS_BADSLOT;
+        goto out;
+    }
+
+    pthread_mutex_lock(&se->mtx);
+    sl = &se->slots[slotid];
+    if (seqid == sl->seqid + 1 && ! sl->inuse) {
+        sl->inuse = true;
+        ref->se = se;
+        ref->slotid = slotid;
+        *status = FCHAN_SESS_OK;
+        ss = FCHAN_SLOT_NEW;
+    } else if (seqid == sl->seqid && sl->seqid != 0) {
+        if (sl->inuse)
+            *status = FCHAN_SESS_DELAY;
+        else if (! sl->cached)
+            *status = FCHAN_SESS_RETRY_UNCACHED;
+        else if (! fchan_reply_copy(rb, &sl->reply))
+            *status = FCHAN_SESS_SERVERFAULT;
+        else {
+            *status = FCHAN_SESS_OK;
+            ss = FCHAN_SLOT_REPLAY;
+            __sync_fetch_and_add(&se_replays, 1);
+        }
+    } else {
+        *status = FCHAN_SESS_MISORDERED;
+        __sync_fetch_and_add(&se_misordered, 1);
+    }
+    pthread_mutex_unlock(&se->mtx);
+
+out:
+    /* a NEW slot keeps its reference until finish */
+    if (ss != FCHAN_SLOT_NEW)
+        se_put(se);
+
+    return (ss);
+}
+
+void
+fchan_session_slot_finish(struct fchan_slot_ref *ref, bool done,
+                          struct fchan_reply_buf *rb)
+{
+    struct fchan_session *se = ref->se;
+    struct se_slot *sl = &se->slots[ref->slotid];
+
+    pthread_mutex_lock(&se->mtx);
+    sl->inuse = false;
+    if (done) {
+        ++(sl->seqid);
+        if (sl->cached) {
+            __sync_fetch_and_sub(&se_cached_bytes, sl->reply.len);
+            fchan_reply_release(&sl->reply);
+            sl->cached = false;
+        }
+        if (rb && rb->len <= se->maxcache) {
+            sl->reply = *rb;
+            sl->cached = true;
+            __sync_fetch_and_add(&se_cached_bytes, sl->reply.len);
+            rb = NULL;
+        }
+    }
+    pthread_mutex_unlock(&se->mtx);
+
+    if (rb)
+        fchan_reply_release(rb);
+
+    se_put(se);
+    ref->se = NULL;
+}
+
+int
+fchan_session_init(void)
+{
+    shards = fchan_shard_alloc(FCHAN_SESSION_NSHARDS,
+                               sizeof(struct se_shard));
+    if (! shards)
+        return (ENOMEM);
+
+    se_boot = ((uint64_t) time(0)) << 32;
+
+    return (0);
+}
+
+void
+fchan_session_shutdown(void)
+{
+    struct fchan_session *se;
+    struct se_shard *sh;
+    int ix, bx;
+
+    if (! shards)
+        return;
+
+    for (ix = 0; ix < FCHAN_SESSION_NSHARDS; ++ix) {
+        sh = &shards[ix];
+        for (bx = 0; bx < SE_NBUCKETS; ++bx) {
+            while ((se = sh->buckets[bx])) {
+                sh->buckets[bx] = se->hnext;
+                se_free(se);
+            }
+        }
+    }
+    fchan_shard_free(shards, FCHAN_SESSION_NSHARDS, sizeof(struct se_shard));
+    shards = NULL;
+}
+
+void
+fchan_session_stats(struct fchan_session_stats *st)
+{
+    memset(st, 0, sizeof(struct fchan_session_stats));
+    if (! shards)
+        return;
+
+    /* leases that ran out since are counted now */
+    se_reap_all();
+    fchan_shard_sum(shards, FCHAN_SESSION_NSHARDS, sizeof(struct se_shard),
+                    offsetof(struct se_shard, st), (uint64_t *) st,
+                    SE_NSTATS);
+    st->replays = se_replays;
+    st->misordered = se_misordered;
+    st->cached_bytes = se_cached_bytes;
+}
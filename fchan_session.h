@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_SESSION_H
+#define FCHAN_SESSION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <rpc/rpc.h>
+
+#include "fchan.h"
+#include "fchan_reply.h"
+
+/*
+ * Sessions, after NFSv4.1.  Each session has a fixed slot table sized
+ * at CREATE_SESSION; a client keeps at most one call outstanding per
+ * slot, numbering them with a per-slot seqid.  The slot keeps the
+ * encoded result of its last call (when the client asked for it with
+ * cachethis), so a retransmission is answered without running the
+ * call again.  A session's memory is bounded by nslots * maxcache,
+ * both capped by the server.
+ *
+ * Sessions are looked up by id in a sharded table.  A connection that
+ * created a session, or was bound to it since, is counted against it.
+ * When the last one closes the session is kept for a lease, renewed by
+ * each SEQUENCE, so its client can reconnect, bind again and replay;
+ * it goes away on DESTROY_SESSION or once the lease runs out.
+ *
+ * A session belongs to the client that made it, known by its host (or
+ * over AF_UNIX its uid), so a new connection from another port still
+ * matches.  Nobody else may bind to it, destroy it or run calls on it.
+ */
+
+#define FCHAN_SESSION_NSHARDS 16
+#define FCHAN_SESSION_MAX 4096
+#define FCHAN_SESSION_OWNERLEN 32
+
+enum fchan_slot_status {
+    FCHAN_SLOT_NEW,    /* run it, then fchan_session_slot_finish */
+    FCHAN_SLOT_REPLAY, /* send the returned reply */
+    FCHAN_SLOT_ERROR,  /* send the returned status */
+};
+
+struct fchan_session;
+
+struct fchan_session_owner {
+    uint32_t len;
+    char key[FCHAN_SESSION_OWNERLEN];
+};
+
+/* a slot held by a running call */
+struct fchan_slot_ref {
+    struct fchan_session *se;
+    uint32_t slotid;
+};
+
+struct fchan_session_stats {
+    uint64_t created;
+    uint64_t destroyed;
+    uint64_t expired;   /* lease ran out, of destroyed */
+    uint64_t nsessions;
+    uint64_t replays;
+    uint64_t misordered;
+    uint64_t cached_bytes;
+};
+
+/* returns errno */
+int fchan_session_init(void);
+void fchan_session_shutdown(void);
+
+/* the caller's owner key */
+void fchan_session_owner(struct svc_req *req,
+                         struct fchan_session_owner *owner);
+
+/* nslots and maxcache are clamped; returns a FCHAN_SESS_ status.  The
+ * session starts on its lease, until bound. */
+u_int fchan_session_create(const struct fchan_session_owner *owner,
+                           uint32_t nslots, uint32_t maxcache,
+                           uint64_t *idp, uint32_t *nslotsp,
+                           uint32_t *maxcachep);
+u_int fchan_session_destroy(uint64_t id,
+                            const struct fchan_session_owner *owner);
+
+/* connection reference counting; bind returns a FCHAN_SESS_ status,
+ * and the last unbind starts the lease */
+u_int fchan_session_bind(uint64_t id,
+                         const struct fchan_session_owner *owner);
+void fchan_session_unbind(uint64_t id);
+
+bool fchan_session_exists(uint64_t id);
+
+/* On NEW, *ref holds the slot until fchan_session_slot_finish.  On
+ * REPLAY, rb gets a private copy of the cached result, which the caller
+ * sends and releases.  *highest is the session's highest slotid. */
+enum fchan_slot_status fchan_session_slot_start(
+    uint64_t id, const struct fchan_session_owner *owner, uint32_t slotid,
+    uint32_t seqid, struct fchan_slot_ref *ref, struct fchan_reply_buf *rb,
+    u_int *status, uint32_t *highest);
+
+/* Release the slot.  If done, the seqid is consumed and rb (may be
+ * NULL) becomes the slot's cached result, which it takes; otherwise the
+ * client may retry the same seqid. */
+void fchan_session_slot_finish(struct fchan_slot_ref *ref, bool done,
+                               struct fchan_reply_buf *rb);
+
+void fchan_session_stats(struct fchan_session_stats *st);
+
+#endif /* FCHAN_SESSION_H */
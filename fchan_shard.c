@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "fchan_shard.h"
+
+void *
+fchan_shard_alloc(uint32_t nshards, size_t size)
+{
+    pthread_mutex_t *mtx;
+    void *shards;
+    uint32_t ix;
+
+    if (posix_memalign(&shards, FCHAN_SHARD_ALIGN, nshards * size))
+        return (NULL);
+    memset(shards, 0, nshards * size);
+
+    for (ix = 0; ix < nshards; ++ix) {
+        mtx = fchan_shard_at(shards, size, ix);
+        pthread_mutex_init(mtx, NULL);
+    }
+
+    return (shards);
+}
+
+void
+fchan_shard_free(void *shards, uint32_t nshards, size_t size)
+{
+    pthread_mutex_t *mtx;
+    uint32_t ix;
+
+    if (! shards)
+        return;
+
+    for (ix = 0; ix < nshards; ++ix) {
+        mtx = fchan_shard_at(shards, size, ix);
+        pthread_mutex_destroy(mtx);
+    }
+    free(shards);
+}
+
+void
+fchan_shard_sum(void *shards, uint32_t nshards, size_t size, size_t off,
+                uint64_t *sum, uint32_t n)
+{
+    pthread_mutex_t *mtx;
+    uint64_t *ctr;
+    uint32_t ix, cx;
+
+    for (ix = 0; ix < nshards; ++ix) {
+        mtx = fchan_shard_at(shards, size, ix);
+        ctr = (uint64_t *) ((char *) mtx + off);
+        pthread_mutex_lock(mtx);
+        for (cx = 0; cx < n; ++cx)
+            sum[cx] += ctr[cx];
+        pthread_mutex_unlock(mtx);
+    }
+}
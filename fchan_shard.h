@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FCHAN_SHARD_H
+#define FCHAN_SHARD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/*
+ * Arrays of lock shards, for the hashed tables.  A shard is a struct
+ * whose first member is its pthread_mutex_t, declared FCHAN_SHARD_ALIGNED
+ * so neighbours don't share a cache line.
+ */
+
+#define FCHAN_SHARD_ALIGN 64
+#define FCHAN_SHARD_ALIGNED __attribute__((aligned(FCHAN_SHARD_ALIGN)))
+
+/* nshards shards of size bytes, zeroed, with their locks set up; NULL
+ * if out of memory */
+void *fchan_shard_alloc(uint32_t nshards, size_t size);
+
+/* the caller has emptied them */
+void fchan_shard_free(void *shards, uint32_t nshards, size_t size);
+
+static inline void *
+fchan_shard_at(void *shards, size_t size, uint32_t ix)
+{
+    return ((char *) shards + (ix * size));
+}
+
+/* Adds n uint64_t counters, at off in each shard, into sum; each shard
+ * is read under its lock. */
+void fchan_shard_sum(void *shards, uint32_t nshards, size_t size,
+                     size_t off, uint64_t *sum, uint32_t n);
+
+#endif /* FCHAN_SHARD_H */
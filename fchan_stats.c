@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fchan.h"
+#include "bchan.h"
+#include "fchan_stats.h"
+
+#define STATS_NPROGS 2 /* FCHAN_PROG, BCHAN_PROG */
+
+struct stats_table {
+    uint64_t calls[STATS_NPROGS][FCHAN_STATS_MAXPROC];
+    uint64_t errors[STATS_NPROGS][FCHAN_STATS_MAXPROC];
+    uint64_t hist[STATS_NPROGS][FCHAN_STATS_MAXPROC][FCHAN_STATS_NBUCKETS];
+};
+
+/* same scheme as the request pool: a private table per thread, in a
+ * registry that is only locked on thread start/exit and on read */
+struct stats_tcache {
+    struct stats_table t;
+    struct stats_tcache *next;
+};
+
+static __thread struct stats_tcache *tcache = NULL;
+
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t stats_key;
+static pthread_mutex_t stats_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct stats_tcache *stats_threads = NULL;
+static struct stats_table stats_retired; /* from exited threads */
+
+static const u_int stats_progs[STATS_NPROGS] = { FCHAN_PROG, BCHAN_PROG };
+
+static const char *stats_proc_names[STATS_NPROGS][FCHAN_STATS_MAXPROC] = {
+    { "NULL", "SENDMSG1", "BIND_CONN_TO_SESSION1", "READ", "WRITE",
+      "STATS", "CREATE_SESSION", "DESTROY_SESSION", "SEQUENCE",
+      "COMPOUND", "READV", "WRITEV", "NEGOTIATE", "READ64", "WRITE64",
+      "BIND_CONN_TO_SESSION" },
+    { "CB_NULL", "CALLBACK1" },
+};
+
+static void
+stats_table_add(struct stats_table *to, const struct stats_table *from)
+{
+    int p, ix, b;
+
+    for (p = 0; p < STATS_NPROGS; ++p) {
+        for (ix = 0; ix < FCHAN_STATS_MAXPROC; ++ix) {
+            if (! from->calls[p][ix])
+                continue;
+            to->calls[p][ix] += from->calls[p][ix];
+            to->errors[p][ix] += from->errors[p][ix];
+            for (b = 0; b < FCHAN_STATS_NBUCKETS; ++b)
+                to->hist[p][ix][b] += from->hist[p][ix][b];
+        }
+    }
+}
+
+static void
+stats_thread_exit(void *arg)
+{
+    struct stats_tcache *tc = (struct stats_tcache *) arg, **tcp;
+
+    pthread_mutex_lock(&stats_mtx);
+    for (tcp = &stats_threads; *tcp; tcp = &(*tcp)->next) {
+        if (*tcp == tc) {
+            *tcp = tc->next;
+            break;
+        }
+    }
+    stats_table_add(&stats_retired, &tc->t);
+    pthread_mutex_unlock(&stats_mtx);
+
+    free(tc);
+}
+
+static void
+stats_init(void)
+{
+    pthread_key_create(&stats_key, stats_thread_exit);
+}
+
+static inline struct stats_tcache *
+stats_tcache(void)
+{
+    if (! tcache) {
+        pthread_once(&stats_once, stats_init);
+        tcache = calloc(1, sizeof(struct stats_tcache));
+        pthread_setspecific(stats_key, tcache);
+        pthread_mutex_lock(&stats_mtx);
+        tcache->next = stats_threads;
+        stats_threads = tcache;
+        pthread_mutex_unlock(&stats_mtx);
+    }
+    return (tcache);
+}
+
+void
+fchan_stats_record(u_int prog, u_int proc, uint64_t ns, bool error)
+{
+    struct stats_tcache *tc;
+    int p = (prog == FCHAN_PROG) ? 0 : 1;
+
+    if (proc >= FCHAN_STATS_MAXPROC)
+        return;
+
+    tc = stats_tcache();
+    ++(tc->t.calls[p][proc]);
+    if (error)
+        ++(tc->t.errors[p][proc]);
+    ++(tc->t.hist[p][proc][fchan_stats_bucket(ns)]);
+}
+
+void
+fchan_stats_fill(stats_res *res)
+{
+    struct stats_table *sum;
+    struct stats_tcache *tc;
+    fchan_proc_stats *ps;
+    int p, ix, nb;
+
+    sum = malloc(sizeof(struct stats_table));
+
+    /* racy read of the live tables, like fchan_rqpool_stats */
+    pthread_mutex_lock(&stats_mtx);
+    *sum = stats_retired;
+    for (tc = stats_threads; tc; tc = tc->next)
+        stats_table_add(sum, &tc->t);
+    pthread_mutex_unlock(&stats_mtx);
+
+    res->procs.procs_len = 0;
+    res->procs.procs_val = calloc(STATS_NPROGS * FCHAN_STATS_MAXPROC,
+                                  sizeof(fchan_proc_stats));
+
+    for (p = 0; p < STATS_NPROGS; ++p) {
+        for (ix = 0; ix < FCHAN_STATS_MAXPROC; ++ix) {
+            if (! sum->calls[p][ix])
+                continue;
+            ps = &res->procs.procs_val[(res->procs.procs_len)++];
+            ps->prog = stats_progs[p];
+            ps->proc = ix;
+            ps->calls = sum->calls[p][ix];
+            ps->errors = sum->errors[p][ix];
+            for (nb = FCHAN_STATS_NBUCKETS; nb > 0; --nb)
+                if (sum->hist[p][ix][nb - 1])
+                    break;
+            ps->hist.hist_len = nb;
+            ps->hist.hist_val = malloc(nb * sizeof(u_quad_t));
+            memcpy(ps->hist.hist_val, sum->hist[p][ix],
+                   nb * sizeof(u_quad_t));
+        }
+    }
+
+    free(sum);
+}
+
+void
+fchan_stats_counter(stats_res *res, const char *name, uint64_t value)
+{
+    fchan_counter *ctr;
+
+    res->counters.counters_val =
+        realloc(res->counters.counters_val,
+                (res->counters.counters_len + 1) * sizeof(fchan_counter));
+    ctr = &res->counters.counters_val[(res->counters.counters_len)++];
+    ctr->name = strdup(name);
+    ctr->value = value;
+}
+
+uint64_t
+fchan_stats_percentile(const fchan_proc_stats *ps, double q)
+{
+    uint64_t total = 0, rank, seen = 0;
+    u_int b;
+
+    for (b = 0; b < ps->hist.hist_len; ++b)
+        total += ps->hist.hist_val[b];
+    if (! total)
+        return (0);
+
+    /* rank of the q'th sample, counting from 1 */
+    rank = (uint64_t) (q * total);
+    if ((double) rank < q * total)
+        ++rank;
+    if (rank < 1)
+        rank = 1;
+
+    for (b = 0; b < ps->hist.hist_len; ++b) {
+        seen += ps->hist.hist_val[b];
+        if (seen >= rank)
+            break;
+    }
+    return (fchan_stats_bucket_floor(b));
+}
+
+void
+fchan_stats_print(FILE *fp, const stats_res *res)
+{
+    const fchan_proc_stats *ps;
+    const char *name;
+    u_int ix;
+
+    fprintf(fp, "%-22s %10s %8s %10s %10s %10s\n", "proc", "calls",
+            "errors", "p50(us)", "p99(us)", "p999(us)");
+    for (ix = 0; ix < res->procs.procs_len; ++ix) {
+        ps = &res->procs.procs_val[ix];
+        name = NULL;
+        if (ps->proc < FCHAN_STATS_MAXPROC)
+            name = stats_proc_names[(ps->prog == FCHAN_PROG) ? 0 : 1]
+                [ps->proc];
+        if (name)
+            fprintf(fp, "%-22s", name);
+        else
+            fprintf(fp, "%#x/%-15u", ps->prog, ps->proc);
+        fprintf(fp, " %10llu %8llu %10.1f %10.1f %10.1f\n",
+                (unsigned long long) ps->calls,
+                (unsigned long long) ps->errors,
+                fchan_stats_percentile(ps, 0.50) / 1000.0,
+                fchan_stats_percentile(ps, 0.99) / 1000.0,
+                fchan_stats_percentile(ps, 0.999) / 1000.0);
+    }
+
+    for (ix = 0; ix < res->counters.counters_len; ++ix)
+        fprintf(fp, "%-32s %llu\n", res->counters.counters_val[ix].name,
+                (unsigned long long) res->counters.counters_val[ix].value);
+}
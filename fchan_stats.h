@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_STATS_H
+#define FCHAN_STATS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "fchan.h"
+
+/*
+ * Per-procedure call, error and latency counters, as returned by the
+ * STATS procedure.  Recording goes to a per-thread table with no
+ * locking; tables are only summed when someone asks.
+ *
+ * Latency is in nanoseconds, in log-linear buckets: values below 4 get
+ * a bucket each, then every power of two is split into four buckets,
+ * so a percentile read off the histogram is within 25%.
+ */
+
+#define FCHAN_STATS_MAXPROC 16 /* per program */
+
+static inline u_int
+fchan_stats_bucket(uint64_t ns)
+{
+    u_int msb;
+
+    if (ns < 4)
+        return (ns);
+    msb = 63 - __builtin_clzll(ns);
+    if (msb > FCHAN_STATS_NBUCKETS / 4)
+        return (FCHAN_STATS_NBUCKETS - 1);
+    return (((msb - 1) << 2) | ((ns >> (msb - 2)) & 3));
+}
+
+/* smallest latency that lands in bucket b */
+static inline uint64_t
+fchan_stats_bucket_floor(u_int b)
+{
+    if (b < 4)
+        return (b);
+    return (((uint64_t) (4 | (b & 3))) << ((b >> 2) - 1));
+}
+
+static inline uint64_t
+fchan_stats_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+/* prog is FCHAN_PROG or BCHAN_PROG (callbacks we make) */
+void fchan_stats_record(u_int prog, u_int proc, uint64_t ns, bool error);
+
+/* Fill in procs from all threads' tables, and add a counter.  The
+ * result owns its memory; release it with xdr_free(xdr_stats_res). */
+void fchan_stats_fill(stats_res *res);
+void fchan_stats_counter(stats_res *res, const char *name, uint64_t value);
+
+/* latency in ns at quantile q (0..1), from the bucket floors */
+uint64_t fchan_stats_percentile(const fchan_proc_stats *ps, double q);
+
+void fchan_stats_print(FILE *fp, const stats_res *res);
+
+#endif /* FCHAN_STATS_H */
@@ -23,12 +23,25 @@ fchan_prog_1(struct svc_req *req, register SVCXPRT *xprt)
 		fchan_msg sendmsg1_1_arg;
 		read_args read_1_arg;
 		write_args write_1_arg;
+		create_session_args create_session_1_arg;
+		u_quad_t destroy_session_1_arg;
+		sequence_args sequence_1_arg;
+		compound_args compound_1_arg;
+		readv_args readv_1_arg;
+		writev_args writev_1_arg;
 	} argument;
 	union {
 		fchan_res sendmsg1_1_res;
 		int bind_conn_to_session1_1_res;
 		read_res read_1_res;
 		write_res write_1_res;
+		stats_res stats_1_res;
+		create_session_res create_session_1_res;
+		u_int destroy_session_1_res;
+		sequence_res sequence_1_res;
+		compound_res compound_1_res;
+		readv_res readv_1_res;
+		writev_res writev_1_res;
 	} result;
 	bool_t retval;
 	xdrproc_t _xdr_argument, _xdr_result;
@@ -63,6 +76,48 @@ fchan_prog_1(struct svc_req *req, register SVCXPRT *xprt)
 		local = (bool_t (*) (char *, void *,  struct svc_req *))write_1_svc;
 		break;
 
+	case STATS:
+		_xdr_argument = (xdrproc_t) xdr_void;
+		_xdr_result = (xdrproc_t) xdr_stats_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))stats_1_svc;
+		break;
+
+	case CREATE_SESSION:
+		_xdr_argument = (xdrproc_t) xdr_create_session_args;
+		_xdr_result = (xdrproc_t) xdr_create_session_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))create_session_1_svc;
+		break;
+
+	case DESTROY_SESSION:
+		_xdr_argument = (xdrproc_t) xdr_u_quad_t;
+		_xdr_result = (xdrproc_t) xdr_u_int;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))destroy_session_1_svc;
+		break;
+
+	case SEQUENCE:
+		_xdr_argument = (xdrproc_t) xdr_sequence_args;
+		_xdr_result = (xdrproc_t) xdr_sequence_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))sequence_1_svc;
+		break;
+
+	case COMPOUND:
+		_xdr_argument = (xdrproc_t) xdr_compound_args;
+		_xdr_result = (xdrproc_t) xdr_compound_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))compound_1_svc;
+		break;
+
+	case READV:
+		_xdr_argument = (xdrproc_t) xdr_readv_args;
+		_xdr_result = (xdrproc_t) xdr_readv_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))readv_1_svc;
+		break;
+
+	case WRITEV:
+		_xdr_argument = (xdrproc_t) xdr_writev_args;
+		_xdr_result = (xdrproc_t) xdr_writev_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))writev_1_svc;
+		break;
+
 	default:
             svcerr_noproc(xprt, req);
 		return;
@@ -86,6 +141,163 @@ fchan_prog_1(struct svc_req *req, register SVCXPRT *xprt)
 	return;
 }
 
+static void
+fchan_prog_2(struct svc_req *req, register SVCXPRT *xprt)
+{
+	union {
+		fchan_msg sendmsg1_2_arg;
+		read64_args read_2_arg;
+		write64_args write_2_arg;
+		create_session_args create_session_2_arg;
+		u_quad_t destroy_session_2_arg;
+		sequence_args sequence_2_arg;
+		compound_args compound_2_arg;
+		readv_args readv_2_arg;
+		writev_args writev_2_arg;
+		negotiate_args negotiate_2_arg;
+		read64_args read64_2_arg;
+		write64_args write64_2_arg;
+		bind_conn_args bind_conn_to_session_2_arg;
+	} argument;
+	union {
+		fchan_res sendmsg1_2_res;
+		int bind_conn_to_session1_2_res;
+		read_res read_2_res;
+		write_res write_2_res;
+		stats_res stats_2_res;
+		create_session_res create_session_2_res;
+		u_int destroy_session_2_res;
+		sequence_res sequence_2_res;
+		compound_res compound_2_res;
+		readv_res readv_2_res;
+		writev_res writev_2_res;
+		negotiate_res negotiate_2_res;
+		read_res read64_2_res;
+		write_res write64_2_res;
+		u_int bind_conn_to_session_2_res;
+	} result;
+	bool_t retval;
+	xdrproc_t _xdr_argument, _xdr_result;
+	bool_t (*local)(char *, void *, struct svc_req *);
+
+	switch (req->rq_proc) {
+	case NULLPROC:
+            (void) svc_sendreply(xprt, req, (xdrproc_t) xdr_void, (char *)NULL);
+		return;
+
+	case SENDMSG1:
+		_xdr_argument = (xdrproc_t) xdr_fchan_msg;
+		_xdr_result = (xdrproc_t) xdr_fchan_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))sendmsg1_2_svc;
+		break;
+
+	case BIND_CONN_TO_SESSION1:
+		_xdr_argument = (xdrproc_t) xdr_void;
+		_xdr_result = (xdrproc_t) xdr_int;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))bind_conn_to_session1_2_svc;
+		break;
+
+	case READ:
+		_xdr_argument = (xdrproc_t) xdr_read64_args;
+		_xdr_result = (xdrproc_t) xdr_read_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))read_2_svc;
+		break;
+
+	case WRITE:
+		_xdr_argument = (xdrproc_t) xdr_write64_args;
+		_xdr_result = (xdrproc_t) xdr_write_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))write_2_svc;
+		break;
+
+	case STATS:
+		_xdr_argument = (xdrproc_t) xdr_void;
+		_xdr_result = (xdrproc_t) xdr_stats_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))stats_2_svc;
+		break;
+
+	case CREATE_SESSION:
+		_xdr_argument = (xdrproc_t) xdr_create_session_args;
+		_xdr_result = (xdrproc_t) xdr_create_session_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))create_session_2_svc;
+		break;
+
+	case DESTROY_SESSION:
+		_xdr_argument = (xdrproc_t) xdr_u_quad_t;
+		_xdr_result = (xdrproc_t) xdr_u_int;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))destroy_session_2_svc;
+		break;
+
+	case SEQUENCE:
+		_xdr_argument = (xdrproc_t) xdr_sequence_args;
+		_xdr_result = (xdrproc_t) xdr_sequence_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))sequence_2_svc;
+		break;
+
+	case COMPOUND:
+		_xdr_argument = (xdrproc_t) xdr_compound_args;
+		_xdr_result = (xdrproc_t) xdr_compound_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))compound_2_svc;
+		break;
+
+	case READV:
+		_xdr_argument = (xdrproc_t) xdr_readv_args;
+		_xdr_result = (xdrproc_t) xdr_readv_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))readv_2_svc;
+		break;
+
+	case WRITEV:
+		_xdr_argument = (xdrproc_t) xdr_writev_args;
+		_xdr_result = (xdrproc_t) xdr_writev_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))writev_2_svc;
+		break;
+
+	case NEGOTIATE:
+		_xdr_argument = (xdrproc_t) xdr_negotiate_args;
+		_xdr_result = (xdrproc_t) xdr_negotiate_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))negotiate_2_svc;
+		break;
+
+	case READ64:
+		_xdr_argument = (xdrproc_t) xdr_read64_args;
+		_xdr_result = (xdrproc_t) xdr_read_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))read64_2_svc;
+		break;
+
+	case WRITE64:
+		_xdr_argument = (xdrproc_t) xdr_write64_args;
+		_xdr_result = (xdrproc_t) xdr_write_res;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))write64_2_svc;
+		break;
+
+	case BIND_CONN_TO_SESSION:
+		_xdr_argument = (xdrproc_t) xdr_bind_conn_args;
+		_xdr_result = (xdrproc_t) xdr_u_int;
+		local = (bool_t (*) (char *, void *,  struct svc_req *))bind_conn_to_session_2_svc;
+		break;
+
+	default:
+            svcerr_noproc(xprt, req);
+		return;
+	}
+	memset ((char *)&argument, 0, sizeof (argument));
+	if (!svc_getargs (xprt, req, _xdr_argument, (caddr_t) &argument, NULL)) {
+            svcerr_decode(xprt, req);
+		return;
+	}
+	retval = (bool_t) (*local)((char *)&argument, (void *)&result, req);
+	if (retval > 0 && !svc_sendreply(xprt, req, (xdrproc_t) _xdr_result, (char *)&result)) {
+            svcerr_systemerr(xprt, req);
+	}
+	if (!svc_freeargs(xprt, (xdrproc_t) _xdr_argument, (caddr_t) &argument)) {
+		fprintf (stderr, "%s", "unable to free arguments");
+		exit (1);
+	}
+	if (!fchan_prog_2_freeresult(xprt, _xdr_result, (caddr_t) &result))
+		fprintf(stderr, "%s", "unable to free results");
+
+	return;
+}
+
 #if 0
 int
 main (int argc, char **argv)
@@ -93,6 +305,7 @@ main (int argc, char **argv)
 	register SVCXPRT *xprt;
 
 	pmap_unset (FCHAN_PROG, FCHANV);
+	pmap_unset (FCHAN_PROG, FCHANV2);
 
 	xprt = svcudp_create(RPC_ANYSOCK);
 	if (xprt == NULL) {
@@ -103,6 +316,10 @@ main (int argc, char **argv)
 		fprintf (stderr, "%s", "unable to register (FCHAN_PROG, FCHANV, udp).");
 		exit(1);
 	}
+	if (!svc_register(xprt, FCHAN_PROG, FCHANV2, fchan_prog_2, IPPROTO_UDP)) {
+		fprintf (stderr, "%s", "unable to register (FCHAN_PROG, FCHANV2, udp).");
+		exit(1);
+	}
 
 	xprt = svctcp_create(RPC_ANYSOCK, 0, 0);
 	if (xprt == NULL) {
@@ -113,6 +330,10 @@ main (int argc, char **argv)
 		fprintf (stderr, "%s", "unable to register (FCHAN_PROG, FCHANV, tcp).");
 		exit(1);
 	}
+	if (!svc_register(xprt, FCHAN_PROG, FCHANV2, fchan_prog_2, IPPROTO_TCP)) {
+		fprintf (stderr, "%s", "unable to register (FCHAN_PROG, FCHANV2, tcp).");
+		exit(1);
+	}
 
 	svc_run ();
 	fprintf (stderr, "%s", "svc_run returned");
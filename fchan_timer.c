@@ -0,0 +1,263 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <pthread.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "fchan_timer.h"
+
+#define TW0_BITS  8
+#define TW0_SIZE  (1 << TW0_BITS)
+#define TW0_MASK  (TW0_SIZE - 1)
+#define TW1_SIZE  64
+#define TW1_MASK  (TW1_SIZE - 1)
+
+/* keep level 1 from wrapping onto the slot being cascaded */
+#define TW_MAX_DELTA ((uint64_t) TW0_SIZE * (TW1_SIZE - 1))
+
+/* circular lists with a sentinel head */
+struct tw_slot {
+    struct fchan_timer head;
+};
+
+static struct {
+    pthread_mutex_t mtx;
+    uint64_t now; /* ticks */
+    struct tw_slot tv0[TW0_SIZE];
+    struct tw_slot tv1[TW1_SIZE];
+    int tfd;
+    int efd[2]; /* wakes the thread for shutdown */
+    pthread_t tid;
+    bool running;
+} tw = {
+    PTHREAD_MUTEX_INITIALIZER
+};
+
+static inline void
+tw_slot_init(struct tw_slot *s)
+{
+    s->head.prev = s->head.next = &s->head;
+}
+
+static inline void
+tw_unlink(struct fchan_timer *t)
+{
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    t->prev = t->next = NULL;
+}
+
+static inline void
+tw_append(struct tw_slot *s, struct fchan_timer *t)
+{
+    t->prev = s->head.prev;
+    t->next = &s->head;
+    s->head.prev->next = t;
+    s->head.prev = t;
+}
+
+/* with tw.mtx held */
+static void
+tw_place(struct fchan_timer *t)
+{
+    uint64_t delta;
+
+    if (t->expires < tw.now)
+        t->expires = tw.now;
+    delta = t->expires - tw.now;
+
+    if (delta < TW0_SIZE)
+        tw_append(&tw.tv0[t->expires & TW0_MASK], t);
+    else {
+        if (delta > TW_MAX_DELTA)
+            t->expires = tw.now + TW_MAX_DELTA;
+        tw_append(&tw.tv1[(t->expires >> TW0_BITS) & TW1_MASK], t);
+    }
+}
+
+void
+fchan_timer_add(struct fchan_timer *t, uint32_t ms)
+{
+    uint64_t ticks = (ms + FCHAN_TIMER_TICK_MS - 1) / FCHAN_TIMER_TICK_MS;
+
+    pthread_mutex_lock(&tw.mtx);
+    if (t->pending)
+        tw_unlink(t);
+    /* at least one tick out, the current slot may already be done */
+    t->expires = tw.now + (ticks ? ticks : 1);
+    t->pending = true;
+    tw_place(t);
+    pthread_mutex_unlock(&tw.mtx);
+}
+
+bool
+fchan_timer_cancel(struct fchan_timer *t)
+{
+    bool was_pending;
+
+    pthread_mutex_lock(&tw.mtx);
+    was_pending = t->pending;
+    if (t->pending) {
+        tw_unlink(t);
+        t->pending = false;
+    }
+    pthread_mutex_unlock(&tw.mtx);
+
+    return (was_pending);
+}
+
+/* advance one tick; with tw.mtx held, expired timers are moved to
+ * the list at done */
+static void
+tw_tick(struct tw_slot *done)
+{
+    struct tw_slot *s;
+    struct fchan_timer *t;
+
+    ++(tw.now);
+
+    /* bring the next 256 ticks' worth down from level 1 */
+    if ((tw.now & TW0_MASK) == 0) {
+        s = &tw.tv1[(tw.now >> TW0_BITS) & TW1_MASK];
+        while ((t = s->head.next) != &s->head) {
+            tw_unlink(t);
+            tw_place(t);
+        }
+    }
+
+    s = &tw.tv0[tw.now & TW0_MASK];
+    while ((t = s->head.next) != &s->head) {
+        tw_unlink(t);
+        t->pending = false;
+        tw_append(done, t);
+    }
+}
+
+static void *
+tw_thread(void *arg)
+{
+    struct pollfd pfd[2];
+    struct tw_slot done;
+    struct fchan_timer *t;
+    uint64_t nticks;
+
+    pfd[0].fd = tw.tfd;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = tw.efd[0];
+    pfd[1].events = POLLIN;
+
+    while (tw.running) {
+        if (poll(pfd, 2, -1 /* ms */) < 0)
+            continue;
+        if (pfd[1].revents)
+            break;
+        if (read(tw.tfd, &nticks, sizeof(uint64_t)) != sizeof(uint64_t))
+            continue;
+
+        tw_slot_init(&done);
+        pthread_mutex_lock(&tw.mtx);
+        /* catch up if we were descheduled for several ticks */
+        while (nticks--)
+            tw_tick(&done);
+        pthread_mutex_unlock(&tw.mtx);
+
+        /* fn may re-add t, so unlink before calling */
+        while ((t = done.head.next) != &done.head) {
+            t->prev->next = t->next;
+            t->next->prev = t->prev;
+            t->prev = t->next = NULL;
+            t->fn(t);
+        }
+    }
+
+    return (NULL);
+}
+
+int
+fchan_timer_init(void)
+{
+    struct itimerspec its;
+    int ix, code;
+
+    for (ix = 0; ix < TW0_SIZE; ++ix)
+        tw_slot_init(&tw.tv0[ix]);
+    for (ix = 0; ix < TW1_SIZE; ++ix)
+        tw_slot_init(&tw.tv1[ix]);
+
+    tw.tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+    if (tw.tfd < 0)
+        return (errno);
+    if (pipe(tw.efd) < 0) {
+        code = errno;
+        close(tw.tfd);
+        return (code);
+    }
+
+    memset(&its, 0, sizeof(struct itimerspec));
+    its.it_interval.tv_nsec = FCHAN_TIMER_TICK_MS * 1000000;
+    its.it_value = its.it_interval;
+    if (timerfd_settime(tw.tfd, 0, &its, NULL) < 0) {
+        code = errno;
+        goto err;
+    }
+
+    tw.running = true;
+    code = pthread_create(&tw.tid, NULL, tw_thread, NULL);
+    if (code) {
+        tw.running = false;
+        goto err;
+    }
+
+    return (0);
+
+err:
+    close(tw.tfd);
+    close(tw.efd[0]);
+    close(tw.efd[1]);
+    return (code);
+}
+
+void
+fchan_timer_shutdown(void)
+{
+    char c = 0;
+
+    if (! tw.running)
+        return;
+
+    tw.running = false;
+    (void) write(tw.efd[1], &c, 1);
+    pthread_join(tw.tid, NULL);
+
+    close(tw.tfd);
+    close(tw.efd[0]);
+    close(tw.efd[1]);
+}
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_TIMER_H
+#define FCHAN_TIMER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Two-level hierarchical timer wheel, driven by one thread reading a
+ * periodic timerfd.  Level 0 has a slot per tick, level 1 a slot per
+ * 256 ticks, cascaded into level 0 as its time comes up; longer
+ * timeouts are clamped to the level 1 horizon.  Adding and cancelling
+ * are O(1).
+ *
+ * Expiry functions run on the wheel thread and should only hand work
+ * off (e.g. to a fchan_wq); a timer may be re-added from its own
+ * expiry function.
+ */
+
+#define FCHAN_TIMER_TICK_MS 10
+
+struct fchan_timer;
+typedef void (*fchan_timer_fn)(struct fchan_timer *t);
+
+struct fchan_timer {
+    struct fchan_timer *prev, *next;
+    uint64_t expires; /* in ticks */
+    fchan_timer_fn fn;
+    bool pending;
+};
+
+static inline void
+fchan_timer_setup(struct fchan_timer *t, fchan_timer_fn fn)
+{
+    t->prev = t->next = NULL;
+    t->expires = 0;
+    t->fn = fn;
+    t->pending = false;
+}
+
+/* returns errno */
+int fchan_timer_init(void);
+
+/* stops the wheel thread; pending timers are left unfired */
+void fchan_timer_shutdown(void);
+
+/* (re)arm t to fire in ms */
+void fchan_timer_add(struct fchan_timer *t, uint32_t ms);
+
+/* true if t was pending (it won't fire) */
+bool fchan_timer_cancel(struct fchan_timer *t);
+
+#endif /* FCHAN_TIMER_H */
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fchan_trace.h"
+
+struct trace_ring {
+    uint64_t head; /* records ever written; only the owner stores */
+    uint32_t id;
+    bool in_use;
+    struct trace_ring *next;
+    struct fchan_trace_rec recs[FCHAN_TRACE_NRECS];
+};
+
+bool fchan_trace_on = false;
+
+static __thread struct trace_ring *tring = NULL;
+
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_key_t trace_key;
+static pthread_mutex_t trace_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct trace_ring *trace_rings = NULL;
+static uint32_t trace_nrings = 0;
+
+static const char *trace_event_names[FCHAN_TR_NEVENTS] = {
+    "NONE", "SENDMSG1", "BIND_CONN", "READ", "WRITE", "CALLBACK1",
+    "CALLBACK1_SVC", "SEQUENCE",
+    "COMPOUND", "READV", "WRITEV", "READ64", "WRITE64"
+};
+
+/* an exited thread's ring goes to the next new thread, so its records
+ * stay dumpable until they are overwritten */
+static void
+trace_thread_exit(void *arg)
+{
+    struct trace_ring *tr = (struct trace_ring *) arg;
+
+    pthread_mutex_lock(&trace_mtx);
+    tr->in_use = false;
+    pthread_mutex_unlock(&trace_mtx);
+}
+
+static void
+trace_key_init(void)
+{
+    pthread_key_create(&trace_key, trace_thread_exit);
+}
+
+static struct trace_ring *
+trace_ring(void)
+{
+    struct trace_ring *tr;
+
+    pthread_once(&trace_once, trace_key_init);
+
+    pthread_mutex_lock(&trace_mtx);
+    for (tr = trace_rings; tr; tr = tr->next)
+        if (! tr->in_use)
+            break;
+    if (! tr) {
+        tr = calloc(1, sizeof(struct trace_ring));
+        tr->id = trace_nrings++;
+        tr->next = trace_rings;
+        trace_rings = tr;
+    }
+    tr->in_use = true;
+    pthread_mutex_unlock(&trace_mtx);
+
+    pthread_setspecific(trace_key, tr);
+    tring = tr;
+    return (tr);
+}
+
+void
+fchan_trace_init(void)
+{
+    fchan_trace_on = true;
+}
+
+void
+fchan_trace_rec(uint16_t event, uint16_t status, uint32_t xid,
+                uint32_t seqnum, uint32_t fileno, uint64_t off, uint32_t len)
+{
+    struct trace_ring *tr = tring;
+    struct fchan_trace_rec *rec;
+    struct timespec ts;
+
+    if (! tr)
+        tr = trace_ring();
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    rec = &tr->recs[tr->head & (FCHAN_TRACE_NRECS - 1)];
+    rec->ts = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    rec->off = off;
+    rec->xid = xid;
+    rec->seqnum = seqnum;
+    rec->fileno = fileno;
+    rec->len = len;
+    rec->event = event;
+    rec->status = status;
+    rec->ring = tr->id;
+
+    /* publish after the record is complete */
+    __atomic_store_n(&tr->head, tr->head + 1, __ATOMIC_RELEASE);
+}
+
+/* Copy out whatever the owner can't be overwriting.  Returns the
+ * number of records placed in out. */
+static uint32_t
+trace_ring_snapshot(struct trace_ring *tr, struct fchan_trace_rec *out)
+{
+    uint64_t h1, h2, ix, first;
+    uint32_t n = 0;
+
+    h1 = __atomic_load_n(&tr->head, __ATOMIC_ACQUIRE);
+    first = (h1 > FCHAN_TRACE_NRECS) ? h1 - FCHAN_TRACE_NRECS : 0;
+    for (ix = first; ix < h1; ++ix)
+        out[ix - first] = tr->recs[ix & (FCHAN_TRACE_NRECS - 1)];
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    h2 = __atomic_load_n(&tr->head, __ATOMIC_RELAXED);
+
+    /* slots at or below h2 - NRECS may have been rewritten under us */
+    for (ix = first; ix < h1; ++ix) {
+        if (ix + FCHAN_TRACE_NRECS <= h2)
+            continue;
+        out[n++] = out[ix - first];
+    }
+
+    return (n);
+}
+
+int
+fchan_trace_dump(const char *path)
+{
+    struct fchan_trace_hdr hdr;
+    struct fchan_trace_rec *buf;
+    struct trace_ring *tr;
+    struct timespec ts;
+    uint32_t n;
+    long pos;
+    FILE *fp;
+    int code = 0;
+
+    fp = fopen(path, "w");
+    if (! fp)
+        return (errno);
+
+    buf = malloc(FCHAN_TRACE_NRECS * sizeof(struct fchan_trace_rec));
+
+    memset(&hdr, 0, sizeof(struct fchan_trace_hdr));
+    hdr.magic = FCHAN_TRACE_MAGIC;
+    hdr.version = FCHAN_TRACE_VERSION;
+    hdr.recsize = sizeof(struct fchan_trace_rec);
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    hdr.mono_ns = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    hdr.real_ns = (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+
+    /* placeholder, rewritten once nrecs is known */
+    pos = ftell(fp);
+    fwrite(&hdr, sizeof(struct fchan_trace_hdr), 1, fp);
+
+    /* rings are never freed, so the list can be walked unlocked once
+     * the head is read */
+    pthread_mutex_lock(&trace_mtx);
+    tr = trace_rings;
+    hdr.nrings = trace_nrings;
+    pthread_mutex_unlock(&trace_mtx);
+
+    for (; tr; tr = tr->next) {
+        n = trace_ring_snapshot(tr, buf);
+        if (fwrite(buf, sizeof(struct fchan_trace_rec), n, fp) != n) {
+            code = errno;
+            break;
+        }
+        hdr.nrecs += n;
+    }
+
+    if (! code) {
+        fseek(fp, pos, SEEK_SET);
+        if (fwrite(&hdr, sizeof(struct fchan_trace_hdr), 1, fp) != 1)
+            code = errno;
+    }
+
+    free(buf);
+    if (fclose(fp) && ! code)
+        code = errno;
+
+    return (code);
+}
+
+const char *
+fchan_trace_event_name(uint16_t event)
+{
+    if (event >= FCHAN_TR_NEVENTS)
+        return ("?");
+    return (trace_event_names[event]);
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_TRACE_H
+#define FCHAN_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Per-thread binary request trace.  Each thread appends fixed-size
+ * records to its own ring, overwriting the oldest, so the hot path
+ * takes no locks and does no I/O.  fchan_trace_dump() copies the rings
+ * out to a file, which fchan_tracedump renders as text.
+ */
+
+#define FCHAN_TRACE_NRECS 4096 /* per thread, power of 2 */
+
+#define FCHAN_TRACE_MAGIC   0x46435452 /* "FCTR" */
+#define FCHAN_TRACE_VERSION 1
+
+enum fchan_trace_event {
+    FCHAN_TR_NONE = 0,
+    FCHAN_TR_SENDMSG1,
+    FCHAN_TR_BIND_CONN,
+    FCHAN_TR_READ,
+    FCHAN_TR_WRITE,
+    FCHAN_TR_CALLBACK1,     /* backchannel call made */
+    FCHAN_TR_CALLBACK1_SVC, /* backchannel call received */
+    FCHAN_TR_SEQUENCE,      /* fileno is the slot, len the inner proc */
+    FCHAN_TR_COMPOUND,      /* seqnum is the tag, len the ops run */
+    FCHAN_TR_READV,         /* off is the extent count */
+    FCHAN_TR_WRITEV,        /* off is the extent count */
+    FCHAN_TR_READ64,
+    FCHAN_TR_WRITE64,
+    FCHAN_TR_NEVENTS
+};
+
+/* status is 0, or an errno/clnt_stat describing the failure */
+struct fchan_trace_rec {
+    uint64_t ts;     /* CLOCK_MONOTONIC, ns */
+    uint64_t off;
+    uint32_t xid;
+    uint32_t seqnum;
+    uint32_t fileno;
+    uint32_t len;
+    uint16_t event;
+    uint16_t status;
+    uint32_t ring;   /* which thread */
+};
+
+/* dump file: this header, then nrecs records, native byte order */
+struct fchan_trace_hdr {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recsize;
+    uint32_t nrecs;
+    uint32_t nrings;
+    uint64_t mono_ns; /* the two clocks at dump time, so the decoder */
+    uint64_t real_ns; /* can print wall time */
+};
+
+extern bool fchan_trace_on;
+
+void fchan_trace_init(void);
+void fchan_trace_rec(uint16_t event, uint16_t status, uint32_t xid,
+                     uint32_t seqnum, uint32_t fileno, uint64_t off,
+                     uint32_t len);
+
+#define FCHAN_TRACE(ev, st, xid, seq, fileno, off, len) \
+    do { \
+        if (fchan_trace_on) \
+            fchan_trace_rec((ev), (st), (xid), (seq), (fileno), (off), \
+                            (len)); \
+    } while (0)
+
+/* returns 0 or errno */
+int fchan_trace_dump(const char *path);
+
+const char *fchan_trace_event_name(uint16_t event);
+
+#endif /* FCHAN_TRACE_H */
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ * Render a trace file written by fchan_trace_dump() as text, merged
+ * across threads in time order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "fchan_trace.h"
+
+static int
+rec_cmp(const void *a, const void *b)
+{
+    const struct fchan_trace_rec *ra = (const struct fchan_trace_rec *) a;
+    const struct fchan_trace_rec *rb = (const struct fchan_trace_rec *) b;
+
+    if (ra->ts < rb->ts)
+        return (-1);
+    return (ra->ts > rb->ts);
+}
+
+int
+main(int argc, char **argv)
+{
+    struct fchan_trace_hdr hdr;
+    struct fchan_trace_rec *recs, *rec;
+    uint64_t real_ns;
+    char tbuf[32];
+    struct tm tm;
+    time_t secs;
+    uint32_t ix;
+    FILE *fp;
+
+    if (argc < 2) {
+        printf("usage: %s trace_file\n", argv[0]);
+        return (EXIT_FAILURE);
+    }
+
+    fp = fopen(argv[1], "r");
+    if (! fp) {
+        perror(argv[1]);
+        return (EXIT_FAILURE);
+    }
+
+    if ((fread(&hdr, sizeof(struct fchan_trace_hdr), 1, fp) != 1) ||
+        (hdr.magic != FCHAN_TRACE_MAGIC) ||
+        (hdr.version != FCHAN_TRACE_VERSION) ||
+        (hdr.recsize != sizeof(struct fchan_trace_rec))) {
+        fprintf(stderr, "%s: not a version %d trace file\n", argv[1],
+                FCHAN_TRACE_VERSION);
+        return (EXIT_FAILURE);
+    }
+
+    recs = malloc((hdr.nrecs ? hdr.nrecs : 1) *
+                  sizeof(struct fchan_trace_rec));
+    if (fread(recs, sizeof(struct fchan_trace_rec), hdr.nrecs, fp)
+        != hdr.nrecs) {
+        fprintf(stderr, "%s: truncated\n", argv[1]);
+        return (EXIT_FAILURE);
+    }
+    fclose(fp);
+
+    qsort(recs, hdr.nrecs, sizeof(struct fchan_trace_rec), rec_cmp);
+
+    printf("# %u records from %u threads\n", hdr.nrecs, hdr.nrings);
+    for (ix = 0; ix < hdr.nrecs; ++ix) {
+        rec = &recs[ix];
+        real_ns = hdr.real_ns - (hdr.mono_ns - rec->ts);
+        secs = real_ns / 1000000000ULL;
+        localtime_r(&secs, &tm);
+        strftime(tbuf, sizeof(tbuf), "%H:%M:%S", &tm);
+        printf("%s.%06llu t%-3u %-13s xid %#010x seq %-6u fileno %-4u "
+               "off %-10llu len %-8u status %u\n",
+               tbuf, (unsigned long long) (real_ns % 1000000000ULL) / 1000,
+               rec->ring, fchan_trace_event_name(rec->event), rec->xid,
+               rec->seqnum, rec->fileno, (unsigned long long) rec->off,
+               rec->len, rec->status);
+    }
+
+    free(recs);
+    return (EXIT_SUCCESS);
+}
@@ -0,0 +1,397 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define _GNU_SOURCE /* recvmmsg, sendmmsg */
+
+#include <pthread.h>
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include <rpc/rpc.h>
+
+#include "fchan_udp.h"
+
+struct udp_thread {
+    int sock;
+    pthread_t tid;
+    bool started;
+    SVCXPRT xprt; /* what handlers see as rq_xprt */
+    struct mmsghdr in[FCHAN_UDP_BATCH], out[FCHAN_UDP_BATCH];
+    struct iovec iin[FCHAN_UDP_BATCH], iout[FCHAN_UDP_BATCH];
+    struct sockaddr_storage addr[FCHAN_UDP_BATCH];
+    char *ibuf, *obuf; /* FCHAN_UDP_BATCH datagrams each */
+};
+
+static struct {
+    struct udp_thread *threads;
+    uint32_t nthreads;
+    fchan_udp_dispatch_fn dispatch;
+    int efd[2]; /* wakes the threads for shutdown */
+    bool running;
+    struct fchan_udp_stats st;
+} udp;
+
+/* Frame one call and encode its reply into out.  Returns the reply
+ * length, or 0 if there's nothing to send back. */
+static u_int
+udp_call(struct udp_thread *ut, char *in, u_int inlen, char *out)
+{
+    char cred_area[2 * MAX_AUTH_BYTES];
+    struct rpc_msg msg, rply;
+    struct svc_req req;
+    struct fchan_udp_call uc;
+    XDR xin[1], xout[1];
+    u_int len = 0;
+
+    memset(&msg, 0, sizeof(struct rpc_msg));
+    msg.rm_call.cb_cred.oa_base = cred_area;
+    msg.rm_call.cb_verf.oa_base = cred_area + MAX_AUTH_BYTES;
+
+    xdrmem_create(xin, in, inlen, XDR_DECODE);
+    if (! xdr_callmsg(xin, &msg) || (msg.rm_direction != CALL)
+        || (msg.rm_call.cb_rpcvers != RPC_MSG_VERSION))
+        goto out;
+
+    /* there's no ntirpc xprt to authenticate against: the credential
+     * is taken as sent, as AUTH_SYS would be, and others are dropped */
+    if ((msg.rm_call.cb_cred.oa_flavor != AUTH_NONE)
+        && (msg.rm_call.cb_cred.oa_flavor != AUTH_SYS))
+        goto out;
+
+    memset(&req, 0, sizeof(struct svc_req));
+    req.rq_xprt = &ut->xprt;
+    req.rq_prog = msg.rm_call.cb_prog;
+    req.rq_vers = msg.rm_call.cb_vers;
+    req.rq_proc = msg.rm_call.cb_proc;
+    req.rq_cred = msg.rm_call.cb_cred;
+    req.rq_msg = &msg;
+    req.rq_xid = msg.rm_xid;
+
+    memset(&uc, 0, sizeof(struct fchan_udp_call));
+    uc.req = &req;
+    uc.xdrs = xin;
+    uc.xdr_result = (xdrproc_t) xdr_void;
+
+    if (req.rq_prog != FCHAN_PROG)
+        uc.stat = PROG_UNAVAIL;
+    else if (req.rq_vers != FCHANV)
+        uc.stat = PROG_MISMATCH;
+    else if (req.rq_proc == NULLPROC)
+        uc.stat = SUCCESS;
+    else
+        udp.dispatch(&uc);
+
+    memset(&rply, 0, sizeof(struct rpc_msg));
+    rply.rm_xid = msg.rm_xid;
+    rply.rm_direction = REPLY;
+    rply.rm_reply.rp_stat = MSG_ACCEPTED;
+    rply.acpted_rply.ar_verf = _null_auth;
+    rply.acpted_rply.ar_stat = uc.stat;
+    if (uc.stat == PROG_MISMATCH) {
+        rply.acpted_rply.ar_vers.low = FCHANV;
+        rply.acpted_rply.ar_vers.high = FCHANV;
+    } else {
+        rply.acpted_rply.ar_results.where = (caddr_t) &uc.result;
+        rply.acpted_rply.ar_results.proc = (uc.stat == SUCCESS)
+            ? uc.xdr_result : (xdrproc_t) xdr_void;
+    }
+
+    xdrmem_create(xout, out, FCHAN_UDP_MSGSIZE, XDR_ENCODE);
+    if (xdr_replymsg(xout, &rply))
+        len = XDR_GETPOS(xout);
+    else {
+        /* the result didn't fit a datagram */
+        XDR_DESTROY(xout);
+        xdrmem_create(xout, out, FCHAN_UDP_MSGSIZE, XDR_ENCODE);
+        rply.acpted_rply.ar_stat = SYSTEM_ERR;
+        rply.acpted_rply.ar_results.proc = (xdrproc_t) xdr_void;
+        if (xdr_replymsg(xout, &rply))
+            len = XDR_GETPOS(xout);
+    }
+    XDR_DESTROY(xout);
+
+    xdr_free(uc.xdr_result, (caddr_t) &uc.result);
+
+out:
+    XDR_DESTROY(xin);
+    return (len);
+}
+
+static int
+udp_wait_writable(int fd)
+{
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+
+    return (poll(&pfd, 1, -1 /* ms */));
+}
+
+/* returns the number of replies not sent */
+static int
+udp_send(struct udp_thread *ut, int nout)
+{
+    int n, sent = 0, failed = 0;
+
+    while (sent < nout) {
+        n = sendmmsg(ut->sock, ut->out + sent, nout - sent, 0);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                udp_wait_writable(ut->sock);
+                continue;
+            }
+            /* skip the one that failed, e.g. an unreachable peer */
+            ++sent;
+            ++failed;
+            continue;
+        }
+        sent += n;
+    }
+
+    return (failed);
+}
+
+static void *
+udp_thread(void *arg)
+{
+    struct udp_thread *ut = (struct udp_thread *) arg;
+    struct fchan_udp_stats st;
+    struct pollfd pfd[2];
+    int n, nout, nfail, ix;
+    u_int len;
+
+    pfd[0].fd = ut->sock;
+    pfd[0].events = POLLIN;
+    pfd[1].fd = udp.efd[0];
+    pfd[1].events = POLLIN;
+
+    while (udp.running) {
+        if (poll(pfd, 2, -1 /* ms */) < 0)
+            continue;
+        if (pfd[1].revents)
+            break;
+
+        /* keep going while batches come back full */
+        do {
+            for (ix = 0; ix < FCHAN_UDP_BATCH; ++ix)
+                ut->in[ix].msg_hdr.msg_namelen =
+                    sizeof(struct sockaddr_storage);
+
+            n = recvmmsg(ut->sock, ut->in, FCHAN_UDP_BATCH, MSG_DONTWAIT,
+                         NULL);
+            if (n <= 0)
+                break;
+
+            memset(&st, 0, sizeof(struct fchan_udp_stats));
+            st.batches = 1;
+            st.datagrams = n;
+
+            for (nout = 0, ix = 0; ix < n; ++ix) {
+                len = 0;
+                if (! (ut->in[ix].msg_hdr.msg_flags & MSG_TRUNC))
+                    len = udp_call(ut, ut->iin[ix].iov_base,
+                                   ut->in[ix].msg_len,
+                                   ut->iout[nout].iov_base);
+                if (! len) {
+                    ++(st.drops);
+                    continue;
+                }
+                ut->iout[nout].iov_len = len;
+                ut->out[nout].msg_hdr.msg_name = &ut->addr[ix];
+                ut->out[nout].msg_hdr.msg_namelen =
+                    ut->in[ix].msg_hdr.msg_namelen;
+                ++nout;
+            }
+
+            if (nout) {
+                nfail = udp_send(ut, nout);
+                st.drops += nfail;
+                st.replies += nout - nfail;
+            }
+
+            __sync_fetch_and_add(&udp.st.batches, st.batches);
+            __sync_fetch_and_add(&udp.st.datagrams, st.datagrams);
+            __sync_fetch_and_add(&udp.st.replies, st.replies);
+            __sync_fetch_and_add(&udp.st.drops, st.drops);
+        } while (n == FCHAN_UDP_BATCH);
+    }
+
+    return (NULL);
+}
+
+static int
+udp_thread_setup(struct udp_thread *ut, uint16_t port)
+{
+    struct sockaddr_in sin;
+    int one = 1, ix;
+
+    ut->sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (ut->sock < 0)
+        return (errno);
+
+    /* every thread binds the same port; the kernel hashes flows */
+    if (setsockopt(ut->sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one))
+        || setsockopt(ut->sock, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)))
+        return (errno);
+
+    memset(&sin, 0, sizeof(struct sockaddr_in));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = INADDR_ANY;
+    if (bind(ut->sock, (struct sockaddr *) &sin, sizeof(sin)) < 0)
+        return (errno);
+
+    ut->ibuf = malloc(FCHAN_UDP_BATCH * FCHAN_UDP_MSGSIZE);
+    ut->obuf = malloc(FCHAN_UDP_BATCH * FCHAN_UDP_MSGSIZE);
+    if (! ut->ibuf || ! ut->obuf)
+        return (ENOMEM);
+
+    for (ix = 0; ix < FCHAN_UDP_BATCH; ++ix) {
+        ut->iin[ix].iov_base = ut->ibuf + (ix * FCHAN_UDP_MSGSIZE);
+        ut->iin[ix].iov_len = FCHAN_UDP_MSGSIZE;
+        ut->in[ix].msg_hdr.msg_name = &ut->addr[ix];
+        ut->in[ix].msg_hdr.msg_iov = &ut->iin[ix];
+        ut->in[ix].msg_hdr.msg_iovlen = 1;
+        ut->iout[ix].iov_base = ut->obuf + (ix * FCHAN_UDP_MSGSIZE);
+        ut->out[ix].msg_hdr.msg_iov = &ut->iout[ix];
+        ut->out[ix].msg_hdr.msg_iovlen = 1;
+    }
+
+    ut->xprt.xp_fd = ut->sock;
+    ut->xprt.xp_u1 = NULL;
+
+    return (0);
+}
+
+static void
+udp_teardown(void)
+{
+    struct udp_thread *ut;
+    uint32_t ix;
+
+    for (ix = 0; ix < udp.nthreads; ++ix) {
+        ut = &udp.threads[ix];
+        if (ut->started)
+            pthread_join(ut->tid, NULL);
+        if (ut->sock >= 0)
+            close(ut->sock);
+        free(ut->ibuf);
+        free(ut->obuf);
+    }
+    free(udp.threads);
+    udp.threads = NULL;
+    udp.nthreads = 0;
+
+    close(udp.efd[0]);
+    close(udp.efd[1]);
+}
+
+int
+fchan_udp_start(uint16_t port, uint32_t nthreads,
+                fchan_udp_dispatch_fn dispatch)
+{
+    uint32_t ix;
+    int code;
+    char c = 0;
+
+    if (! nthreads)
+        return (EINVAL);
+
+    if (pipe(udp.efd) < 0)
+        return (errno);
+
+    udp.threads = calloc(nthreads, sizeof(struct udp_thread));
+    if (! udp.threads) {
+        close(udp.efd[0]);
+        close(udp.efd[1]);
+        return (ENOMEM);
+    }
+    udp.nthreads = nthreads;
+    udp.dispatch = dispatch;
+    for (ix = 0; ix < nthreads; ++ix)
+        udp.threads[ix].sock = -1;
+
+    for (ix = 0; ix < nthreads; ++ix) {
+        code = udp_thread_setup(&udp.threads[ix], port);
+        if (code)
+            goto err;
+    }
+
+    udp.running = true;
+    for (ix = 0; ix < nthreads; ++ix) {
+        code = pthread_create(&udp.threads[ix].tid, NULL, udp_thread,
+                              &udp.threads[ix]);
+        if (code)
+            goto err;
+        udp.threads[ix].started = true;
+    }
+
+    return (0);
+
+err:
+    udp.running = false;
+    (void) write(udp.efd[1], &c, 1);
+    udp_teardown();
+    return (code);
+}
+
+void
+fchan_udp_shutdown(void)
+{
+    char c = 0;
+
+    if (! udp.running)
+        return;
+
+    /* the pipe stays readable, so one byte wakes every thread */
+    udp.running = false;
+    (void) write(udp.efd[1], &c, 1);
+    udp_teardown();
+}
+
+bool
+fchan_udp_enabled(void)
+{
+    return (udp.running);
+}
+
+void
+fchan_udp_stats(struct fchan_udp_stats *st)
+{
+    st->datagrams = udp.st.datagrams;
+    st->batches = udp.st.batches;
+    st->replies = udp.st.replies;
+    st->drops = udp.st.drops;
+}
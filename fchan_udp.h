@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_UDP_H
+#define FCHAN_UDP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "fchan.h"
+
+/*
+ * Multi-threaded UDP service for SENDMSG1 and small READs.  Every
+ * thread has its own SO_REUSEPORT socket on the port, so the kernel
+ * spreads datagrams over them, and moves up to FCHAN_UDP_BATCH
+ * datagrams per recvmmsg/sendmmsg.  Calls are framed here without an
+ * ntirpc xprt; the server decodes the arguments and runs them.
+ */
+
+#define FCHAN_UDP_BATCH 32
+#define FCHAN_UDP_MSGSIZE 9216 /* per datagram, either way */
+#define FCHAN_UDP_MAXTHREADS 256 /* -u */
+
+/* READ len is clamped so its reply fits a datagram */
+#define FCHAN_UDP_MAXREAD 8192
+
+struct fchan_udp_call {
+    struct svc_req *req; /* rq_xprt is a placeholder, xp_u1 NULL */
+    XDR *xdrs;           /* positioned at the arguments */
+    enum accept_stat stat;
+    xdrproc_t xdr_result; /* encoded if stat is SUCCESS, then freed */
+    union {
+        fchan_res sendmsg1_1_res;
+        read_res read_1_res;
+    } result;
+};
+
+/* decodes the arguments from uc->xdrs, runs the call and sets stat,
+ * xdr_result and result; NULLPROC is answered before it gets here */
+typedef void (*fchan_udp_dispatch_fn)(struct fchan_udp_call *uc);
+
+struct fchan_udp_stats {
+    uint64_t datagrams; /* calls received */
+    uint64_t batches;   /* recvmmsg calls that returned any */
+    uint64_t replies;
+    uint64_t drops;     /* undecodable, or a reply we couldn't send */
+};
+
+/* binds nthreads sockets to port and starts their threads; returns
+ * errno */
+int fchan_udp_start(uint16_t port, uint32_t nthreads,
+                    fchan_udp_dispatch_fn dispatch);
+void fchan_udp_shutdown(void);
+bool fchan_udp_enabled(void);
+
+void fchan_udp_stats(struct fchan_udp_stats *st);
+
+#endif /* FCHAN_UDP_H */
@@ -0,0 +1,208 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "fchan_wq.h"
+
+struct wq_cell {
+    volatile uint32_t seq;
+    fchan_wq_fn fn;
+    void *arg;
+};
+
+struct fchan_wq {
+    struct wq_cell *ring;
+    uint32_t mask;
+    /* keep producers and consumers off each other's cache lines */
+    volatile uint32_t head __attribute__((aligned(64)));
+    volatile uint32_t tail __attribute__((aligned(64)));
+    volatile uint32_t sleepers __attribute__((aligned(64)));
+    volatile bool shutdown;
+    pthread_mutex_t mtx;
+    pthread_cond_t cv;
+    uint32_t nthreads;
+    pthread_t *tids;
+};
+
+static bool
+wq_dequeue(struct fchan_wq *wq, fchan_wq_fn *fn, void **arg)
+{
+    struct wq_cell *cell;
+    uint32_t pos, seq;
+    int32_t dif;
+
+    pos = wq->tail;
+    for (;;) {
+        cell = &wq->ring[pos & wq->mask];
+        seq = cell->seq;
+        __sync_synchronize();
+        dif = (int32_t) seq - (int32_t) (pos + 1);
+        if (dif == 0) {
+            if (__sync_bool_compare_and_swap(&wq->tail, pos, pos + 1))
+                break;
+        } else if (dif < 0)
+            return (false); /* empty */
+        pos = wq->tail;
+    }
+
+    *fn = cell->fn;
+    *arg = cell->arg;
+    __sync_synchronize();
+    cell->seq = pos + wq->mask + 1;
+
+    return (true);
+}
+
+bool
+fchan_wq_submit(struct fchan_wq *wq, fchan_wq_fn fn, void *arg)
+{
+    struct wq_cell *cell;
+    uint32_t pos, seq;
+    int32_t dif;
+
+    pos = wq->head;
+    for (;;) {
+        cell = &wq->ring[pos & wq->mask];
+        seq = cell->seq;
+        __sync_synchronize();
+        dif = (int32_t) seq - (int32_t) pos;
+        if (dif == 0) {
+            if (__sync_bool_compare_and_swap(&wq->head, pos, pos + 1))
+                break;
+        } else if (dif < 0)
+            return (false); /* full */
+        pos = wq->head;
+    }
+
+    cell->fn = fn;
+    cell->arg = arg;
+    __sync_synchronize();
+    cell->seq = pos + 1;
+
+    /* pairs with the sleepers increment in wq_thread */
+    __sync_synchronize();
+    if (wq->sleepers) {
+        pthread_mutex_lock(&wq->mtx);
+        pthread_cond_signal(&wq->cv);
+        pthread_mutex_unlock(&wq->mtx);
+    }
+
+    return (true);
+}
+
+static void *
+wq_thread(void *arg)
+{
+    struct fchan_wq *wq = (struct fchan_wq *) arg;
+    fchan_wq_fn fn;
+    void *fn_arg;
+
+    for (;;) {
+        if (wq_dequeue(wq, &fn, &fn_arg)) {
+            fn(fn_arg);
+            continue;
+        }
+
+        pthread_mutex_lock(&wq->mtx);
+        __sync_fetch_and_add(&wq->sleepers, 1);
+        if (wq_dequeue(wq, &fn, &fn_arg)) {
+            __sync_fetch_and_sub(&wq->sleepers, 1);
+            pthread_mutex_unlock(&wq->mtx);
+            fn(fn_arg);
+            continue;
+        }
+        if (wq->shutdown) {
+            __sync_fetch_and_sub(&wq->sleepers, 1);
+            pthread_mutex_unlock(&wq->mtx);
+            break;
+        }
+        pthread_cond_wait(&wq->cv, &wq->mtx);
+        __sync_fetch_and_sub(&wq->sleepers, 1);
+        pthread_mutex_unlock(&wq->mtx);
+    }
+
+    return (NULL);
+}
+
+struct fchan_wq *
+fchan_wq_create(uint32_t nthreads, uint32_t depth)
+{
+    struct fchan_wq *wq;
+    uint32_t ix, size = 2;
+
+    while (size < depth)
+        size <<= 1;
+
+    wq = calloc(1, sizeof(struct fchan_wq));
+    if (! wq)
+        return (NULL);
+    wq->ring = calloc(size, sizeof(struct wq_cell));
+    wq->tids = calloc(nthreads, sizeof(pthread_t));
+    if (! wq->ring || ! wq->tids) {
+        free(wq->ring);
+        free(wq->tids);
+        free(wq);
+        return (NULL);
+    }
+    wq->mask = size - 1;
+    for (ix = 0; ix < size; ++ix)
+        wq->ring[ix].seq = ix;
+
+    pthread_mutex_init(&wq->mtx, NULL);
+    pthread_cond_init(&wq->cv, NULL);
+
+    /* nthreads counts the workers running, for fchan_wq_destroy */
+    for (ix = 0; ix < nthreads; ++ix) {
+        if (pthread_create(&wq->tids[ix], NULL, &wq_thread, (void *) wq)) {
+            fchan_wq_destroy(wq);
+            return (NULL);
+        }
+        ++(wq->nthreads);
+    }
+
+    return (wq);
+}
+
+void
+fchan_wq_destroy(struct fchan_wq *wq)
+{
+    uint32_t ix;
+
+    pthread_mutex_lock(&wq->mtx);
+    wq->shutdown = true;
+    pthread_cond_broadcast(&wq->cv);
+    pthread_mutex_unlock(&wq->mtx);
+
+    for (ix = 0; ix < wq->nthreads; ++ix)
+        pthread_join(wq->tids[ix], NULL);
+
+    pthread_mutex_destroy(&wq->mtx);
+    pthread_cond_destroy(&wq->cv);
+    free(wq->tids);
+    free(wq->ring);
+    free(wq);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FCHAN_WQ_H
+#define FCHAN_WQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * Bounded work queue feeding a fixed pool of worker threads.  Submit
+ * and dequeue are lock-free (a sequenced ring, after Vyukov); the
+ * mutex is only used to park idle workers.
+ */
+
+#define FCHAN_WQ_MAXTHREADS 1024
+
+typedef void (*fchan_wq_fn)(void *arg);
+
+struct fchan_wq;
+
+/* depth is rounded up to a power of 2; NULL without memory or threads */
+struct fchan_wq *fchan_wq_create(uint32_t nthreads, uint32_t depth);
+
+/* returns false if the queue is full; the caller should run fn itself */
+bool fchan_wq_submit(struct fchan_wq *wq, fchan_wq_fn fn, void *arg);
+
+/* runs everything already queued, then joins the workers */
+void fchan_wq_destroy(struct fchan_wq *wq);
+
+#endif /* FCHAN_WQ_H */
@@ -1,350 +1,426 @@
 /*
  * Please do not edit this file.
- * It was generated using rpcgen.
+ * It was generated using rpcgen; the codecs for fixed-layout structs
+ * were then specialized by hand (fchan_xdr_fixed.h).
  */
 
 #include "fchan.h"
+#include "fchan_arena.h"
+#include "fchan_xdr_fixed.h"
 
 #include <rpc/xdr_inline.h>
 
 bool_t
 xdr_fchan_msg (XDR *xdrs, fchan_msg *objp)
 {
-        register int32_t *buf;
-
-        if (!inline_xdr_u_int(xdrs, &objp->seqnum))
-            return FALSE;
-        if (!inline_xdr_string(xdrs, &objp->msg1, 1024))
-            return FALSE;
-        if (!inline_xdr_string(xdrs, &objp->msg2, 1024))
-            return FALSE;
+	static const u_int maxsize[2] = { 1024, 1024 };
+	char *strs[2];
+
+	if (xdrs->x_op == XDR_ENCODE) {
+		strs[0] = objp->msg1;
+		strs[1] = objp->msg2;
+		if (fchan_xdr_put_strings (xdrs, objp->seqnum, strs, maxsize, 2))
+			return TRUE;
+	}
+	 if (!inline_xdr_u_int (xdrs, &objp->seqnum))
+		 return FALSE;
+	 if (!fchan_xdr_string (xdrs, &objp->msg1, 1024))
+		 return FALSE;
+	 if (!fchan_xdr_string (xdrs, &objp->msg2, 1024))
+		 return FALSE;
 	return TRUE;
 }
 
 bool_t
 xdr_fchan_res (XDR *xdrs, fchan_res *objp)
 {
-	register int32_t *buf;
+	static const u_int maxsize[1] = { 512 };
 
+	if (xdrs->x_op == XDR_ENCODE
+	    && fchan_xdr_put_strings (xdrs, objp->result, &objp->msg1, maxsize, 1))
+		return TRUE;
 	 if (!inline_xdr_u_int (xdrs, &objp->result))
 		 return FALSE;
-	 if (!inline_xdr_string (xdrs, &objp->msg1, 512))
+	 if (!fchan_xdr_string (xdrs, &objp->msg1, 512))
 		 return FALSE;
 	return TRUE;
 }
 
+FCHAN_XDR_WORDS_FIT(read_args, seqnum, flags4, 8);
+
 bool_t
 xdr_read_args (XDR *xdrs, read_args *objp)
 {
-	register int32_t *buf;
+	return fchan_xdr_words (xdrs, &objp->seqnum, 8);
+}
 
+FCHAN_XDR_WORDS_FIT(read_res, eof, flags4, 5);
 
-	if (xdrs->x_op == XDR_ENCODE) {
-		buf = XDR_INLINE (xdrs, 8 * BYTES_PER_XDR_UNIT);
-		if (buf == NULL) {
-			 if (!inline_xdr_u_int (xdrs, &objp->seqnum))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->fileno))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->off))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->len))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags2))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags3))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags4))
-				 return FALSE;
-		} else {
-			IXDR_PUT_U_LONG(buf, objp->seqnum);
-			IXDR_PUT_U_LONG(buf, objp->fileno);
-			IXDR_PUT_U_LONG(buf, objp->off);
-			IXDR_PUT_U_LONG(buf, objp->len);
-			IXDR_PUT_U_LONG(buf, objp->flags);
-			IXDR_PUT_U_LONG(buf, objp->flags2);
-			IXDR_PUT_U_LONG(buf, objp->flags3);
-			IXDR_PUT_U_LONG(buf, objp->flags4);
-		}
-		return TRUE;
-	} else if (xdrs->x_op == XDR_DECODE) {
-		buf = XDR_INLINE (xdrs, 8 * BYTES_PER_XDR_UNIT);
-		if (buf == NULL) {
-			 if (!inline_xdr_u_int (xdrs, &objp->seqnum))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->fileno))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->off))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->len))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags2))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags3))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags4))
-				 return FALSE;
-		} else {
-			objp->seqnum = IXDR_GET_U_LONG(buf);
-			objp->fileno = IXDR_GET_U_LONG(buf);
-			objp->off = IXDR_GET_U_LONG(buf);
-			objp->len = IXDR_GET_U_LONG(buf);
-			objp->flags = IXDR_GET_U_LONG(buf);
-			objp->flags2 = IXDR_GET_U_LONG(buf);
-			objp->flags3 = IXDR_GET_U_LONG(buf);
-			objp->flags4 = IXDR_GET_U_LONG(buf);
-		}
-	 return TRUE;
-	}
+bool_t
+xdr_read_res (XDR *xdrs, read_res *objp)
+{
+	 if (!fchan_xdr_words (xdrs, &objp->eof, 5))
+		 return FALSE;
+	 if (!fchan_xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, ~0))
+		 return FALSE;
+	return TRUE;
+}
 
-	 if (!inline_xdr_u_int (xdrs, &objp->seqnum))
+FCHAN_XDR_WORDS_FIT(write_args, seqnum, flags4, 8);
+
+bool_t
+xdr_write_args (XDR *xdrs, write_args *objp)
+{
+	 if (!fchan_xdr_words (xdrs, &objp->seqnum, 8))
+		 return FALSE;
+	 if (!fchan_xdr_payload (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, ~0))
+		 return FALSE;
+	return TRUE;
+}
+
+FCHAN_XDR_WORDS_FIT(write_res, eof, flags4, 5);
+
+bool_t
+xdr_write_res (XDR *xdrs, write_res *objp)
+{
+	return fchan_xdr_words (xdrs, &objp->eof, 5);
+}
+
+FCHAN_XDR_WORDS_FIT(read64_args, seqnum, fileno, 2);
+FCHAN_XDR_WORDS_FIT(read64_args, flags, flags4, 4);
+
+bool_t
+xdr_read64_args (XDR *xdrs, read64_args *objp)
+{
+	 if (!fchan_xdr_words (xdrs, &objp->seqnum, 2))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->fileno))
+	 if (!xdr_u_quad_t (xdrs, &objp->off))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->off))
+	 if (!xdr_u_quad_t (xdrs, &objp->len))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->len))
+	 if (!fchan_xdr_words (xdrs, &objp->flags, 4))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags))
+	return TRUE;
+}
+
+FCHAN_XDR_WORDS_FIT(write64_args, seqnum, fileno, 2);
+FCHAN_XDR_WORDS_FIT(write64_args, flags, flags4, 4);
+
+bool_t
+xdr_write64_args (XDR *xdrs, write64_args *objp)
+{
+	 if (!fchan_xdr_words (xdrs, &objp->seqnum, 2))
+		 return FALSE;
+	 if (!xdr_u_quad_t (xdrs, &objp->off))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags2))
+	 if (!xdr_u_quad_t (xdrs, &objp->len))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags3))
+	 if (!fchan_xdr_words (xdrs, &objp->flags, 4))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags4))
+	 if (!fchan_xdr_payload (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, ~0))
 		 return FALSE;
 	return TRUE;
 }
 
 bool_t
-xdr_read_res (XDR *xdrs, read_res *objp)
+xdr_fchan_proc_stats (XDR *xdrs, fchan_proc_stats *objp)
 {
 	register int32_t *buf;
 
+	 if (!inline_xdr_u_int (xdrs, &objp->prog))
+		 return FALSE;
+	 if (!inline_xdr_u_int (xdrs, &objp->proc))
+		 return FALSE;
+	 if (!xdr_u_quad_t (xdrs, &objp->calls))
+		 return FALSE;
+	 if (!xdr_u_quad_t (xdrs, &objp->errors))
+		 return FALSE;
+	 if (!fchan_xdr_array (xdrs, (char **)&objp->hist.hist_val, (u_int *) &objp->hist.hist_len, FCHAN_STATS_NBUCKETS,
+		sizeof (u_quad_t), (xdrproc_t) xdr_u_quad_t))
+		 return FALSE;
+	return TRUE;
+}
 
-	if (xdrs->x_op == XDR_ENCODE) {
-		buf = XDR_INLINE (xdrs, 5 * BYTES_PER_XDR_UNIT);
-		if (buf == NULL) {
-			 if (!inline_xdr_u_int (xdrs, &objp->eof))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags2))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags3))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags4))
-				 return FALSE;
-
-		} else {
-		IXDR_PUT_U_LONG(buf, objp->eof);
-		IXDR_PUT_U_LONG(buf, objp->flags);
-		IXDR_PUT_U_LONG(buf, objp->flags2);
-		IXDR_PUT_U_LONG(buf, objp->flags3);
-		IXDR_PUT_U_LONG(buf, objp->flags4);
-		}
-		 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, ~0))
-			 return FALSE;
-		return TRUE;
-	} else if (xdrs->x_op == XDR_DECODE) {
-		buf = XDR_INLINE (xdrs, 5 * BYTES_PER_XDR_UNIT);
-		if (buf == NULL) {
-			 if (!inline_xdr_u_int (xdrs, &objp->eof))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags2))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags3))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags4))
-				 return FALSE;
-
-		} else {
-		objp->eof = IXDR_GET_U_LONG(buf);
-		objp->flags = IXDR_GET_U_LONG(buf);
-		objp->flags2 = IXDR_GET_U_LONG(buf);
-		objp->flags3 = IXDR_GET_U_LONG(buf);
-		objp->flags4 = IXDR_GET_U_LONG(buf);
-		}
-		 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, ~0))
-			 return FALSE;
-	 return TRUE;
-	}
+bool_t
+xdr_fchan_counter (XDR *xdrs, fchan_counter *objp)
+{
+	register int32_t *buf;
 
-	 if (!inline_xdr_u_int (xdrs, &objp->eof))
+	 if (!fchan_xdr_string (xdrs, &objp->name, 64))
 		 return FALSE;
+	 if (!xdr_u_quad_t (xdrs, &objp->value))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_stats_res (XDR *xdrs, stats_res *objp)
+{
+	register int32_t *buf;
+
 	 if (!inline_xdr_u_int (xdrs, &objp->flags))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags2))
+	 if (!fchan_xdr_array (xdrs, (char **)&objp->procs.procs_val, (u_int *) &objp->procs.procs_len, ~0,
+		sizeof (fchan_proc_stats), (xdrproc_t) xdr_fchan_proc_stats))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags3))
+	 if (!fchan_xdr_array (xdrs, (char **)&objp->counters.counters_val, (u_int *) &objp->counters.counters_len, ~0,
+		sizeof (fchan_counter), (xdrproc_t) xdr_fchan_counter))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags4))
+	return TRUE;
+}
+
+FCHAN_XDR_WORDS_FIT(create_session_args, nslots, flags, 3);
+
+bool_t
+xdr_create_session_args (XDR *xdrs, create_session_args *objp)
+{
+	return fchan_xdr_words (xdrs, &objp->nslots, 3);
+}
+
+bool_t
+xdr_create_session_res (XDR *xdrs, create_session_res *objp)
+{
+	register int32_t *buf;
+
+	 if (!inline_xdr_u_int (xdrs, &objp->status))
 		 return FALSE;
-	 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, ~0))
+	 if (!xdr_u_quad_t (xdrs, &objp->sessionid))
+		 return FALSE;
+	 if (!inline_xdr_u_int (xdrs, &objp->nslots))
+		 return FALSE;
+	 if (!inline_xdr_u_int (xdrs, &objp->maxcache))
 		 return FALSE;
 	return TRUE;
 }
 
 bool_t
-xdr_write_args (XDR *xdrs, write_args *objp)
+xdr_bind_conn_args (XDR *xdrs, bind_conn_args *objp)
 {
 	register int32_t *buf;
 
+	 if (!xdr_u_quad_t (xdrs, &objp->sessionid))
+		 return FALSE;
+	 if (!inline_xdr_u_int (xdrs, &objp->flags))
+		 return FALSE;
+	return TRUE;
+}
 
-	if (xdrs->x_op == XDR_ENCODE) {
-		buf = XDR_INLINE (xdrs, 8 * BYTES_PER_XDR_UNIT);
-		if (buf == NULL) {
-			 if (!inline_xdr_u_int (xdrs, &objp->seqnum))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->fileno))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->off))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->len))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags2))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags3))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags4))
-				 return FALSE;
-
-		} else {
-		IXDR_PUT_U_LONG(buf, objp->seqnum);
-		IXDR_PUT_U_LONG(buf, objp->fileno);
-		IXDR_PUT_U_LONG(buf, objp->off);
-		IXDR_PUT_U_LONG(buf, objp->len);
-		IXDR_PUT_U_LONG(buf, objp->flags);
-		IXDR_PUT_U_LONG(buf, objp->flags2);
-		IXDR_PUT_U_LONG(buf, objp->flags3);
-		IXDR_PUT_U_LONG(buf, objp->flags4);
-		}
-		 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, ~0))
+bool_t
+xdr_sequence_args (XDR *xdrs, sequence_args *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_u_quad_t (xdrs, &objp->sessionid))
+		 return FALSE;
+	 if (!inline_xdr_u_int (xdrs, &objp->slotid))
+		 return FALSE;
+	 if (!inline_xdr_u_int (xdrs, &objp->seqid))
+		 return FALSE;
+	 if (!inline_xdr_u_int (xdrs, &objp->cachethis))
+		 return FALSE;
+	 if (!inline_xdr_u_int (xdrs, &objp->proc))
+		 return FALSE;
+	 if (!fchan_xdr_bytes (xdrs, (char **)&objp->args.args_val, (u_int *) &objp->args.args_len, ~0))
+		 return FALSE;
+	return TRUE;
+}
+
+FCHAN_XDR_WORDS_FIT(sequence_res, status, highest_slotid, 4);
+
+bool_t
+xdr_sequence_res (XDR *xdrs, sequence_res *objp)
+{
+	 if (!fchan_xdr_words (xdrs, &objp->status, 4))
+		 return FALSE;
+	 if (!fchan_xdr_bytes (xdrs, (char **)&objp->res.res_val, (u_int *) &objp->res.res_len, ~0))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_fchan_opnum (XDR *xdrs, fchan_opnum *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_enum (xdrs, (enum_t *) objp))
+		 return FALSE;
+	return TRUE;
+}
+
+bool_t
+xdr_fchan_op_args (XDR *xdrs, fchan_op_args *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_fchan_opnum (xdrs, &objp->op))
+		 return FALSE;
+	switch (objp->op) {
+	case OP_SENDMSG:
+		 if (!xdr_fchan_msg (xdrs, &objp->fchan_op_args_u.sendmsg))
 			 return FALSE;
-		return TRUE;
-	} else if (xdrs->x_op == XDR_DECODE) {
-		buf = XDR_INLINE (xdrs, 8 * BYTES_PER_XDR_UNIT);
-		if (buf == NULL) {
-			 if (!inline_xdr_u_int (xdrs, &objp->seqnum))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->fileno))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->off))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->len))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags2))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags3))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags4))
-				 return FALSE;
-
-		} else {
-		objp->seqnum = IXDR_GET_U_LONG(buf);
-		objp->fileno = IXDR_GET_U_LONG(buf);
-		objp->off = IXDR_GET_U_LONG(buf);
-		objp->len = IXDR_GET_U_LONG(buf);
-		objp->flags = IXDR_GET_U_LONG(buf);
-		objp->flags2 = IXDR_GET_U_LONG(buf);
-		objp->flags3 = IXDR_GET_U_LONG(buf);
-		objp->flags4 = IXDR_GET_U_LONG(buf);
-		}
-		 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, ~0))
+		break;
+	case OP_READ:
+		 if (!xdr_read_args (xdrs, &objp->fchan_op_args_u.read))
 			 return FALSE;
-	 return TRUE;
+		break;
+	case OP_WRITE:
+		 if (!xdr_write_args (xdrs, &objp->fchan_op_args_u.write))
+			 return FALSE;
+		break;
+	case OP_READ64:
+		 if (!xdr_read64_args (xdrs, &objp->fchan_op_args_u.read64))
+			 return FALSE;
+		break;
+	case OP_WRITE64:
+		 if (!xdr_write64_args (xdrs, &objp->fchan_op_args_u.write64))
+			 return FALSE;
+		break;
+	default:
+		return FALSE;
 	}
+	return TRUE;
+}
 
-	 if (!inline_xdr_u_int (xdrs, &objp->seqnum))
+bool_t
+xdr_fchan_op_res (XDR *xdrs, fchan_op_res *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_fchan_opnum (xdrs, &objp->op))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->fileno))
+	switch (objp->op) {
+	case OP_SENDMSG:
+		 if (!xdr_fchan_res (xdrs, &objp->fchan_op_res_u.sendmsg))
+			 return FALSE;
+		break;
+	case OP_READ:
+		 if (!xdr_read_res (xdrs, &objp->fchan_op_res_u.read))
+			 return FALSE;
+		break;
+	case OP_WRITE:
+		 if (!xdr_write_res (xdrs, &objp->fchan_op_res_u.write))
+			 return FALSE;
+		break;
+	case OP_READ64:
+		 if (!xdr_read_res (xdrs, &objp->fchan_op_res_u.read64))
+			 return FALSE;
+		break;
+	case OP_WRITE64:
+		 if (!xdr_write_res (xdrs, &objp->fchan_op_res_u.write64))
+			 return FALSE;
+		break;
+	default:
+		return FALSE;
+	}
+	return TRUE;
+}
+
+bool_t
+xdr_compound_args (XDR *xdrs, compound_args *objp)
+{
+	register int32_t *buf;
+
+	 if (!inline_xdr_u_int (xdrs, &objp->tag))
+		 return FALSE;
+	 if (!fchan_xdr_array (xdrs, (char **)&objp->ops.ops_val, (u_int *) &objp->ops.ops_len, FCHAN_COMPOUND_MAXOPS,
+		sizeof (fchan_op_args), (xdrproc_t) xdr_fchan_op_args))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->off))
+	return TRUE;
+}
+
+FCHAN_XDR_WORDS_FIT(compound_res, status, tag, 2);
+
+bool_t
+xdr_compound_res (XDR *xdrs, compound_res *objp)
+{
+	 if (!fchan_xdr_words (xdrs, &objp->status, 2))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->len))
+	 if (!fchan_xdr_array (xdrs, (char **)&objp->results.results_val, (u_int *) &objp->results.results_len, FCHAN_COMPOUND_MAXOPS,
+		sizeof (fchan_op_res), (xdrproc_t) xdr_fchan_op_res))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags))
+	return TRUE;
+}
+
+FCHAN_XDR_WORDS_FIT(fchan_extent, off, len, 2);
+
+bool_t
+xdr_fchan_extent (XDR *xdrs, fchan_extent *objp)
+{
+	return fchan_xdr_words (xdrs, &objp->off, 2);
+}
+
+FCHAN_XDR_WORDS_FIT(readv_args, seqnum, flags, 3);
+
+bool_t
+xdr_readv_args (XDR *xdrs, readv_args *objp)
+{
+	 if (!fchan_xdr_words (xdrs, &objp->seqnum, 3))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags2))
+	 if (!fchan_xdr_array (xdrs, (char **)&objp->extents.extents_val, (u_int *) &objp->extents.extents_len, FCHAN_IOV_MAX,
+		sizeof (fchan_extent), (xdrproc_t) xdr_fchan_extent))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags3))
+	return TRUE;
+}
+
+FCHAN_XDR_WORDS_FIT(readv_res, eof, flags, 2);
+
+bool_t
+xdr_readv_res (XDR *xdrs, readv_res *objp)
+{
+	 if (!fchan_xdr_words (xdrs, &objp->eof, 2))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags4))
+	 if (!fchan_xdr_array (xdrs, (char **)&objp->lens.lens_val, (u_int *) &objp->lens.lens_len, FCHAN_IOV_MAX,
+		sizeof (u_int), (xdrproc_t) xdr_u_int))
 		 return FALSE;
-	 if (!xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, ~0))
+	 if (!fchan_xdr_bytes (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, ~0))
 		 return FALSE;
 	return TRUE;
 }
 
+FCHAN_XDR_WORDS_FIT(writev_args, seqnum, flags, 3);
+
 bool_t
-xdr_write_res (XDR *xdrs, write_res *objp)
+xdr_writev_args (XDR *xdrs, writev_args *objp)
 {
-	register int32_t *buf;
+	 if (!fchan_xdr_words (xdrs, &objp->seqnum, 3))
+		 return FALSE;
+	 if (!fchan_xdr_array (xdrs, (char **)&objp->extents.extents_val, (u_int *) &objp->extents.extents_len, FCHAN_IOV_MAX,
+		sizeof (fchan_extent), (xdrproc_t) xdr_fchan_extent))
+		 return FALSE;
+	 if (!fchan_xdr_payload (xdrs, (char **)&objp->data.data_val, (u_int *) &objp->data.data_len, ~0))
+		 return FALSE;
+	return TRUE;
+}
 
+FCHAN_XDR_WORDS_FIT(writev_res, flags, count, 2);
 
-	if (xdrs->x_op == XDR_ENCODE) {
-		buf = XDR_INLINE (xdrs, 5 * BYTES_PER_XDR_UNIT);
-		if (buf == NULL) {
-			 if (!inline_xdr_u_int (xdrs, &objp->eof))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags2))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags3))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags4))
-				 return FALSE;
-		} else {
-			IXDR_PUT_U_LONG(buf, objp->eof);
-			IXDR_PUT_U_LONG(buf, objp->flags);
-			IXDR_PUT_U_LONG(buf, objp->flags2);
-			IXDR_PUT_U_LONG(buf, objp->flags3);
-			IXDR_PUT_U_LONG(buf, objp->flags4);
-		}
-		return TRUE;
-	} else if (xdrs->x_op == XDR_DECODE) {
-		buf = XDR_INLINE (xdrs, 5 * BYTES_PER_XDR_UNIT);
-		if (buf == NULL) {
-			 if (!inline_xdr_u_int (xdrs, &objp->eof))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags2))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags3))
-				 return FALSE;
-			 if (!inline_xdr_u_int (xdrs, &objp->flags4))
-				 return FALSE;
-		} else {
-			objp->eof = IXDR_GET_U_LONG(buf);
-			objp->flags = IXDR_GET_U_LONG(buf);
-			objp->flags2 = IXDR_GET_U_LONG(buf);
-			objp->flags3 = IXDR_GET_U_LONG(buf);
-			objp->flags4 = IXDR_GET_U_LONG(buf);
-		}
-	 return TRUE;
-	}
+bool_t
+xdr_writev_res (XDR *xdrs, writev_res *objp)
+{
+	return fchan_xdr_words (xdrs, &objp->flags, 2);
+}
 
-	 if (!inline_xdr_u_int (xdrs, &objp->eof))
+bool_t
+xdr_negotiate_args (XDR *xdrs, negotiate_args *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_u_quad_t (xdrs, &objp->maxio))
 		 return FALSE;
 	 if (!inline_xdr_u_int (xdrs, &objp->flags))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags2))
-		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags3))
+	return TRUE;
+}
+
+bool_t
+xdr_negotiate_res (XDR *xdrs, negotiate_res *objp)
+{
+	register int32_t *buf;
+
+	 if (!xdr_u_quad_t (xdrs, &objp->maxio))
 		 return FALSE;
-	 if (!inline_xdr_u_int (xdrs, &objp->flags4))
+	 if (!inline_xdr_u_int (xdrs, &objp->flags))
 		 return FALSE;
 	return TRUE;
 }
+
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef FCHAN_XDR_FIXED_H
+#define FCHAN_XDR_FIXED_H
+
+#include <stddef.h>
+#include <string.h>
+#include <rpc/rpc.h>
+#include <rpc/xdr_inline.h>
+
+/*
+ * Straight-line codecs for the fixed parts of the fchan and bchan
+ * structs, used by fchan_xdr.c and bchan_xdr.c in place of rpcgen's
+ * per-field code.  A run of u_ints is bounds-checked once with
+ * XDR_INLINE and swapped in one loop the compiler can vectorize; only
+ * a run that straddles the end of the XDR buffer goes field by field.
+ */
+
+/* the n u_ints of type from first to last are back to back, so they
+ * can be coded as one run */
+#define FCHAN_XDR_WORDS_FIT(type, first, last, n)                       \
+    typedef char type##_##first##_fits[                                 \
+        ((offsetof(type, last) - offsetof(type, first))                 \
+         == ((n) - 1) * sizeof(u_int)) ? 1 : -1]
+
+#define FCHAN_XDR_RNDUP(len)                                            \
+    (((len) + BYTES_PER_XDR_UNIT - 1) & ~(BYTES_PER_XDR_UNIT - 1))
+
+static inline bool_t
+fchan_xdr_words(XDR *xdrs, u_int *words, u_int n)
+{
+    int32_t *buf;
+    u_int ix;
+
+    switch (xdrs->x_op) {
+    case XDR_ENCODE:
+        if ((buf = XDR_INLINE(xdrs, n * BYTES_PER_XDR_UNIT))) {
+            for (ix = 0; ix < n; ++ix)
+                buf[ix] = (int32_t) htonl(words[ix]);
+            return (TRUE);
+        }
+        break;
+    case XDR_DECODE:
+        if ((buf = XDR_INLINE(xdrs, n * BYTES_PER_XDR_UNIT))) {
+            for (ix = 0; ix < n; ++ix)
+                words[ix] = ntohl((uint32_t) buf[ix]);
+            return (TRUE);
+        }
+        break;
+    case XDR_FREE:
+        return (TRUE);
+    }
+
+    /* at a buffer boundary */
+    for (ix = 0; ix < n; ++ix)
+        if (! inline_xdr_u_int(xdrs, &words[ix]))
+            return (FALSE);
+
+    return (TRUE);
+}
+
+/* Encode a u_int and up to two strings with one bounds check.  Returns
+ * FALSE, having encoded nothing, if the caller should take the field
+ * by field path instead (which also reports any error). */
+static inline bool_t
+fchan_xdr_put_strings(XDR *xdrs, u_int word, char *const *strs,
+                      const u_int *maxsize, u_int n)
+{
+    u_int len[2], total = BYTES_PER_XDR_UNIT, ix;
+    int32_t *buf;
+    char *p;
+
+    if ((xdrs->x_op != XDR_ENCODE) || (n > 2))
+        return (FALSE);
+
+    for (ix = 0; ix < n; ++ix) {
+        if (! strs[ix])
+            return (FALSE);
+        len[ix] = strlen(strs[ix]);
+        if (len[ix] > maxsize[ix])
+            return (FALSE);
+        total += BYTES_PER_XDR_UNIT + FCHAN_XDR_RNDUP(len[ix]);
+    }
+
+    if (! (buf = XDR_INLINE(xdrs, total)))
+        return (FALSE);
+
+    *buf++ = (int32_t) htonl(word);
+    for (ix = 0; ix < n; ++ix) {
+        *buf++ = (int32_t) htonl(len[ix]);
+        p = (char *) buf;
+        memcpy(p, strs[ix], len[ix]);
+        memset(p + len[ix], 0, FCHAN_XDR_RNDUP(len[ix]) - len[ix]);
+        buf += FCHAN_XDR_RNDUP(len[ix]) / BYTES_PER_XDR_UNIT;
+    }
+
+    return (TRUE);
+}
+
+#endif /* FCHAN_XDR_FIXED_H */
@@ -0,0 +1,206 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+
+#include <rpc/rpc.h>
+#include <rpc/rpc_dplx.h>
+
+#include "fchan_zcopy.h"
+
+/* record mark + reply header + read_res fixed fields + opaque length;
+ * only AUTH_NONE replies come here, so the verifier is empty */
+#define ZC_HDR_MAX 128
+
+#define ZC_LAST_FRAG 0x80000000
+
+/* a peer that takes nothing for this long is given up on; we hold the
+ * xprt's send lock meanwhile */
+#define ZC_SEND_TIMEOUT_MS 30000
+
+static struct fchan_zcopy_stats zc_stats;
+
+/* 0 when fd takes more, else -1 with errno set */
+static int
+zc_wait_writable(int fd)
+{
+    struct pollfd pfd;
+    int n;
+
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+
+    do {
+        n = poll(&pfd, 1, ZC_SEND_TIMEOUT_MS);
+    } while (n < 0 && errno == EINTR);
+
+    if (n == 0)
+        errno = ETIMEDOUT;
+    return ((n > 0) ? 0 : -1);
+}
+
+static int
+zc_send_all(int sock, const char *buf, size_t len, int flags)
+{
+    ssize_t n;
+
+    while (len > 0) {
+        n = send(sock, buf, len, flags);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if ((errno == EAGAIN || errno == EWOULDBLOCK)
+                && ! zc_wait_writable(sock))
+                continue;
+            return (-1);
+        }
+        buf += n;
+        len -= n;
+    }
+    return (0);
+}
+
+/* flags go with the last of it, should the file come up short */
+static int
+zc_sendfile_all(int sock, int fd, off_t off, size_t len, int flags)
+{
+    static const char zeros[4096];
+    ssize_t n;
+
+    while (len > 0) {
+        n = sendfile(sock, fd, &off, len);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if ((errno == EAGAIN || errno == EWOULDBLOCK)
+                && ! zc_wait_writable(sock))
+                continue;
+            return (-1);
+        }
+        if (n == 0)
+            break; /* file shrank under us */
+        len -= n;
+    }
+
+    /* the record length is already on the wire, so fill it out */
+    while (len > 0) {
+        n = MIN(len, sizeof(zeros));
+        if (zc_send_all(sock, zeros, n, ((size_t) n == len) ? flags : MSG_MORE))
+            return (-1);
+        len -= n;
+    }
+
+    return (0);
+}
+
+bool_t
+fchan_zcopy_read_reply(SVCXPRT *xprt, struct svc_req *req, read_res *res,
+                       int fd, off_t off, u_int len)
+{
+    static const char pad[BYTES_PER_XDR_UNIT] = { 0, 0, 0, 0 };
+    char hdr[ZC_HDR_MAX];
+    struct rpc_msg rply;
+    uint32_t *rm;
+    u_int hlen, npad;
+    XDR xdrs[1];
+    int code = 0;
+
+    /* the reply verifier for anything else lives in the xprt */
+    if (req->rq_cred.oa_flavor != AUTH_NONE)
+        return (FALSE);
+
+    rply.rm_xid = req->rq_msg->rm_xid;
+    rply.rm_direction = REPLY;
+    rply.rm_reply.rp_stat = MSG_ACCEPTED;
+    rply.acpted_rply.ar_verf = _null_auth;
+    rply.acpted_rply.ar_stat = SUCCESS;
+    rply.acpted_rply.ar_results.where = NULL;
+    rply.acpted_rply.ar_results.proc = (xdrproc_t) xdr_void;
+
+    xdrmem_create(xdrs, hdr + BYTES_PER_XDR_UNIT,
+                  ZC_HDR_MAX - BYTES_PER_XDR_UNIT, XDR_ENCODE);
+    if (!xdr_replymsg(xdrs, &rply) ||
+        !xdr_u_int(xdrs, &res->eof) ||
+        !xdr_u_int(xdrs, &res->flags) ||
+        !xdr_u_int(xdrs, &res->flags2) ||
+        !xdr_u_int(xdrs, &res->flags3) ||
+        !xdr_u_int(xdrs, &res->flags4) ||
+        !xdr_u_int(xdrs, &len)) {
+        XDR_DESTROY(xdrs);
+        return (FALSE);
+    }
+    hlen = XDR_GETPOS(xdrs);
+    XDR_DESTROY(xdrs);
+
+    npad = (BYTES_PER_XDR_UNIT - (len % BYTES_PER_XDR_UNIT))
+        % BYTES_PER_XDR_UNIT;
+
+    /* one-fragment record */
+    rm = (uint32_t *) hdr;
+    *rm = htonl(ZC_LAST_FRAG | (hlen + len + npad));
+
+    /* serialize with other replies and backchannel calls */
+    rpc_dplx_slx(xprt);
+
+    if (zc_send_all(xprt->xp_fd, hdr, BYTES_PER_XDR_UNIT + hlen, MSG_MORE)
+        || zc_sendfile_all(xprt->xp_fd, fd, off, len, npad ? MSG_MORE : 0)
+        || (npad && zc_send_all(xprt->xp_fd, pad, npad, 0))) {
+        /* Part of the record may be out, so the stream can't be
+         * resynchronized.  Shut the socket down: the xprt sees EOF on
+         * its next recv and goes away, and nothing more is sent. */
+        code = errno;
+        fprintf(stderr, "%s: xprt %p send failed (%s)\n", __func__, xprt,
+                strerror(code));
+        (void) shutdown(xprt->xp_fd, SHUT_RDWR);
+    }
+
+    rpc_dplx_sux(xprt);
+
+    if (code) {
+        __sync_fetch_and_add(&zc_stats.failed, 1);
+        return (FALSE);
+    }
+
+    __sync_fetch_and_add(&zc_stats.replies, 1);
+    __sync_fetch_and_add(&zc_stats.bytes, len);
+
+    return (TRUE);
+}
+
+void
+fchan_zcopy_stats(struct fchan_zcopy_stats *st)
+{
+    st->replies = zc_stats.replies;
+    st->bytes = zc_stats.bytes;
+    st->failed = zc_stats.failed;
+}
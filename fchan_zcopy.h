@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2012 Linux Box Corporation.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR `AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef FCHAN_ZCOPY_H
+#define FCHAN_ZCOPY_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "fchan.h"
+
+/*
+ * Zero-copy READ replies.  The RPC reply header and the fixed read_res
+ * fields are XDR encoded into a small buffer and written to the socket,
+ * then the payload goes from the backing file with sendfile(2), so it
+ * never passes through user space.
+ */
+
+struct fchan_zcopy_stats {
+    uint64_t replies;
+    uint64_t bytes;
+    uint64_t failed; /* send failed, connection shut down */
+};
+
+/* Returns TRUE if the reply was sent (the caller must not reply), FALSE
+ * if this request can't go zero-copy and should take the XDR path.
+ * FALSE also if the send failed partway; the connection is then shut
+ * down, and the XDR path's reply fails with it.  res->data is ignored;
+ * data_len is taken from len. */
+bool_t fchan_zcopy_read_reply(SVCXPRT *xprt, struct svc_req *req,
+                              read_res *res, int fd, off_t off, u_int len);
+
+void fchan_zcopy_stats(struct fchan_zcopy_stats *st);
+
+#endif /* FCHAN_ZCOPY_H */